@@ -0,0 +1,89 @@
+#ifndef BTagCache_H
+#define BTagCache_H
+
+/**
+ * BTagCache
+ *
+ * Binary snapshot of the inputs of BTagWeighter: the entries of each
+ * calibration CSV file and the TH3D efficiency maps.  Reading it avoids
+ * tokenizing the CSV files, compiling a TF1 per line to check it, and opening
+ * the ROOT files.
+ *
+ * The cache records the size and a checksum of every source file it was made
+ * from.  matches() compares them with the files on disk, so that a stale
+ * cache is never used in place of updated inputs.
+ *
+ * Layout (native byte order, strings as uint32 length + bytes):
+ *   "IIHEBTAG", uint32 version
+ *   uint32 nSources,      { string path, uint64 size, uint64 checksum }
+ *   uint32 nCalibrations, { string path, string tagger, uint32 nEntries,
+ *                           { uint32 op, string measurementType, string sysType,
+ *                             uint32 jetFlavor, float eta/pt/discr min/max,
+ *                             string formula } }
+ *   uint32 nEfficiencies, { string path, string name,
+ *                           3 x { uint32 nBins, double edges[nBins+1] },
+ *                           uint32 nCells, double contents[nCells] }
+ *   uint64 checksum of everything above
+ *
+ ************************************************************/
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <TH3D.h>
+
+#include "BTagCalibration.h"
+
+class BTagCache
+{
+public:
+  BTagCache() {}
+  ~BTagCache() {}
+
+  // FNV-1a checksum of a file's contents; returns false if it cannot be read
+  static bool checksum(const std::string & filename,
+                       unsigned long long & size,
+                       unsigned long long & sum);
+
+  // Parse the sources the usual way and add them to the cache
+  void addCalibration(const std::string & tagger, const std::string & filename);
+  void addEfficiency(const std::string & filename, const std::string & histName);
+
+  void write(const std::string & filename) const;
+
+  // Memory-map and decode a cache file.  Returns false if it is missing,
+  // truncated or of another version; the cache is left empty then.
+  bool read(const std::string & filename);
+
+  // True if every one of the given source files is in the cache and still
+  // has the size and checksum it had when the cache was made
+  bool matches(const std::vector<std::string> & sources) const;
+
+  const BTagCalibration & calibration(const std::string & filename) const;
+  TH3D efficiency(const std::string & filename, const std::string & histName) const;
+
+private:
+  struct Source {
+    unsigned long long size;
+    unsigned long long checksum;
+  };
+  struct Axis {
+    std::vector<double> edges;
+  };
+  struct Efficiency {
+    std::string name;
+    Axis axes[3];
+    std::vector<double> contents;  // all cells, including under- and overflow
+  };
+
+  void addSource(const std::string & filename);
+
+  std::map<std::string, Source> sources_;
+  std::map<std::string, std::shared_ptr<BTagCalibration> > calibrations_;
+  std::map<std::pair<std::string, std::string>, Efficiency> efficiencies_;
+};
+
+#endif  // BTagCache_H
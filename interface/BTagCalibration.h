@@ -35,6 +35,7 @@ public:
 
   void addEntry(const BTagEntry &entry);
   const std::vector<BTagEntry>& getEntries(const BTagEntry::Parameters &par) const;
+  const std::map<std::string, std::vector<BTagEntry> >& getAllEntries() const {return data_;}
 
   void readCSV(std::istream &s);
   void readCSV(const std::string &s);
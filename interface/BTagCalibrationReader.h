@@ -5,7 +5,8 @@
  * BTagCalibrationReader
  *
  * Helper class to pull out a specific set of BTagEntry's out of a
- * BTagCalibration. TF1 functions are set up at initialization time.
+ * BTagCalibration. The TF1 of an entry is set up when the entry is first
+ * evaluated.
  *
  ************************************************************/
 
@@ -26,6 +27,19 @@ public:
                         const std::string & sysType="central",
                         const std::vector<std::string> & otherSysTypes={});
 
+  // Replace each entry's TF1 by a regular table over its pt (or discr) range,
+  // linearly interpolated in eval.  The number of nodes is doubled until the
+  // table is within tolerance of the TF1 at 8 points between every pair of
+  // nodes; entries that need more than 65537 nodes keep the TF1.  Must be
+  // called before load; 0 (the default) keeps the exact TF1 evaluation, a
+  // negative tolerance throws.
+  void set_table_tolerance(double tolerance);
+
+  // Largest absolute difference between table and TF1 over the checked points
+  // of every table built so far, including the other sysTypes.  Tables are
+  // built when their entry is first evaluated.
+  double max_table_deviation() const;
+
   void load(const BTagCalibration & c,
             BTagEntry::JetFlavor jf,
             const std::string & measurementType="comb");
@@ -35,16 +49,37 @@ public:
               float pt,
               float discr=0.) const;
 
+  // same result as eval, but found by scanning all entries instead of the cell
+  // index built in load; slow, meant for cross-checks
+  double eval_linear(BTagEntry::JetFlavor jf,
+                     float eta,
+                     float pt,
+                     float discr=0.) const;
+
   double eval_auto_bounds(const std::string & sys,
                           BTagEntry::JetFlavor jf,
                           float eta,
                           float pt,
                           float discr=0.) const;
 
+  // eval_auto_bounds for several sysTypes at once, one SF per entry of systs
+  void eval_auto_bounds(const std::vector<std::string> & systs,
+                        BTagEntry::JetFlavor jf,
+                        float eta,
+                        float pt,
+                        float discr,
+                        std::vector<double> & sfs) const;
+
   std::pair<float, float> min_max_pt(BTagEntry::JetFlavor jf,
                                      float eta,
                                      float discr=0.) const;
 
+  // same result as min_max_pt, but found by scanning all entries instead of the
+  // bounds stored per cell in load; slow, meant for cross-checks
+  std::pair<float, float> min_max_pt_linear(BTagEntry::JetFlavor jf,
+                                            float eta,
+                                            float discr=0.) const;
+
 protected:
   std::shared_ptr<BTagCalibrationReaderImpl> pimpl;
 };
@@ -0,0 +1,55 @@
+#ifndef BTagEfficiencyTable_H
+#define BTagEfficiencyTable_H
+
+/**
+ * BTagEfficiencyTable
+ *
+ * The b-tag efficiency maps of all operating points, flattened into one
+ * contiguous array.  The axis edges are copied out of the TH3D's once, and
+ * maps with the same binning share them, so a lookup is a few comparisons and
+ * an array read instead of the virtual FindFixBin / GetBinContent calls.  Bins
+ * are found exactly as TAxis::FindFixBin does, including under- and overflow.
+ *
+ ************************************************************/
+
+#include <vector>
+
+#include <TH3D.h>
+
+class BTagEfficiencyTable
+{
+public:
+  BTagEfficiencyTable() {}
+  // One map per operating point, in the order they are looked up by
+  explicit BTagEfficiencyTable(const std::vector<TH3D> & hists);
+
+  double value(unsigned map, double x, double y, double z) const;
+
+  unsigned size() const {return maps_.size();}
+
+private:
+  struct Axis {
+    int nBins;
+    double min;
+    double max;
+    std::vector<double> edges;  // only for variable bins, empty for fixed ones
+
+    explicit Axis(const TAxis & axis);
+    bool operator==(const Axis & other) const;
+    int findBin(double x) const;
+  };
+  struct Binning {
+    Axis x, y, z;
+    bool operator==(const Binning & other) const;
+  };
+  struct Map {
+    unsigned binning;  // index into binnings_
+    unsigned offset;   // of the first cell in contents_
+  };
+
+  std::vector<Binning> binnings_;
+  std::vector<Map> maps_;
+  std::vector<double> contents_;
+};
+
+#endif  // BTagEfficiencyTable_H
@@ -1,4 +1,7 @@
 // System includes
+#include <algorithm>
+#include <deque>
+#include <string>
 #include <vector>
 #include <iostream>
 
@@ -28,30 +31,7 @@ class BranchWrapperBase{
     bool is_touched_ ;
 };
 
-class BranchWrapperB  : public BranchWrapperBase{
-  private:
-    bool value_ ;
-  public:
-    BranchWrapperB(std::string) ;
-    ~BranchWrapperB(){} ;
-    void set(bool) ;
-    int  config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
-};
-
-class BranchWrapperD  : public BranchWrapperBase{
-  private:
-    double value_ ;
-  public:
-    BranchWrapperD(std::string) ;
-    ~BranchWrapperD(){} ;
-    void set(double) ;
-    int  config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
-};
-
+// Single branches of the meta tree.  The data tree uses BranchColumn below.
 class BranchWrapperF  : public BranchWrapperBase{
   private:
     float value_ ;
@@ -64,80 +44,6 @@ class BranchWrapperF  : public BranchWrapperBase{
     void endEvent() ;
 };
 
-class BranchWrapperI  : public BranchWrapperBase{
-  private:
-    int value_ ;
-  public:
-    BranchWrapperI(std::string) ;
-    ~BranchWrapperI(){} ;
-    void set(int) ;
-    int  config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
-};
-
-class BranchWrapperC  : public BranchWrapperBase{
-  private:
-    std::string value_ ;
-  public:
-    BranchWrapperC(std::string) ;
-    ~BranchWrapperC(){} ;
-    void set(std::string) ;
-    int  config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
-};
-
-
-class BranchWrapperU  : public BranchWrapperBase{
-  private:
-    unsigned int value_ ;
-  public:
-    BranchWrapperU(std::string) ;
-    ~BranchWrapperU(){} ;
-    void set(unsigned int) ;
-    int  config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
-};
-
-class BranchWrapperUL  : public BranchWrapperBase{
-  private:
-    unsigned long int value_ ;
-  public:
-    BranchWrapperUL(std::string) ;
-    ~BranchWrapperUL(){} ;
-    void set(unsigned long int) ;
-    int  config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
-};
-
-
-class BranchWrapperBV : public BranchWrapperBase{
-  private:
-    std::vector<bool> values_;
-  public:
-    BranchWrapperBV(std::string) ;
-    ~BranchWrapperBV() ;
-    void push(bool) ;
-    int config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
-};
-
-class BranchWrapperDV : public BranchWrapperBase{
-  private:
-    std::vector<double> values_;
-  public:
-    BranchWrapperDV(std::string) ;
-    ~BranchWrapperDV() ;
-    void push(double) ;
-    int config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
-};
-
 class BranchWrapperFV : public BranchWrapperBase{
   private:
     std::vector<float> values_;
@@ -150,13 +56,13 @@ class BranchWrapperFV : public BranchWrapperBase{
     void endEvent() ;
 };
 
-class BranchWrapperIV : public BranchWrapperBase{
+class BranchWrapperDV : public BranchWrapperBase{
   private:
-    std::vector<int> values_;
+    std::vector<double> values_;
   public:
-    BranchWrapperIV(std::string) ;
-    ~BranchWrapperIV() ;
-    void push(int) ;
+    BranchWrapperDV(std::string) ;
+    ~BranchWrapperDV() ;
+    void push(double) ;
     int config(TTree*) ;
     void beginEvent() ;
     void endEvent() ;
@@ -174,122 +80,118 @@ class BranchWrapperCV : public BranchWrapperBase{
     void endEvent() ;
 };
 
-class BranchWrapperUV : public BranchWrapperBase{
-  private:
-    std::vector<unsigned int> values_;
-  public:
-    BranchWrapperUV(std::string) ;
-    ~BranchWrapperUV() ;
-    void push(unsigned int) ;
-    int config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
-};
-
-class BranchWrapperULV : public BranchWrapperBase{
-  private:
-    std::vector<unsigned long int> values_;
-  public:
-    BranchWrapperULV(std::string) ;
-    ~BranchWrapperULV() ;
-    void push(unsigned long int) ;
-    int config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
-};
-
-
-class BranchWrapperBVV: public BranchWrapperBase{
-  private:
-    std::vector<std::vector<bool> > values_;
-  public:
-    BranchWrapperBVV(std::string) ;
-    ~BranchWrapperBVV() ;
-    void push(std::vector<bool>) ;
-    int config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
-};
-
-class BranchWrapperDVV: public BranchWrapperBase{
-  private:
-    std::vector<std::vector<double> > values_;
-  public:
-    BranchWrapperDVV(std::string) ;
-    ~BranchWrapperDVV() ;
-    void push(std::vector<double>) ;
-    int config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
-};
-
-class BranchWrapperFVV: public BranchWrapperBase{
-  private:
-    std::vector<std::vector<float> > values_;
+// Opaque handle to a registered branch.  It is returned by IIHEAnalysis::addBranch so
+// that modules can store values without looking the branch up by name every time.
+class BranchHandle{
   public:
-    BranchWrapperFVV(std::string) ;
-    ~BranchWrapperFVV() ;
-    void push(std::vector<float>) ;
-    int config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
-};
-
-class BranchWrapperIVV: public BranchWrapperBase{
+    BranchHandle(): type_(-1), index_(-1){} ;
+    BranchHandle(int type, int index): type_(type), index_(index){} ;
+    ~BranchHandle(){} ;
+    bool valid() const { return index_>=0 ; } ;
+    int   type() const { return  type_ ; } ;
+    int  index() const { return index_ ; } ;
   private:
-    std::vector<std::vector<int> > values_;
-  public:
-    BranchWrapperIVV(std::string) ;
-    ~BranchWrapperIVV() ;
-    void push(std::vector<int>) ;
-    int config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
+    int type_ ;
+    int index_ ;
 };
 
-class BranchWrapperUVV: public BranchWrapperBase{
-  private:
-    std::vector<std::vector<unsigned int> > values_;
-  public:
-    BranchWrapperUVV(std::string) ;
-    ~BranchWrapperUVV() ;
-    void push(std::vector<unsigned int>) ;
-    int config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
-};
-
-
-// Templated (not used, yet)
+// Declare the branch for one slot of a column.  Fundamental types get a leaf list,
+// everything else (strings and vectors) is written as an object.
 template <class T>
-class branchWrapper_simple{
-    std::string name_ ;
-    T value_ ;
-  public:
-    std::string name(){ return name_ ; } ;
-    branchWrapper_simple(std::string) ;
-    ~branchWrapper_simple(){} ;
-    void set(T) ;
-    T get() ;
-    int config(TTree*) ;
-    void beginEvent() ;
-    void endEvent() ;
-};
+inline void branchColumn_makeBranch(TTree* tree, const std::string& name, T* address){
+  tree->Branch(name.c_str(), address) ;
+}
+inline void branchColumn_makeBranch(TTree* tree, const std::string& name, bool* address){
+  tree->Branch(name.c_str(), address, Form("%s/O", name.c_str())) ;
+}
+inline void branchColumn_makeBranch(TTree* tree, const std::string& name, double* address){
+  tree->Branch(name.c_str(), address, Form("%s/D", name.c_str())) ;
+}
+inline void branchColumn_makeBranch(TTree* tree, const std::string& name, float* address){
+  tree->Branch(name.c_str(), address, Form("%s/F", name.c_str())) ;
+}
+inline void branchColumn_makeBranch(TTree* tree, const std::string& name, int* address){
+  tree->Branch(name.c_str(), address, Form("%s/I", name.c_str())) ;
+}
+inline void branchColumn_makeBranch(TTree* tree, const std::string& name, unsigned int* address){
+  tree->Branch(name.c_str(), address, Form("%s/i", name.c_str())) ;
+}
+inline void branchColumn_makeBranch(TTree* tree, const std::string& name, unsigned long int* address){
+  tree->Branch(name.c_str(), address, Form("%s/l", name.c_str())) ;
+}
+
+// Column of branches that all hold the same type.  The values of every branch in the
+// column sit next to each other, so resetting them at the start of an event is one sweep
+// over the storage rather than a virtual call per branch.  A deque is used instead of a
+// vector because the TTree keeps the address of each slot, and branches can still be
+// added after the first config() (eg new trigger menus in beginRun).
+//
+// With resetValues=false the values are kept from one event to the next and only the
+// filled flags are cleared, which is how string branches have always behaved.
 template <class T>
-class branchWrapper_vector{
-    std::string name_ ;
-    std::vector<T> values_ ;
-  public:
-    std::string name(){ return name_ ; } ;
-    branchWrapper_vector(std::string) ;
-    ~branchWrapper_vector(){} ;
-    bool push(T) ;
-    T get(int) ;
-    int nEntries() ;
-    int config(TTree*) ;
-    bool beginEvent() ;
-    bool endEvent() ;
+class BranchColumn{
+  public:
+    BranchColumn(T defaultValue=T(), bool resetValues=true): default_(defaultValue), resetValues_(resetValues), nConfigured_(0){} ;
+    ~BranchColumn(){} ;
+    
+    int add(const std::string& name){
+      names_  .push_back(name    ) ;
+      values_ .push_back(default_) ;
+      filled_ .push_back(false   ) ;
+      touched_.push_back(false   ) ;
+      return names_.size()-1 ;
+    }
+    int find(const std::string& name) const {
+      for(unsigned int i=0 ; i<names_.size() ; ++i){
+        if(names_[i]==name) return i ;
+      }
+      return -1 ;
+    }
+    // Only slots added since the last call get a new branch
+    int config(TTree* tree){
+      if(!tree) return 1 ;
+      for(unsigned int i=nConfigured_ ; i<names_.size() ; ++i){
+        if(tree->GetBranch(names_[i].c_str())) continue ;
+        branchColumn_makeBranch(tree, names_[i], &values_[i]) ;
+      }
+      nConfigured_ = names_.size() ;
+      return 0 ;
+    }
+    void beginEvent(){
+      if(resetValues_) std::fill(values_.begin(), values_.end(), default_) ;
+      std::fill(filled_.begin(), filled_.end(), false   ) ;
+    }
+    
+    void set(unsigned int i, const T& value){
+      values_[i] = value ;
+      mark(i) ;
+    }
+    template <class U> void push(unsigned int i, const U& value){
+      values_[i].push_back(value) ;
+      mark(i) ;
+    }
+    template <class U> void append(unsigned int i, const std::vector<U>& values){
+      if(values.empty()) return ;
+      values_[i].insert(values_[i].end(), values.begin(), values.end()) ;
+      mark(i) ;
+    }
+    
+    unsigned int size() const { return names_.size() ; } ;
+    const std::string& name(unsigned int i) const { return names_[i] ; } ;
+    const T& get(unsigned int i) const { return values_[i] ; } ;
+    bool  is_filled(unsigned int i) const { return  filled_[i] ; } ;
+    bool is_touched(unsigned int i) const { return touched_[i] ; } ;
+    
+  private:
+    void mark(unsigned int i){ filled_[i] = true ; touched_[i] = true ; } ;
+    
+    T default_ ;
+    bool resetValues_ ;
+    unsigned int nConfigured_ ;
+    std::vector<std::string> names_ ;
+    std::deque<T> values_ ;
+    std::vector<char> filled_ ;
+    std::vector<char> touched_ ;
 };
 
-
 #endif
@@ -0,0 +1,43 @@
+#ifndef UserCode_IIHETree_CaloGeometryCache_h
+#define UserCode_IIHETree_CaloGeometryCache_h
+
+// Calorimeter geometry and the preshower topology built from it, kept for as long as the
+// CaloGeometryRecord IOV does not change.  One instance is owned by IIHEAnalysis and
+// shared by the child modules (see IIHEModule::getCaloGeometry), so the topology is made
+// once per IOV instead of once per event and module.  update() compares the record's
+// cacheIdentifier with the one the objects were made from and rebuilds them only when it
+// differs.
+
+#include <memory>
+
+#include "FWCore/Framework/interface/EventSetup.h"
+#include "Geometry/CaloGeometry/interface/CaloGeometry.h"
+#include "Geometry/CaloGeometry/interface/CaloSubdetectorGeometry.h"
+#include "Geometry/CaloTopology/interface/EcalPreshowerTopology.h"
+
+class CaloGeometryCache{
+private:
+  unsigned long long cacheId_ ;
+  const CaloGeometry* geometry_ ;
+  const CaloSubdetectorGeometry* geometryPreshower_ ;
+  std::unique_ptr<EcalPreshowerTopology> topologyPreshower_ ;
+  int nBuilds_ ;
+public:
+  CaloGeometryCache() ;
+  ~CaloGeometryCache(){} ;
+
+  void update(const edm::EventSetup&) ;
+  // The same with the record's cacheIdentifier and CaloGeometry already in hand
+  void update(unsigned long long cacheId, const CaloGeometry*) ;
+
+  // Valid until the next update that sees a new IOV.  The preshower objects are 0 when
+  // the geometry has no preshower.
+  const CaloGeometry*            geometry()          const { return geometry_          ; }
+  const CaloSubdetectorGeometry* geometryPreshower() const { return geometryPreshower_ ; }
+  const EcalPreshowerTopology*   topologyPreshower() const { return topologyPreshower_.get() ; }
+
+  // Number of times the objects were (re)built, ie the number of IOVs seen
+  int nBuilds() const { return nBuilds_ ; }
+};
+
+#endif
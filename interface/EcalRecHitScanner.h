@@ -0,0 +1,71 @@
+#ifndef UserCode_IIHETree_EcalRecHitScanner_h
+#define UserCode_IIHETree_EcalRecHitScanner_h
+
+// Summary of the rechits of one ECAL detector (barrel or endcap), which the electron
+// module writes to the <prefix>_* branches.  scan() makes one pass over the collection.
+// It ORs the flag words of all hits and records the hits at or above the energy threshold.  Only those hits are then unpacked into the columns, which
+// keep their capacity from event to event.
+//
+// The columns hold, per stored hit in collection order: the raw DetId, the hit's number
+// among the stored hits of this detector counting from 1, the energy, ieta and iphi
+// (iy and ix in the endcap, as for gsf_sc_seed_ieta/iphi), the reco flag, and one flag
+// column per stored flag.
+//
+// Flags are given by their EcalRecHit::Flags names, eg "kSaturated".  The saturation
+// flags only feed isSaturated().
+
+#include <string>
+#include <vector>
+
+#include "DataFormats/EcalRecHit/interface/EcalRecHit.h"
+#include "DataFormats/EcalRecHit/interface/EcalRecHitCollections.h"
+
+class EcalRecHitScanner{
+public:
+  EcalRecHitScanner(std::string prefix, bool isEndcap, float energyThreshold,
+                    const std::vector<std::string>& saturationFlags,
+                    const std::vector<std::string>& storedFlags) ;
+  ~EcalRecHitScanner(){} ;
+
+  // EcalRecHit::Flags value of a flag name, or -1 if there is no such flag
+  static int flagFromName(const std::string&) ;
+
+  void scan(const EcalRecHitCollection&) ;
+
+  // Whether any hit of the last scan had one of the saturation flags, whatever its energy
+  bool isSaturated() const { return (flagsOr_ & saturationMask_)!=0 ; }
+  unsigned int nStoredHits() const { return energy_.size() ; }
+
+  const std::string& prefix() const { return prefix_ ; }
+  const std::vector<std::string>& storedFlagNames() const { return storedFlagNames_ ; }
+
+  // Columns of the last scan
+  const std::vector<int>  & rawId()    const { return rawId_    ; }
+  const std::vector<int>  & iRechit()  const { return iRechit_  ; }
+  const std::vector<float>& energy()   const { return energy_   ; }
+  const std::vector<int>  & ieta()     const { return ieta_     ; }
+  const std::vector<int>  & iphi()     const { return iphi_     ; }
+  const std::vector<int>  & recoFlag() const { return recoFlag_ ; }
+  const std::vector<bool> & flag(unsigned int i) const { return flags_.at(i) ; }
+
+private:
+  std::string prefix_ ;
+  bool isEndcap_ ;
+  float energyThreshold_ ;
+  uint32_t saturationMask_ ;
+  std::vector<int> storedFlags_ ;
+  std::vector<std::string> storedFlagNames_ ;
+
+  // Result of the last scan
+  uint32_t flagsOr_ ;
+  std::vector<unsigned int> selected_ ;
+  std::vector<int>   rawId_    ;
+  std::vector<int>   iRechit_  ;
+  std::vector<float> energy_   ;
+  std::vector<int>   ieta_     ;
+  std::vector<int>   iphi_     ;
+  std::vector<int>   recoFlag_ ;
+  std::vector<std::vector<bool> > flags_ ;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef UserCode_IIHETree_EcalShapeCache_h
+#define UserCode_IIHETree_EcalShapeCache_h
+
+// Per event cache of the EcalClusterLazyTools shower shapes, keyed by supercluster.  One
+// instance is owned by IIHEAnalysis and cleared at the start of every event, so a module
+// that asks for the shapes of a supercluster another module (or another object sharing
+// the supercluster) has already asked for gets the stored values instead of walking the
+// rechits again.  The lazy tools themselves are also made once per event, by the first
+// module that needs them.  All modules have to make them from the same rechit
+// collections, since the shapes are only keyed by supercluster: tools() throws if a later
+// call in the event passes other tokens than the first one.
+//
+// The shapes of the seed cluster are those of EcalClusterLazyTools, the preshower ones
+// use the supercluster position and the geometry from CaloGeometryCache.
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/EventSetup.h"
+#include "DataFormats/EcalRecHit/interface/EcalRecHitCollections.h"
+#include "DataFormats/EgammaReco/interface/SuperCluster.h"
+#include "DataFormats/EgammaReco/interface/SuperClusterFwd.h"
+#include "RecoEcal/EgammaCoreTools/interface/EcalClusterLazyTools.h"
+
+class CaloGeometryCache ;
+
+struct EcalClusterShapes{
+  // Seed cluster
+  float e2x5Right, e2x5Left, e2x5Top, e2x5Bottom ;
+  float eMax, e2nd ;
+  float eRight, eLeft, eTop, eBottom ;
+  float e2x2, e3x3, e4x4, e5x5 ;
+  float e1x5, e5x1, e1x3, e3x1 ;
+  float seedTime ;
+  // Preshower
+  std::vector<float> eshitsixix, eshitsiyiy ;
+  float eseffsixix, eseffsiyiy, eseffsirir ;
+};
+
+class EcalShapeCache{
+private:
+  std::unique_ptr<EcalClusterLazyTools> tools_ ;
+  edm::EDGetTokenT<EcalRecHitCollection> ebRecHits_ ;
+  edm::EDGetTokenT<EcalRecHitCollection> eeRecHits_ ;
+  edm::EDGetTokenT<EcalRecHitCollection> esRecHits_ ;
+  std::map<reco::SuperClusterRef, EcalClusterShapes> shapes_ ;
+
+  // Requests answered from the cache, this event and over the job
+  int nLookups_ ;
+  int nHits_ ;
+  long nLookupsTotal_ ;
+  long nHitsTotal_ ;
+public:
+  EcalShapeCache() ;
+  ~EcalShapeCache(){} ;
+
+  // Forget the previous event
+  void clear() ;
+
+  // Lazy tools of this event, made from the given collections on the first call.  Later
+  // calls must give the same collections.
+  EcalClusterLazyTools& tools(const edm::Event&, const edm::EventSetup&,
+                              edm::EDGetTokenT<EcalRecHitCollection>,
+                              edm::EDGetTokenT<EcalRecHitCollection>,
+                              edm::EDGetTokenT<EcalRecHitCollection>) ;
+
+  // Shapes of a supercluster, computed on the first request of the event.  tools() must
+  // have been called earlier in the event.
+  const EcalClusterShapes& shapes(const reco::SuperClusterRef&, const CaloGeometryCache&) ;
+
+  int  nLookups()      const { return nLookups_      ; }
+  int  nHits()         const { return nHits_         ; }
+  long nLookupsTotal() const { return nLookupsTotal_ ; }
+  long nHitsTotal()    const { return nHitsTotal_    ; }
+};
+
+#endif
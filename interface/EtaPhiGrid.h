@@ -0,0 +1,50 @@
+#ifndef UserCode_IIHETree_EtaPhiGrid_h
+#define UserCode_IIHETree_EtaPhiGrid_h
+
+#include <vector>
+
+// Binned eta-phi index over a set of objects, used to avoid comparing every object with
+// every other one when matching by DeltaR.  Objects are identified by the index they were
+// inserted with.  Phi wraps around, and objects beyond +/-etaMax go into overflow cells at
+// either end so nothing is ever lost.
+class EtaPhiGrid{
+public:
+  EtaPhiGrid(float etaMax, float cellSize) ;
+  ~EtaPhiGrid(){} ;
+
+  void clear() ;
+  void insert(float eta, float phi, int index) ;
+  unsigned int size() const { return etas_.size() ; }
+
+  // Append the indices of all objects in the cells within radius of (eta, phi).  This is
+  // a superset of the objects with DeltaR<radius, so callers still apply their own cut.
+  void neighbours(float eta, float phi, float radius, std::vector<int>& result) const ;
+
+  // Index of the object closest in DeltaR to (eta, phi), or -1 if the grid is empty.  On
+  // equal DeltaR the lowest index wins, which is what a linear scan in insertion order
+  // gives, so the result is identical to that scan.
+  int nearest(float eta, float phi) const ;
+
+  // The linear scan nearest() has to agree with: first object with the smallest DeltaR,
+  // or -1 if there are none.  Kept as the reference for tests and cross checks.
+  static int nearestLinear(const std::vector<float>& etas, const std::vector<float>& phis, float eta, float phi) ;
+
+private:
+  int etaCell(float) const ;
+  int phiCell(float) const ;
+  int cell(int ieta, int iphi) const { return ieta*nPhi_ + iphi ; }
+  void visit(int ieta, int iphiOffset, int iphi, float eta, float phi, float& bestDR, int& bestIndex) const ;
+
+  float etaMax_ ;
+  float etaWidth_ ;
+  float phiWidth_ ;
+  int nEta_ ;
+  int nPhi_ ;
+
+  std::vector<std::vector<int> > cells_ ;
+  std::vector<float> etas_ ;
+  std::vector<float> phis_ ;
+  std::vector<int> indices_ ;
+};
+
+#endif
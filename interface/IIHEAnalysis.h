@@ -2,6 +2,8 @@
 #define UserCode_IIHETree_IIHEAnalysis_h
 
 // System includes
+#include <chrono>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -21,6 +23,8 @@
 #include "FWCore/ServiceRegistry/interface/Service.h"
 
 #include "UserCode/IIHETree/interface/BranchWrapper.h"
+#include "UserCode/IIHETree/interface/CaloGeometryCache.h"
+#include "UserCode/IIHETree/interface/EcalShapeCache.h"
 #include "UserCode/IIHETree/interface/IIHEModule.h"
 #include "UserCode/IIHETree/interface/TriggerObject.h"
 #include "UserCode/IIHETree/interface/MCTruthObject.h"
@@ -58,6 +62,15 @@ namespace edm {
 class IIHEModule ;
 class IIHEModuleMCTruth ;
 
+// Time and heap usage accumulated by one child module over the job
+struct IIHEModuleProfile{
+  IIHEModuleProfile(std::string moduleName): name(moduleName), nCalls(0), wallTime(0), heapBytes(0){}
+  std::string name ;
+  long long nCalls ; // Calls to analyze
+  double wallTime  ; // Seconds spent in analyze, beginEvent and endEvent
+  double heapBytes ; // Net heap growth, only with profileModuleMemory
+};
+
 // class decleration
 class IIHEAnalysis : public edm::EDAnalyzer {
 
@@ -84,8 +97,23 @@ public:
   bool store(std::string, std::vector<int         >);
   bool store(std::string, std::vector<unsigned int>);
   
+  // Constant time stores through a handle obtained from addBranch
+  bool store(const BranchHandle&, bool    );
+  bool store(const BranchHandle&, double  );
+  bool store(const BranchHandle&, float   );
+  bool store(const BranchHandle&, int     );
+  bool store(const BranchHandle&, std::string     );
+  bool store(const BranchHandle&, unsigned int);
+  bool store(const BranchHandle&, unsigned long int);
+  bool store(const BranchHandle&, const std::vector<bool        >&);
+  bool store(const BranchHandle&, const std::vector<double      >&);
+  bool store(const BranchHandle&, const std::vector<float       >&);
+  bool store(const BranchHandle&, const std::vector<int         >&);
+  bool store(const BranchHandle&, const std::vector<unsigned int>&);
+  
   bool addBranch(std::string) ;
   bool addBranch(std::string,int) ;
+  bool addBranch(std::string,int,BranchHandle&) ;
   bool branchExists(std::string) ;
   
   void setBranchType(int) ;
@@ -95,6 +123,9 @@ public:
   
   bool addValueToMetaTree(std::string, float) ;
   bool addFVValueToMetaTree(std::string, std::vector<float>) ; 
+  // Doubles hold counts and byte sizes exactly up to 2^53
+  bool addDVValueToMetaTree(std::string, std::vector<double>) ;
+  bool addCVValueToMetaTree(std::string, std::vector<std::string>) ;
   // MC truth
   void addToMCTruthWhitelist(std::vector<int>) ;
   std::vector<int> getMCTruthWhitelist(){ return MCTruthWhitelist_ ; }
@@ -113,6 +144,11 @@ public:
   const MCTruthObject* MCTruth_matchEtaPhi(float, float) ;
   int MCTruth_matchEtaPhi_getIndex(float, float) ;
   
+  // Geometry shared by the child modules, refreshed when the IOV changes
+  const CaloGeometryCache& getCaloGeometry(const edm::EventSetup&) ;
+  // Shower shapes shared by the child modules, cleared at the start of each event
+  EcalShapeCache& getEcalShapes(){ return ecalShapes_ ; }
+  
 private:
   virtual void beginJob() ;
   virtual void analyze(const edm::Event&, const edm::EventSetup&);
@@ -122,27 +158,34 @@ private:
   void beginEvent() ;
   void endEvent() ;
   
+  void addGate(std::string, IIHEModule*) ;
+  void startProfile() ;
+  void stopProfile(unsigned int, bool) ;
+  BranchHandle findBranch(const std::string&) ;
+  bool branchIsTouched(const BranchHandle&) ;
+  
   // ----------member data ---------------------------
-  std::vector<BranchWrapperBase*> allVars_ ;
-  std::vector<BranchWrapperBVV* > vars_BVV_;
-  std::vector<BranchWrapperDVV* > vars_DVV_;
-  std::vector<BranchWrapperFVV* > vars_FVV_;
-  std::vector<BranchWrapperIVV* > vars_IVV_;
-  std::vector<BranchWrapperUVV* > vars_UVV_;
-  std::vector<BranchWrapperBV*  > vars_BV_ ;
-  std::vector<BranchWrapperDV*  > vars_DV_ ;
-  std::vector<BranchWrapperFV*  > vars_FV_ ;
-  std::vector<BranchWrapperIV*  > vars_IV_ ;
-  std::vector<BranchWrapperCV*  > vars_CV_ ;
-  std::vector<BranchWrapperUV*  > vars_UV_ ;
-  std::vector<BranchWrapperULV* > vars_ULV_ ;
-  std::vector<BranchWrapperB*   > vars_B_  ;
-  std::vector<BranchWrapperD*   > vars_D_  ;
-  std::vector<BranchWrapperF*   > vars_F_  ;
-  std::vector<BranchWrapperI*   > vars_I_  ;
-  std::vector<BranchWrapperC*   > vars_C_  ;
-  std::vector<BranchWrapperU*   > vars_U_  ;
-  std::vector<BranchWrapperUL*   > vars_UL_  ;
+  // One column per branch type, see BranchWrapper.h
+  BranchColumn<bool                                     > vars_B_  ;
+  BranchColumn<double                                   > vars_D_  ;
+  BranchColumn<float                                    > vars_F_  ;
+  BranchColumn<int                                      > vars_I_  ;
+  BranchColumn<std::string                              > vars_C_  ;
+  BranchColumn<unsigned int                             > vars_U_  ;
+  BranchColumn<unsigned long int                        > vars_UL_ ;
+  BranchColumn<std::vector<bool                       > > vars_BV_ ;
+  BranchColumn<std::vector<double                     > > vars_DV_ ;
+  BranchColumn<std::vector<float                      > > vars_FV_ ;
+  BranchColumn<std::vector<int                        > > vars_IV_ ;
+  BranchColumn<std::vector<std::string                > > vars_CV_ ;
+  BranchColumn<std::vector<unsigned int               > > vars_UV_ ;
+  BranchColumn<std::vector<unsigned long int          > > vars_ULV_;
+  BranchColumn<std::vector<std::vector<bool        > > > vars_BVV_;
+  BranchColumn<std::vector<std::vector<double      > > > vars_DVV_;
+  BranchColumn<std::vector<std::vector<float       > > > vars_FVV_;
+  BranchColumn<std::vector<std::vector<int         > > > vars_IVV_;
+  BranchColumn<std::vector<std::vector<unsigned int> > > vars_UVV_;
+  std::map<std::string, BranchHandle> branchHandles_ ;
   
   int currentVarType_ ;
   std::vector< std::pair<std::string, int> > listOfBranches_  ;
@@ -168,6 +211,7 @@ private:
   bool includeLeptonsAcceptModule_   ;
   bool includeAutoAcceptEventModule_ ;
   bool includeTracksModule_           ;
+  bool leptonsAcceptAsGate_          ;
 
   int preScaleIndex_; 
   HLTPrescaleProvider hltPrescaleProvider_;
@@ -188,8 +232,24 @@ private:
   IIHEModuleMCTruth* MCTruthModule_ ;
   std::vector<int> MCTruthWhitelist_ ;
   std::vector<IIHEModule*> childModules_;
+  // Gate modules run first and can reject the event before the main modules run
+  std::vector<unsigned int> gateIndices_ ;
+  std::vector<std::string>  gateNames_ ;
+  std::vector<int>          gatePassCounts_ ;
+  std::vector<unsigned int> mainIndices_ ;
+  
+  // Cost of each child module, same order as childModules_
+  std::vector<IIHEModuleProfile> moduleProfiles_ ;
+  bool profileModuleMemory_ ;
+  std::chrono::steady_clock::time_point profileTimeStart_ ;
+  double profileHeapStart_ ;
   std::vector<BranchWrapperF*> metaTreePars_ ;
   
+  CaloGeometryCache caloGeometry_ ;
+  EcalShapeCache ecalShapes_ ;
+  BranchHandle ecalShapeLookupsBranch_ ;
+  BranchHandle ecalShapeHitsBranch_ ;
+  
   TTree* dataTree_ ;
   TTree* metaTree_ ;
 };
@@ -49,6 +49,8 @@ namespace edm {
 }
 
 class IIHEAnalysis ; // Forward declaration
+class CaloGeometryCache ;
+class EcalShapeCache ;
 
 // class decleration
 class IIHEModule : public edm::EDAnalyzer {
@@ -61,6 +63,7 @@ public:
   
   bool addBranch(std::string);
   bool addBranch(std::string,int);
+  bool addBranch(std::string,int,BranchHandle&);
   void config(IIHEAnalysis*);
   void begin();
   void store(std::string, bool        );
@@ -75,6 +78,18 @@ public:
   void store(std::string, std::vector<float       >);
   void store(std::string, std::vector<int         >);
   void store(std::string, std::vector<unsigned int>);
+  void store(const BranchHandle&, bool        );
+  void store(const BranchHandle&, double      );
+  void store(const BranchHandle&, float       );
+  void store(const BranchHandle&, int         );
+  void store(const BranchHandle&, std::string         );
+  void store(const BranchHandle&, unsigned int);
+  void store(const BranchHandle&, unsigned long int);
+  void store(const BranchHandle&, const std::vector<bool        >&);
+  void store(const BranchHandle&, const std::vector<double      >&);
+  void store(const BranchHandle&, const std::vector<float       >&);
+  void store(const BranchHandle&, const std::vector<int         >&);
+  void store(const BranchHandle&, const std::vector<unsigned int>&);
   void setBranchType(int);
   
   bool addValueToMetaTree(std::string, float) ;
@@ -88,6 +103,9 @@ public:
   const MCTruthObject* MCTruth_getRecordByIndex(int) ;
   int MCTruth_matchEtaPhi_getIndex(float, float) ;  
   
+  const CaloGeometryCache& getCaloGeometry(const edm::EventSetup&) ;
+  EcalShapeCache& getEcalShapes() ;
+  
   void   pubBeginJob(){   beginJob() ; } ;
   void pubBeginEvent(){ beginEvent() ; } ;
   void   pubEndEvent(){   endEvent() ; } ;
@@ -3,6 +3,7 @@
 
 #include "UserCode/IIHETree/interface/IIHEModule.h"
 #include "UserCode/IIHETree/interface/MiniAODHelper.h"
+#include "UserCode/IIHETree/interface/EcalRecHitScanner.h"
 // class decleration
 class IIHEModuleGedGsfElectron : public IIHEModule {
 private:
@@ -28,10 +29,27 @@ private:
   edm::EDGetTokenT<View<reco::Vertex>> vtxToken_;
   edm::InputTag           primaryVertexLabel_ ;
   float ETThreshold_ ;
+  
+  // High energy barrel and endcap rechits, and the branches of their columns
+  struct RecHitBranches{
+    BranchHandle rawId    ;
+    BranchHandle iRechit  ;
+    BranchHandle energy   ;
+    BranchHandle ieta     ;
+    BranchHandle iphi     ;
+    BranchHandle recoFlag ;
+    std::vector<BranchHandle> flags ;
+  } ;
+  EcalRecHitScanner* EBHitsScanner_ ;
+  EcalRecHitScanner* EEHitsScanner_ ;
+  RecHitBranches EBHitsBranches_ ;
+  RecHitBranches EEHitsBranches_ ;
+  void addRecHitBranches(const EcalRecHitScanner&, RecHitBranches&) ;
+  void storeRecHits(const EcalRecHitScanner&, const RecHitBranches&) ;
 
 public:
   explicit IIHEModuleGedGsfElectron(const edm::ParameterSet& iConfig, edm::ConsumesCollector && iC);
-  explicit IIHEModuleGedGsfElectron(const edm::ParameterSet& iConfig): IIHEModule(iConfig){};
+  explicit IIHEModuleGedGsfElectron(const edm::ParameterSet& iConfig): IIHEModule(iConfig), EBHitsScanner_(0), EEHitsScanner_(0){};
   ~IIHEModuleGedGsfElectron() ;
   
   void   pubBeginJob(){   beginJob() ; } ;
@@ -41,5 +41,8 @@ private:
   float ETThreshold_ ;
   bool isMC_;
   BTagWeighter *btw;
+  std::vector<BTagWeighter::WeightRequest> btagRequests_ ;
+  std::vector<std::string> btagBranchNames_ ;
+  std::vector<double> btagWeights_ ;
 };
 #endif
@@ -15,6 +15,7 @@ private:
   int nMuThreshold_;
   int nMuTauThreshold_;
   int nTauThreshold_;
+  bool asGate_ ;
 
   edm::EDGetTokenT<edm::View<reco::GsfElectron> > electronCollectionToken_;
   edm::EDGetTokenT<edm::View<reco::Muon> > muonCollectionToken_;
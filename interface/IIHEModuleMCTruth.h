@@ -3,6 +3,7 @@
 
 #include "UserCode/IIHETree/interface/IIHEModule.h"
 #include "UserCode/IIHETree/interface/MCTruthObject.h"
+#include "UserCode/IIHETree/interface/EtaPhiGrid.h"
 
 #include "DataFormats/HepMCCandidate/interface/GenParticleFwd.h"
 #include "DataFormats/HepMCCandidate/interface/GenParticle.h"
@@ -21,7 +22,7 @@
 class IIHEModuleMCTruth : public IIHEModule {
 public:
   explicit IIHEModuleMCTruth(const edm::ParameterSet& iConfig, edm::ConsumesCollector && iC);
-  explicit IIHEModuleMCTruth(const edm::ParameterSet& iConfig): IIHEModule(iConfig){};
+  explicit IIHEModuleMCTruth(const edm::ParameterSet& iConfig): IIHEModule(iConfig), truthGrid_(5.0, 0.2){};
   ~IIHEModuleMCTruth();
   
   void   pubBeginJob(){   beginJob() ; } ;
@@ -37,6 +38,7 @@ public:
   virtual void beginRun(edm::Run const&, edm::EventSetup const&);
   
   int matchEtaPhi_getIndex(float, float) ;
+  int matchEtaPhi_getIndexLinear(float, float) ;
   const MCTruthObject* matchEtaPhi(float, float) ;
   const MCTruthObject* getRecordByIndex(int) ;
   
@@ -47,6 +49,11 @@ private:
   double  m_threshold_ ;
   double DeltaROverlapThreshold_ ;
   std::vector<MCTruthObject*> MCTruthRecord_ ;
+  // Owns everything in MCTruthRecord_, reset at the start of each event
+  MCTruthObjectPool MCTruthPool_ ;
+  // Eta-phi index over MCTruthRecord_, used for matching and overlap removal
+  EtaPhiGrid truthGrid_ ;
+  std::vector<int> truthNeighbours_ ;
   
   edm::InputTag puInfoSrc_ ;
   edm::EDGetTokenT<GenEventInfoProduct> generatorLabel_;
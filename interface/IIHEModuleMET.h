@@ -12,6 +12,7 @@ public:
   const std::string       Name(){ return       name_ ; }
   const std::string BranchName(){ return branchName_ ; }
   const int         branchType(){ return branchType_ ; }
+  const BranchHandle&   handle(){ return     handle_ ; }
 
   virtual void reset(){} ;
   virtual void store(IIHEAnalysis*){} ;
@@ -21,6 +22,7 @@ private:
   std::string       name_ ;
   std::string branchName_ ;
   int         branchType_ ;
+  BranchHandle    handle_ ;
 };
 
 class IIHEMETVariableInt: IIHEMETVariableBase{
@@ -13,6 +13,7 @@ public:
   const std::string       Name(){ return       name_ ; }
   const std::string BranchName(){ return branchName_ ; }
   const int         branchType(){ return branchType_ ; }
+  const BranchHandle&   handle(){ return     handle_ ; }
   
   virtual void reset(){} ;
   virtual void store(IIHEAnalysis*){} ;
@@ -22,6 +23,7 @@ private:
   std::string       name_ ;
   std::string branchName_ ;
   int         branchType_ ;
+  BranchHandle    handle_ ;
 };
 
 class IIHEMuonTrackVariableInt: IIHEMuonTrackVariableBase{
@@ -2,6 +2,7 @@
 #define UserCode_IIHETree_IIHEModulePreshower_h
 
 #include "UserCode/IIHETree/interface/IIHEModule.h"
+#include "UserCode/IIHETree/interface/CaloGeometryCache.h"
 
 // class decleration
 class IIHEModulePreshower : public IIHEModule {
@@ -24,7 +25,9 @@ public:
 private:
   void printPreshowerCells(int);
   
-  CaloSubdetectorGeometry* geometryPreshower_ ;
-  CaloSubdetectorTopology* topologyPreshower_ ;
+  // Used when the module runs without an IIHEAnalysis parent to share one with
+  CaloGeometryCache ownGeometry_ ;
+  const CaloSubdetectorGeometry* geometryPreshower_ ;
+  const CaloSubdetectorTopology* topologyPreshower_ ;
 };
 #endif
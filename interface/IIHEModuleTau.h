@@ -27,5 +27,15 @@ class IIHEModuleTau : public IIHEModule {
   edm::EDGetTokenT<edm::View<pat::Tau> > tauCollectionToken_;
   edm::InputTag                          tauCollectionLabel_ ;
   float ETThreshold_ ;
+  
+  // Discriminators stored as tau_<name>, and their positions in pat::Tau::tauIDs().  They
+  // are resolved on the first tau, and again whenever a tau does not match that layout.
+  void resolveTauIDs(const pat::Tau&) ;
+  bool tauIDLayoutMatches(const pat::Tau&) ;
+  std::vector<std::string> tauIDNames_ ;
+  std::vector<std::string> tauIDBranchNames_ ;
+  std::vector<int> tauIDIndices_ ;
+  unsigned int tauIDLayoutSize_ ;
+  bool tauIDsResolved_ ;
 };
 #endif
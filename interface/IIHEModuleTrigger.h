@@ -4,8 +4,11 @@
 #include "UserCode/IIHETree/interface/IIHEModule.h"
 
 #include "UserCode/IIHETree/interface/TriggerObject.h"
+#include "UserCode/IIHETree/interface/TriggerNameMatcher.h"
 #include "HLTrigger/HLTcore/interface/HLTConfigProvider.h"
 
+#include <unordered_map>
+
 // class decleration
 class IIHEModuleTrigger : public IIHEModule {
 public:
@@ -29,6 +32,8 @@ private:
   int addBranches() ;
   
   bool addHLTrigger(HLTrigger*) ;
+  static std::vector<std::string> defaultSaveFiltersTriggers() ;
+  TriggerNameMatcher saveFiltersMatcher_ ;
   std::vector<L1Trigger*> L1Triggers_ ;
   std::vector<HLTrigger*> HLTriggers_ ;
   std::vector<HLTrigger*> HLTriggersPAT_ ;
@@ -43,6 +48,34 @@ private:
   std::vector<std::string> triggerNamesFromPSet_ ;
   std::vector<std::string> savedHLTriggers_ ; 
   void clearHLTrigger(){HLTriggers_.clear();} ;
+  
+  // Filters whose objects are saved, by encoded InputTag, and their index in the current
+  // event's TriggerEvent.  The table is rebuilt when the menu changes, the indices once
+  // per event for all paths together.
+  void buildFilterTable() ;
+  void setFilterIndices(edm::Handle<trigger::TriggerEvent> const&) ;
+  std::unordered_map<std::string, int> filterSlots_ ;
+  std::vector<int> filterIndices_ ;
+  
+  // Number of trigger and filter name lookups done in beginRun and in analyze
+  long nNameResolutionsRun_ ;
+  long nNameResolutionsEvent_ ;
+  int nMenus_ ;
+  long nEventsTotal_ ;
+  
+  // Packed output: the decisions of all paths go in three vectors of bit words instead of
+  // one branch per path.  packedPathNames_ is the dictionary of bits; it only grows, so a
+  // bit keeps its meaning for the whole job.  See PackedTriggerBits.h for the reader.
+  int packedBit(const std::string&) ;
+  bool packTriggerBits_ ;
+  std::vector<std::string> packedPathNames_ ;
+  std::unordered_map<std::string, int> packedPathBits_ ;
+  std::vector<unsigned int> packedAccept_ ;
+  std::vector<unsigned int> packedRun_ ;
+  std::vector<unsigned int> packedPrescaled_ ;
+  BranchHandle packedAcceptHandle_ ;
+  BranchHandle packedRunHandle_ ;
+  BranchHandle packedPrescaledHandle_ ;
 
 
   edm::InputTag  triggerBitsLabel_;
@@ -4,6 +4,9 @@
 #include "DataFormats/Math/interface/deltaR.h"
 #include "DataFormats/Candidate/interface/Candidate.h"
 
+#include <deque>
+#include <vector>
+
 class MCTruthObject{
 private:
   const reco::Candidate* candidate_ ;
@@ -20,8 +23,9 @@ private:
 public:
   MCTruthObject(reco::Candidate*) ;
   ~MCTruthObject() ;
+  void reset(reco::Candidate*) ;
   void addMother(const reco::Candidate*) ;
-  int matchMother(std::vector<MCTruthObject*>, unsigned int) ;
+  int matchMother(const std::vector<MCTruthObject*>&, unsigned int) ;
   const reco::Candidate* getCandidate(){ return candidate_ ; }
   const reco::Candidate* getMother(unsigned int) ;
   unsigned nMothers(){ return mothers_.size() ; }
@@ -32,4 +36,18 @@ public:
   float energy() const { return energy_ ; }
 };
 
+// Owns the MCTruthObjects of one event.  Objects are recycled rather than freed when the
+// pool is reset, so after the first few events no memory is allocated for them.
+class MCTruthObjectPool{
+private:
+  std::deque<MCTruthObject> objects_ ;
+  unsigned int nUsed_ ;
+public:
+  MCTruthObjectPool(): nUsed_(0){} ;
+  ~MCTruthObjectPool(){} ;
+  MCTruthObject* create(reco::Candidate*) ;
+  void reset(){ nUsed_ = 0 ; }
+  unsigned int capacity() const { return objects_.size() ; }
+};
+
 #endif
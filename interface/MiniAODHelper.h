@@ -152,6 +152,11 @@ class MiniAODHelper{
   virtual std::vector<pat::Electron> GetSelectedElectrons(const std::vector<pat::Electron>&, const float, const electronID::electronID, const float = 2.4);
   std::vector<pat::Tau> GetSelectedTaus(const std::vector<pat::Tau>&, const float, const tauu::ID);
   std::vector<pat::PackedCandidate> GetPackedCandidates(void);
+  // Views: pointers into the input collections (which must outlive them) instead of copies
+  std::vector<const pat::Muon*> GetSelectedMuonPtrs(const std::vector<pat::Muon>&, const float, const muonID::muonID, const coneSize::coneSize = coneSize::R04, const corrType::corrType = corrType::deltaBeta, const float = 2.4);
+  std::vector<const pat::Electron*> GetSelectedElectronPtrs(const std::vector<pat::Electron>&, const float, const electronID::electronID, const float = 2.4);
+  std::vector<const pat::Tau*> GetSelectedTauPtrs(const std::vector<pat::Tau>&, const float, const tauu::ID);
+  const std::vector<pat::PackedCandidate>& GetPackedCandidatesRef(void) const;
   bool passesMuonPOGIdTight(const pat::Muon&);
   bool passesMuonPOGIdICHEPMedium(const pat::Muon&);
 
@@ -204,10 +209,14 @@ class MiniAODHelper{
   double GetPUWeight(const edm::Event& iEvent) const { return puWeightProducer_(iEvent); }
 
 
+  // These work on collections of objects as well as of pointers (eg from GetSelectedMuonPtrs),
+  // in which case only the pointers are copied.  RemoveOverlaps of pointers returns objects,
+  // since it changes their momenta.
   template <typename T> T GetSortedByPt(const T&);
   template <typename T> T GetSortedByCSV(const T&);
   template <typename T, typename S> std::vector<T> RemoveOverlaps( const std::vector<S>&, const std::vector<T>& );
   template <typename T, typename S> T RemoveOverlap( const std::vector<S>&, const T& );
+  template <typename T, typename S> std::vector<T> RemoveOverlaps( const std::vector<S>&, const std::vector<const T*>& );
 
   template <typename T, typename S> double DeltaR( const S&, const T& ) const;
   template <typename T, typename S> std::vector<T> GetDifference( const std::vector<S>&, const std::vector<T>& );
@@ -233,7 +242,39 @@ class MiniAODHelper{
   const std::vector<pat::PackedCandidate> * allcands_;
   std::vector<const pat::PackedCandidate *> charged_, neutral_, pileup_;
   //  mutable std::vector<float> weights_;
-  std::vector<const reco::Candidate *> vetos_;
+  std::vector<const reco::Candidate *> vetos_;  // kept sorted, for binary searches
+
+  // charged_, neutral_ and pileup_ split into phi slices, each in eta order, with the
+  // positions of the candidates in the full list.  isoSumRaw only reads the eta window
+  // of the slices that overlap the cone.
+  struct CandidateSlices {
+    std::vector<std::vector<double> > etas;
+    std::vector<std::vector<int> > positions;
+  };
+  static const int nPhiSlices_ = 64;
+  CandidateSlices chargedSlices_, neutralSlices_, pileupSlices_;
+  static int GetPhiSlice(double phi);
+  void FillCandidateSlices(const std::vector<const pat::PackedCandidate *> & cands, CandidateSlices & slices);
+  const CandidateSlices * GetCandidateSlices(const std::vector<const pat::PackedCandidate *> & cands) const;
+  float MuonMiniIsoFromSums(const pat::Muon&, const corrType::corrType, double miniIsoR, double pfIsoCharged, double pfIsoNeutral, double miniAbsIsoPU, std::map<std::string,double>* miniIso_calculation_params) const;
+  float ElectronMiniIsoFromSums(const pat::Electron&, const corrType::corrType, const effAreaType::effAreaType, double miniIsoR, double pfIsoCharged, double pfIsoNeutral, double miniAbsIsoPU, std::map<std::string,double>* miniIso_calculation_params) const;
+  mutable std::vector<int> coneCands_;
+  mutable std::vector<const reco::Candidate *> selfVetos_;
+
+  // Source candidates of a collection, sorted, so that RemoveOverlaps looks each source of
+  // an object up instead of comparing it to all sources of all other objects
+  struct OverlapSource {
+    reco::CandidatePtr source;
+    unsigned int object, index;
+    bool operator<(const OverlapSource& other) const { return source < other.source; }
+  };
+  template <typename S> std::vector<OverlapSource> GetOverlapSources( const std::vector<S>& ) const;
+  template <typename T> T RemoveIndexedOverlap( const std::vector<OverlapSource>&, const T& ) const;
+  // Positions of a collection sorted by eta, for the same-direction lookups of GetDifference
+  // and GetUnion
+  template <typename S> std::vector<std::pair<double,unsigned int> > GetEtaIndex( const std::vector<S>& ) const;
+  template <typename T, typename S> int FindSameDirection( const std::vector<std::pair<double,unsigned int> >&, const std::vector<S>&, const T& ) const;
+
   reco::Vertex vertex;
 
   PUWeightProducer puWeightProducer_;
@@ -298,24 +339,22 @@ template <typename PATObj1, typename PATObj2>
 std::vector<PATObj1> MiniAODHelper::GetDifference(const std::vector<PATObj2>& col2,const std::vector<PATObj1>& col1 ){
 
   std::vector<PATObj1> difference;
+  std::vector<std::pair<double,unsigned int> > index2 = GetEtaIndex(col2);
 
   for( typename std::vector<PATObj1>::const_iterator iobj1 = col1.begin(); iobj1!=col1.end(); ++iobj1 ){
-    bool presentInSecondCollection = false;
-    for( typename std::vector<PATObj2>::const_iterator iobj2 = col2.begin(); iobj1!=col2.end(); ++iobj2 ){
-      if(DeltaR(iobj1,iobj2) < 0.00001){
-	presentInSecondCollection = true;
-	bool sameMomentum = (fabs(ptr(*iobj1)->px() - ptr(*iobj2)->px()) < 0.00001) &&
-	  (fabs(ptr(*iobj1)->py() - ptr(*iobj2)->py()) < 0.00001) &&
-	  (fabs(ptr(*iobj1)->pz() - ptr(*iobj2)->pz()) < 0.00001);
-	if(!sameMomentum){ cerr << "ERROR: found two objects with same eta and phi, but different momenta. This may be caused by mixing corrected and uncorrected collections." << endl;
-	  cout << setprecision(7) << "Eta1: " << ptr(*iobj1)->eta() << "\tPhi1: " << ptr(*iobj1)->phi() << "\tpT1: " << ptr(*iobj1)->pt() << endl;
-	  cout << setprecision(7) << "Eta2: " << ptr(*iobj2)->eta() << "\tPhi2: " << ptr(*iobj2)->phi() << "\tpT2: " << ptr(*iobj2)->pt() << endl;
-	  throw std::logic_error("Inside GetDifference");
-	}
-	break;
+    int found = FindSameDirection(index2, col2, *iobj1);
+    if( found>=0 ){
+      const PATObj2& obj2 = col2[found];
+      bool sameMomentum = (fabs(ptr(*iobj1)->px() - ptr(obj2)->px()) < 0.00001) &&
+	(fabs(ptr(*iobj1)->py() - ptr(obj2)->py()) < 0.00001) &&
+	(fabs(ptr(*iobj1)->pz() - ptr(obj2)->pz()) < 0.00001);
+      if(!sameMomentum){ cerr << "ERROR: found two objects with same eta and phi, but different momenta. This may be caused by mixing corrected and uncorrected collections." << endl;
+	cout << setprecision(7) << "Eta1: " << ptr(*iobj1)->eta() << "\tPhi1: " << ptr(*iobj1)->phi() << "\tpT1: " << ptr(*iobj1)->pt() << endl;
+	cout << setprecision(7) << "Eta2: " << ptr(obj2)->eta() << "\tPhi2: " << ptr(obj2)->phi() << "\tpT2: " << ptr(obj2)->pt() << endl;
+	throw std::logic_error("Inside GetDifference");
       }
     }
-    if(!presentInSecondCollection){ difference.push_back(*iobj1); }
+    else{ difference.push_back(*iobj1); }
   }
   // Sort by descending pT
   return GetSortedByPt(difference);
@@ -326,29 +365,51 @@ template <typename PATObj1, typename PATObj2>
 std::vector<PATObj1> MiniAODHelper::GetUnion(const std::vector<PATObj2>& col2,const std::vector<PATObj1>& col1 ){
 
   std::vector<PATObj1> unions = col1;
+  std::vector<std::pair<double,unsigned int> > index1 = GetEtaIndex(col1);
 
   for( typename std::vector<PATObj2>::const_iterator iobj2 = col2.begin(); iobj2!=col2.end(); ++iobj2 ){
-    bool presentInSecondCollection = false;
-    for( typename std::vector<PATObj1>::const_iterator iobj1 = col1.begin(); iobj1!=col1.end(); ++iobj1 ){
-      if(DeltaR(iobj1,iobj2) < 0.00001){
-	presentInSecondCollection = true;
-	bool sameMomentum = (fabs(ptr(*iobj1)->px() - ptr(*iobj2)->px()) < 0.00001) &&
-	  (fabs(ptr(*iobj1)->py() - ptr(*iobj2)->py()) < 0.00001) &&
-	  (fabs(ptr(*iobj1)->pz() - ptr(*iobj2)->pz()) < 0.00001);
-	if(!sameMomentum){ cerr << "ERROR: found two objects with same eta and phi, but different momenta. This may be caused by mixing corrected and uncorrected collections." << endl;
-	  cout << setprecision(7) << "Eta1: " << ptr(*iobj1)->eta() << "\tPhi1: " << ptr(*iobj1)->phi() << "\tpT1: " << ptr(*iobj1)->pt() << endl;
-	  cout << setprecision(7) << "Eta2: " << ptr(*iobj2)->eta() << "\tPhi2: " << ptr(*iobj2)->phi() << "\tpT2: " << ptr(*iobj2)->pt() << endl;
-	  throw std::logic_error("Inside GetUnion");
-	}
-	break;
+    int found = FindSameDirection(index1, col1, *iobj2);
+    if( found>=0 ){
+      const PATObj1& obj1 = col1[found];
+      bool sameMomentum = (fabs(ptr(obj1)->px() - ptr(*iobj2)->px()) < 0.00001) &&
+	(fabs(ptr(obj1)->py() - ptr(*iobj2)->py()) < 0.00001) &&
+	(fabs(ptr(obj1)->pz() - ptr(*iobj2)->pz()) < 0.00001);
+      if(!sameMomentum){ cerr << "ERROR: found two objects with same eta and phi, but different momenta. This may be caused by mixing corrected and uncorrected collections." << endl;
+	cout << setprecision(7) << "Eta1: " << ptr(obj1)->eta() << "\tPhi1: " << ptr(obj1)->phi() << "\tpT1: " << ptr(obj1)->pt() << endl;
+	cout << setprecision(7) << "Eta2: " << ptr(*iobj2)->eta() << "\tPhi2: " << ptr(*iobj2)->phi() << "\tpT2: " << ptr(*iobj2)->pt() << endl;
+	throw std::logic_error("Inside GetUnion");
       }
     }
-    if(!presentInSecondCollection){ unions.push_back(*iobj2); }
+    else{ unions.push_back(*iobj2); }
   }
   // Sort by descending pT
   return GetSortedByPt(unions);
 }
 
+template <typename PATObj2>
+std::vector<std::pair<double,unsigned int> > MiniAODHelper::GetEtaIndex( const std::vector<PATObj2>& col ) const {
+
+  std::vector<std::pair<double,unsigned int> > index;
+  for( unsigned int i=0; i<col.size(); i++ ) index.push_back(std::make_pair(ptr(col[i])->eta(), i));
+  std::sort(index.begin(), index.end());
+  return index;
+}
+
+// === Position in col of the first object within DeltaR 0.00001 of obj, or -1 === //
+template <typename PATObj1, typename PATObj2>
+int MiniAODHelper::FindSameDirection( const std::vector<std::pair<double,unsigned int> >& index, const std::vector<PATObj2>& col, const PATObj1& obj ) const {
+
+  // |deta| <= DeltaR, so only the narrow eta window can match; the margin covers rounding
+  double eta = ptr(obj)->eta();
+  std::vector<std::pair<double,unsigned int> >::const_iterator it = std::lower_bound(index.begin(), index.end(), std::make_pair(eta - 0.00002, 0u));
+  int found = -1;
+  for( ; it!=index.end() && it->first <= eta + 0.00002; ++it ){
+    if( found>=0 && int(it->second)>found ) continue;
+    if( DeltaR(ptr(obj), ptr(col[it->second])) < 0.00001 ) found = it->second;
+  }
+  return found;
+}
+
 
 template <typename PATObj1, typename PATObj2>
 PATObj1 MiniAODHelper::RemoveOverlap( const std::vector<PATObj2>& other, const PATObj1& unclean ){
@@ -401,17 +462,88 @@ PATObj1 MiniAODHelper::RemoveOverlap( const std::vector<PATObj2>& other, const P
 }
 
 
+template <typename PATObj2>
+std::vector<MiniAODHelper::OverlapSource> MiniAODHelper::GetOverlapSources( const std::vector<PATObj2>& other ) const {
+
+  std::vector<OverlapSource> sources;
+  for( unsigned int i2=0; i2<other.size(); i2++ ){
+    unsigned int nSources2 = ptr(other[i2])->numberOfSourceCandidatePtrs();
+    for( unsigned int j2=0; j2<nSources2; j2++ ){
+      reco::CandidatePtr source2 = ptr(other[i2])->sourceCandidatePtr(j2);
+      if( !(source2.isNonnull() && source2.isAvailable()) ) continue;
+      OverlapSource s = {source2, i2, j2};
+      sources.push_back(s);
+    }
+  }
+  // stable, so that the sources shared with an object come out in the order of the loops
+  // in RemoveOverlap
+  std::stable_sort(sources.begin(), sources.end());
+  return sources;
+}
+
+// === Same as RemoveOverlap(other, unclean), with the sources of other from GetOverlapSources === //
+template <typename PATObj1>
+PATObj1 MiniAODHelper::RemoveIndexedOverlap( const std::vector<OverlapSource>& sources, const PATObj1& unclean ) const {
+
+  unsigned int nSources1 = unclean.numberOfSourceCandidatePtrs();
+
+  // (object, source of unclean, source of object): the order RemoveOverlap finds them in,
+  // so that the momenta are subtracted in the same order
+  std::vector<std::pair<std::pair<unsigned int,unsigned int>,unsigned int> > overlaps;
+
+  for( unsigned int i1=0; i1<nSources1; i1++ ){
+    reco::CandidatePtr source1 = unclean.sourceCandidatePtr(i1);
+
+    if( !(source1.isNonnull() && source1.isAvailable()) ) continue;
+
+    OverlapSource key = {source1, 0, 0};
+    typename std::vector<OverlapSource>::const_iterator it = std::lower_bound(sources.begin(), sources.end(), key);
+    for( ; it!=sources.end() && it->source==source1; ++it ){
+      overlaps.push_back(std::make_pair(std::make_pair(it->object, i1), it->index));
+    }
+  }
+
+  PATObj1 cleaned = unclean;
+  if( !overlaps.empty() ){
+    std::sort(overlaps.begin(), overlaps.end());
+    math::XYZTLorentzVector original = cleaned.p4();
+
+    for( unsigned int iOverlap=0; iOverlap<overlaps.size(); iOverlap++ ){
+
+      const reco::Candidate & cOverlap = *(unclean.sourceCandidatePtr(overlaps[iOverlap].first.second));
+      math::XYZTLorentzVector overlaper = cOverlap.p4();
+
+      original -= overlaper;
+    }
+
+    cleaned.setP4( original );
+  }
+
+  return cleaned;
+}
+
+
 template <typename PATObj1, typename PATObj2>
 std::vector<PATObj1> MiniAODHelper::RemoveOverlaps( const std::vector<PATObj2>& other, const std::vector<PATObj1>& unclean ){
 
   std::vector<PATObj1> cleaned;
+  std::vector<OverlapSource> sources = GetOverlapSources(other);
 
   for( typename std::vector<PATObj1>::const_iterator iobj1 = unclean.begin(); iobj1!=unclean.end(); ++iobj1 ){
+    cleaned.push_back(RemoveIndexedOverlap(sources, *iobj1));
+  }
 
-    PATObj1 myobj = (*iobj1);
-    PATObj1 clean = RemoveOverlap(other, myobj);
+  return cleaned;
+}
+
+template <typename PATObj1, typename PATObj2>
+std::vector<PATObj1> MiniAODHelper::RemoveOverlaps( const std::vector<PATObj2>& other, const std::vector<const PATObj1*>& unclean ){
+
+  std::vector<PATObj1> cleaned;
+  std::vector<OverlapSource> sources = GetOverlapSources(other);
 
-    cleaned.push_back(clean);
+  for( typename std::vector<const PATObj1*>::const_iterator iobj1 = unclean.begin(); iobj1!=unclean.end(); ++iobj1 ){
+    cleaned.push_back(RemoveIndexedOverlap(sources, **iobj1));
   }
 
   return cleaned;
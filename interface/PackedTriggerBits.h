@@ -0,0 +1,61 @@
+#ifndef UserCode_IIHETree_PackedTriggerBits_h
+#define UserCode_IIHETree_PackedTriggerBits_h
+
+// Trigger decisions packed one bit per path into vectors of 32 bit words, as written by
+// IIHEModuleTrigger with packTriggerBits=True.  Path i of the dictionary
+// (trig_packedPathNames in the meta tree, path names without the _v suffix) is bit i%32
+// of word i/32.  The dictionary only grows during a job, so words from early events may
+// be shorter than the dictionary; the missing bits are 0.
+//
+// Header only, with no CMSSW dependencies, so that it can also be used when reading the
+// ntuples back, eg in a ROOT macro:
+//   std::vector<std::string>* names = 0 ;
+//   meta->SetBranchAddress("trig_packedPathNames", &names) ;
+//   meta->GetEntry(0) ;
+//   PackedTriggerBits bits(*names) ;
+//   ...
+//   bool pass = bits.test(*trig_packedAccept, "HLT_Ele27_WPTight_Gsf") ;
+
+#include <map>
+#include <string>
+#include <vector>
+
+class PackedTriggerBits{
+private:
+  std::map<std::string, int> bits_ ;
+  std::vector<std::string> names_ ;
+public:
+  PackedTriggerBits(){} ;
+  explicit PackedTriggerBits(const std::vector<std::string>& names){
+    names_ = names ;
+    for(unsigned int i=0 ; i<names.size() ; ++i) bits_.insert(std::make_pair(names.at(i), (int) i)) ;
+  }
+
+  // Bit of a path, or -1 if it is not in the dictionary
+  int bit(const std::string& name) const {
+    std::map<std::string, int>::const_iterator it = bits_.find(name) ;
+    return (it==bits_.end()) ? -1 : it->second ;
+  }
+  bool test(const std::vector<unsigned int>& words, const std::string& name) const {
+    return test(words, bit(name)) ;
+  }
+
+  // Per path booleans, in the same form as the trig_<path>_accept branches
+  std::map<std::string, bool> unpack(const std::vector<unsigned int>& words) const {
+    std::map<std::string, bool> result ;
+    for(unsigned int i=0 ; i<names_.size() ; ++i) result[names_.at(i)] = test(words, i) ;
+    return result ;
+  }
+
+  static bool test(const std::vector<unsigned int>& words, int bit){
+    if(bit<0 || bit/32>=(int)words.size()) return false ;
+    return (words.at(bit/32) >> (bit%32)) & 1u ;
+  }
+  static void set(std::vector<unsigned int>& words, int bit){
+    if(bit<0) return ;
+    if(bit/32>=(int)words.size()) words.resize(bit/32+1, 0) ;
+    words.at(bit/32) |= (1u << (bit%32)) ;
+  }
+};
+
+#endif
@@ -1,10 +1,26 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <stdint.h>
 #include "TRandom3.h"
 #include "TMath.h"
+
+// One muon of the batch corrections of RoccoR.  gt is the matched generator pt
+// (kScaleFromGenMC only), u and w are the uniform random numbers of the per-muon calls.
+struct RocMuon{
+    int Q;
+    double pt;
+    double eta;
+    double phi;
+    int n;
+    double gt;
+    double u;
+    double w;
+};
+
 struct CrystalBalll{
     double m;
     double s;
@@ -25,6 +41,20 @@ struct CrystalBalll{
 
     double cdfMa;
     double cdfPa;
+
+    // Inverse cdf of the core (|d|<a), tabulated by buildTable: nodes evenly spaced in d
+    // with u and x at each, and per interval the tangents of a monotone cubic Hermite
+    // interpolation in u.  The tails are closed form and stay exact.  requestTable only
+    // notes the tolerance, and the table is built by the first invcdf, so that the
+    // CrystalBalls no muon falls into cost nothing.
+    mutable std::vector<double> tabU;
+    mutable std::vector<double> tabX;
+    mutable std::vector<double> tabM0;
+    mutable std::vector<double> tabM1;
+    mutable std::vector<int> tabGuide;   // first interval of each of tabGuide.size() equal steps in u
+    mutable double tabGuideScale;
+    mutable double tabTol;
+    mutable double tabPendingTol;        // tolerance of the table still to be built, or 0
     const double pi    = TMath::Pi();
     const double SPiO2 = sqrt(TMath::Pi()/2.0);
     const double S2    = sqrt(2.0);
@@ -63,6 +93,8 @@ struct CrystalBalll{
 
 	cdfMa=cdf(m-a*s);
 	cdfPa=cdf(m+a*s);
+
+	clearTable();
     }
 
     double pdf(double x) const{ 
@@ -86,11 +118,124 @@ struct CrystalBalll{
 	return Ns*(D-SPiO2*erf(-d/S2));
     }
 
-    double invcdf(double u) const{
+    double invcdfExact(double u) const{
 	if(u<cdfMa) return m + G*(F - pow(NC/u,    k) );
 	if(u>cdfPa) return m - G*(F - pow(C-u/NC, -k) );
 	return m - S2*s*TMath::ErfInverse((D - u/Ns ) / SPiO2);
     }
+
+    double invcdf(double u) const{
+	if(tabPendingTol>0) buildTable(tabPendingTol);
+	if(tabU.empty() || u<cdfMa || u>cdfPa) return invcdfExact(u);
+	int last = tabU.size()-2;
+	int j = std::min(std::max(int((u-tabU[0])*tabGuideScale), 0), int(tabGuide.size())-1);
+	int i = tabGuide[j];
+	while(i<last && tabU[i+1]<=u) ++i;
+	while(i>0 && tabU[i]>u) --i;
+	double du = tabU[i+1]-tabU[i];
+	if(!(du>0)) return tabX[i];
+	double t  = (u-tabU[i])/du;
+	double t1 = 1-t;
+	return (1+2*t)*t1*t1*tabX[i] + t*t1*t1*tabM0[i] + t*t*(3-2*t)*tabX[i+1] - t*t*t1*tabM1[i];
+    }
+
+    void clearTable() const{
+	tabPendingTol=0;
+	tabU.clear();
+	tabX.clear();
+	tabM0.clear();
+	tabM1.clear();
+	tabGuide.clear();
+	tabGuideScale=0;
+	tabTol=0;
+    }
+
+    void fillTable(int nint) const{
+	clearTable();
+	for(int i=0; i<=nint; ++i){
+	    double u = cdf(m + s*a*(2.0*i/nint-1));
+	    tabU.push_back(u);
+	    tabX.push_back(invcdfExact(u));
+	}
+	for(int i=0; i<nint; ++i){
+	    double du = tabU[i+1]-tabU[i];
+	    double dx = tabX[i+1]-tabX[i];
+	    // dx/du=1/pdf at the ends, limited to 3 times the secant so that the cubic stays
+	    // monotone (Fritsch-Carlson)
+	    double m0 = du/pdf(tabX[i]);
+	    double m1 = du/pdf(tabX[i+1]);
+	    if(!(m0>=0 && m0<=3*dx)) m0 = dx>0 ? std::min(3*dx, std::max(m0, 0.0)) : 0;
+	    if(!(m1>=0 && m1<=3*dx)) m1 = dx>0 ? std::min(3*dx, std::max(m1, 0.0)) : 0;
+	    tabM0.push_back(m0);
+	    tabM1.push_back(m1);
+	}
+	tabGuideScale = nint/(tabU[nint]-tabU[0]);
+	for(int j=0, i=0; j<nint; ++j){
+	    while(i<nint-1 && tabU[i+1]<=tabU[0]+j/tabGuideScale) ++i;
+	    tabGuide.push_back(i);
+	}
+    }
+
+    // Largest |invcdf-invcdfExact| at the quarter points of every interval of the table
+    double maxTableDeviation() const{
+	double dev = 0;
+	for(unsigned int i=0; i+1<tabU.size(); ++i){
+	    for(int j=1; j<4; ++j){
+		double u = tabU[i] + (tabU[i+1]-tabU[i])*j/4.0;
+		double e = fabs(invcdf(u)-invcdfExact(u));
+		if(e>dev || e!=e) dev = e;
+	    }
+	}
+	return dev;
+    }
+
+    // Tabulate the core with the number of nodes doubled until the interpolation is
+    // within tol of the exact inverse (in units of x).  If that cannot be reached, or
+    // tol<=0, there is no table and invcdf is exact.
+    void buildTable(double tol) const{
+	clearTable();
+	if(!(tol>0) || !(a>0) || !(cdfPa>cdfMa)) return;
+	for(int nint=16; nint<=(1<<12); nint*=2){
+	    fillTable(nint);
+	    if(maxTableDeviation()<=tol){
+		tabTol=tol;
+		return;
+	    }
+	}
+	clearTable();
+    }
+
+    // Whether a table read back from a cache is one buildTable could have made: nodes
+    // increasing from cdfMa to cdfPa, and a guide that only points at intervals of them
+    bool checkTable() const{
+	int nint = int(tabU.size())-1;
+	if(nint<1 || tabU[0]!=cdfMa || tabU[nint]!=cdfPa || !(tabTol>0)) return false;
+	if(tabX.size()!=tabU.size() || tabM0.size()!=size_t(nint) || tabM1.size()!=size_t(nint) || tabGuide.size()!=size_t(nint)) return false;
+	for(int i=0; i<nint; ++i) if(!(tabU[i]<tabU[i+1])) return false;
+	if(tabGuideScale!=nint/(tabU[nint]-tabU[0])) return false;
+	for(int j=0; j<nint; ++j){
+	    if(tabGuide[j]<0 || tabGuide[j]>nint-1 || (j>0 && tabGuide[j]<tabGuide[j-1])) return false;
+	}
+	return true;
+    }
+
+    // Have buildTable(tol) run by the first invcdf
+    void requestTable(double tol){
+	clearTable();
+	if(tol>0) tabPendingTol=tol;
+    }
+
+    // Largest |invcdf-invcdfExact| over nSample points evenly spread over (0,1), and the
+    // points where the table is furthest from the nodes
+    double maxInvcdfDeviation(int nSample=100000) const{
+	double dev = maxTableDeviation();
+	for(int i=0; i<nSample; ++i){
+	    double u = (i+0.5)/nSample;
+	    double e = fabs(invcdf(u)-invcdfExact(u));
+	    if(e>dev || e!=e) dev = e;
+	}
+	return dev;
+    }
 };
 
 
@@ -118,7 +263,12 @@ class RocRes{
 	double kDat[NMAXETA];
 	double kRes[NMAXETA];
 
+	double invcdfTol;
+
+	bool sortedEdges;   // all bin edges increasing, so getBin can search them
+
 	int getBin(double x, const int NN, const double *b) const;
+	void checkEdges();
 
 
     public:
@@ -136,6 +286,10 @@ class RocRes{
 
 	void reset();
 
+	// The parsed parameters as raw bytes, for the binary cache of RoccoR
+	void write(std::string& buf) const;
+	bool read(const char*& p, const char* end);
+
 	~RocRes(){}
 
 	double Sigma(double pt, int H, int F) const;
@@ -143,8 +297,20 @@ class RocRes{
 	double kSmear(double pt, double eta, TYPE type, double v, double u) const;
 	double kSmear(double pt, double eta, TYPE type, double v, double u, int n) const;
 	double kExtra(double pt, double eta, int nlayers, double u, double w) const;
+	// Same as kSpread and kExtra, with H=getEtaBin(fabs(eta))
+	double kSpreadBin(double gpt, double rpt, int H, int nlayers, double w) const;
+	double kExtraBin(double pt, int H, int nlayers, double u, double w) const;
 	double getkDat(int H) const{return kDat[H];}
 	double getkRes(int H) const{return kRes[H];}
+
+	// The inverse cdfs of cb are tabulated to within this tolerance (in units of the
+	// CrystalBall variable), each one the first time it is used.  0, the default, keeps
+	// them exact; a tolerance should be checked with validateInvcdf before it is used.
+	static const double DEFAULT_INVCDF_TOL;
+	void setInvcdfTolerance(double tol);
+	double getInvcdfTolerance() const{return invcdfTol;}
+	// Largest deviation of the tabulated inverse cdfs from the exact ones
+	double validateInvcdf(int nSample=100000) const;
 };
 
 
@@ -166,8 +332,12 @@ class RocOne{
 
 	RocRes RR;
 
+	bool sortedEdges;
+
 	int getBin(double x, const int NN, const double *b) const;
 	int getBin(double x, const int nmax, const double xmin, const double dx) const;
+	double kScale(int T, int Q, double pt, int H, int F) const;
+	void getBins(const std::vector<RocMuon>& muons, std::vector<int>& H, std::vector<int>& F, std::vector<int>& R) const;
 
     public:
 	enum TYPE{MC, DT};
@@ -180,6 +350,8 @@ class RocOne{
 	bool checkTIGHT(int iTYPE, int iSYS, int iMEM, int kTYPE=0, int kSYS=0, int kMEM=0);
 	void reset();
 	void init(std::string filename, int iTYPE=0, int iSYS=0, int iMEM=0);
+	void write(std::string& buf) const;
+	bool read(const char*& p, const char* end);
 
 	double kScaleDT(int Q, double pt, double eta, double phi) const;
 	double kScaleMC(int Q, double pt, double eta, double phi, double kSMR=1) const;
@@ -187,10 +359,15 @@ class RocOne{
 	double kScaleFromGenMC(int Q, double pt, double eta, double phi, int n, double gt, double w) const;
 	double kGenSmear(double pt, double eta, double v, double u, RocRes::TYPE TT=RocRes::Data) const;
 
+	void kScaleDT(const std::vector<RocMuon>& muons, std::vector<double>& k) const;
+	void kScaleAndSmearMC(const std::vector<RocMuon>& muons, std::vector<double>& k, TRandom* rnd=0) const;
+	void kScaleFromGenMC(const std::vector<RocMuon>& muons, std::vector<double>& k, TRandom* rnd=0) const;
+
 	double getM(int T, int H, int F) const{return M[T][H][F];}
 	double getA(int T, int H, int F) const{return A[T][H][F];}
 	double getK(int T, int H) const{return T==DT?RR.getkDat(H):RR.getkRes(H);}
 	RocRes& getR() {return RR;}
+	const RocRes& getR() const {return RR;}
 };
 
 
@@ -198,16 +375,35 @@ class RoccoR{
     public:
 	RoccoR(); 
 	RoccoR(std::string dirname); 
+	RoccoR(std::string dirname, std::string cachename); 
 	~RoccoR();
 
 	void init(std::string dirname);
 
+	// Binary cache of the parsed parameters.  init(dirname, cachename) loads the cache if
+	// it was written from the same text files (same textChecksum), and otherwise reads the
+	// text files and rewrites the cache.  readCache with checksum 0 skips that check; the
+	// checksum of the cache's own contents is always checked.
+	void init(std::string dirname, std::string cachename);
+	bool readCache(std::string cachename, uint64_t checksum);
+	bool writeCache(std::string cachename, uint64_t checksum) const;
+	static uint64_t textChecksum(std::string dirname);
+
 	double kGenSmear(double pt, double eta, double v, double u, RocRes::TYPE TT=RocRes::Data, int s=0, int m=0) const;
 	double kScaleDT(int Q, double pt, double eta, double phi, int s=0, int m=0) const;
 
 	double kScaleAndSmearMC(int Q, double pt, double eta, double phi, int n, double u, double w, int s=0, int m=0) const;  
 	double kScaleFromGenMC(int Q, double pt, double eta, double phi, int n, double gt, double w, int s=0, int m=0) const; 
 
+	// Whole collections in one call: k[i] is what the per-muon call gives for muons[i].
+	// The bins of all muons are looked up first.  With rnd, u and w are drawn from it
+	// instead of taken from the muons, muon by muon in the order of the arguments of the
+	// per-muon call (u then w; only w for kScaleFromGenMC), so the same seed gives the
+	// same corrections as a loop drawing them before each call.
+	void kScaleDT(const std::vector<RocMuon>& muons, std::vector<double>& k, int s=0, int m=0) const;
+	void kScaleAndSmearMC(const std::vector<RocMuon>& muons, std::vector<double>& k, int s=0, int m=0, TRandom* rnd=0) const;
+	void kScaleFromGenMC(const std::vector<RocMuon>& muons, std::vector<double>& k, int s=0, int m=0, TRandom* rnd=0) const;
+
 
 	double getM(int T, int H, int F, int E=0, int m=0) const{return RC[E][m].getM(T,H,F);}
 	double getA(int T, int H, int F, int E=0, int m=0) const{return RC[E][m].getA(T,H,F);}
@@ -216,6 +412,11 @@ class RoccoR{
 	int Nset() const{return RC.size();}
 	int Nmem(int s=0) const{return RC[s].size();}
 
+	// Tolerance of the tabulated CrystalBall inverse cdfs (RocRes::setInvcdfTolerance) of
+	// all sets, and the largest deviation from the exact inverse over all of them
+	void setInvcdfTolerance(double tol);
+	double validateInvcdf(int nSample=100000) const;
+
     private:
 	std::vector<std::vector<RocOne> > RC;
 };
@@ -0,0 +1,37 @@
+#ifndef UserCode_IIHETree_TriggerNameMatcher_h
+#define UserCode_IIHETree_TriggerNameMatcher_h
+
+// Counts how often each of a fixed set of substrings occurs in a trigger name, for all of
+// them in one pass over the name (Aho-Corasick automaton).  The count of each pattern is
+// the same as HLTrigger::nSubstringInString gives: occurrences that do not overlap each
+// other, taken from the left.
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class TriggerNameMatcher{
+private:
+  struct Node{
+    int next[128] ;           // goto function, completed with the failure links
+    std::vector<int> outputs ;// patterns ending here, including via suffix links
+  } ;
+  std::vector<Node> nodes_ ;
+  std::vector<std::string> patterns_ ;
+  std::unordered_map<std::string, int> indices_ ;
+  int newNode() ;
+public:
+  TriggerNameMatcher(){} ;
+  explicit TriggerNameMatcher(const std::vector<std::string>&) ;
+  ~TriggerNameMatcher(){} ;
+
+  // Number of occurrences of every pattern, in the order they were given
+  void count(const std::string&, std::vector<int>&) const ;
+  bool matchesAny(const std::string&) const ;
+
+  // Index of a pattern, or -1 if the matcher was not built with it
+  int index(const std::string&) const ;
+  unsigned int size() const { return patterns_.size() ; }
+};
+
+#endif
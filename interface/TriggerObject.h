@@ -31,11 +31,17 @@ class TriggerFilter{
   std::string etaBranchName_ ;
   std::string phiBranchName_ ;
   int index_ ;
+  int slot_ ;
 public:
   TriggerFilter(std::string, std::string);
   ~TriggerFilter(){} ;
   int createBranches(IIHEAnalysis*) ;
   int setIndex(edm::Handle<trigger::TriggerEvent>, edm::InputTag) ;
+  void setIndex(int index){ index_ = index ; }
+  std::string name(){ return name_ ; }
+  // Position of this filter in the per run filter table of IIHEModuleTrigger
+  void setSlot(int slot){ slot_ = slot ; }
+  int slot(){ return slot_ ; }
   int setValues(edm::Handle<trigger::TriggerEvent>, IIHEAnalysis*) ;
   bool store(IIHEAnalysis* analysis) ;
 };
@@ -79,6 +85,8 @@ private:
   int  searchStatus_ ;
   bool saveFilters_;
   bool savePrescale_; 
+  std::vector<unsigned int> prescales_ ; // one per prescale set, filled in beginRun
+  int bit_ ; // position in the packed trigger words
  
   std::vector<float> etaValues_ ;
   std::vector<float> phiValues_ ;
@@ -115,25 +123,35 @@ private:
   int METInTriggerName() ;
   int HTInTriggerName() ;
   int ALCaInTriggerName() ;
+  int nPatternInName(const std::string&) ;
+  std::vector<int> patternCounts_ ;
   
 public:
-  HLTrigger(std::string, HLTConfigProvider) ;
+  HLTrigger(std::string, HLTConfigProvider const&) ;
   ~HLTrigger() ;
   void reset() ;
   int createBranches(IIHEAnalysis*) ;
+  int createFilterBranches(IIHEAnalysis*) ;
   bool  beginRun(HLTConfigProvider const&) ;
   int nSubstringInString(const std::string&, const std::string&) ; 
  
   int findIndex(HLTConfigProvider const&) ;
-  int fullStatus(const edm::Event&, edm::EventSetup const&, HLTConfigProvider const&, int, Handle<TriggerResults> const&, edm::Handle<trigger::TriggerEvent>, edm::InputTag, IIHEAnalysis*) ;
+  int fullStatus(int, Handle<TriggerResults> const&, edm::Handle<trigger::TriggerEvent>, std::vector<int> const&, IIHEAnalysis*) ;
 
   int status(Handle<TriggerResults> const&) ;
   void store(IIHEAnalysis*) ;
+  void storeFilters(IIHEAnalysis*) ;
   
   bool addFilter(std::string) ;
   std::string name(){ return name_ ; }
+  // Name without the version suffix, as used for the branches
+  std::string baseName(){ return name_.substr(0, name_.find("_v")) ; }
   void setIndex(int index){ index_ = index ; }
   int index(){ return index_ ; }
+  int accept(){ return accept_ ; }
+  int prescale(){ return prescale_ ; }
+  void setBit(int bit){ bit_ = bit ; }
+  int bit(){ return bit_ ; }
   
   bool isSingleElectron(){ return nEl_==1 ; }
   bool isDoubleElectron(){ return nEl_==2 ; }
@@ -156,6 +174,7 @@ public:
   bool isOnlyDoubleElectronSingleMuon(){ return (nTypes_==2*pow(10,(int)kElectron)+1*pow(10,(int)kMuon)) ; }
   bool isMET(){ return (hasMET_ ==1); }
   void saveFilters(){saveFilters_=1 ;}
+  bool saveFiltersEnabled(){ return saveFilters_ ; }
   void savePrescale(){savePrescale_=1 ;} 
   std::vector<TriggerFilter*> filters_ ;
 };
@@ -7,6 +7,8 @@
 #include "BTagEntry.h"
 #include "BTagCalibration.h"
 #include "BTagCalibrationReader.h"
+#include "BTagCache.h"
+#include "BTagEfficiencyTable.h"
 #include "DataFormats/PatCandidates/interface/Jet.h"
 
 
@@ -14,9 +16,24 @@ class BTagWeighter{
 public:
   enum class Runs{all, BtoF, GtoH, B, CtoD, EtoF };
 
+  // table_tolerance > 0 replaces the TF1 scale factor functions by tables that
+  // agree with them to within that absolute difference (see
+  // BTagCalibrationReader::set_table_tolerance).
+  // If cache_file is given and matches the input files, the calibrations and
+  // efficiency maps are read from it instead (see CompileCache).
   explicit BTagWeighter(std::string proc,
                         bool is_fast_sim = false,
-			bool is_cmssw_7 = false);
+			bool is_cmssw_7 = false,
+			double table_tolerance = 0.,
+			const std::string &cache_file = "");
+
+  // Parse all inputs for process proc and write them to a BTagCache
+  static void CompileCache(const std::string &proc, const std::string &cache_file);
+  static std::vector<std::string> SourceFiles(const std::string &proc);
+
+  // Largest difference between tabulated and exact scale factors over all readers,
+  // for the tables built so far
+  double MaxTableDeviation() const;
 
   double EventWeight(edm::View<pat::Jet> &b, BTagEntry::OperatingPoint op,
 		     const std::string &bc_full_syst, const std::string &udsg_full_syst,
@@ -36,31 +53,61 @@ public:
 		     const std::string &bc_fast_syst, const std::string &udsg_fast_syst,
 		     bool do_deep_csv, bool do_by_proc, Runs runs = Runs::all) const;
 
-  double JetBTagWeight(pat::Jet b, BTagEntry::OperatingPoint op,
+  double JetBTagWeight(const pat::Jet &b, BTagEntry::OperatingPoint op,
 		       const std::string &bc_full_syst, const std::string &udsg_full_syst,
 		       const std::string &bc_fast_syst, const std::string &udsg_fast_syst,
 		       bool do_deep_csv, bool do_by_proc, Runs runs = Runs::all) const;
 
-  double JetBTagWeight(pat::Jet b, BTagEntry::OperatingPoint op,
+  double JetBTagWeight(const pat::Jet &b, BTagEntry::OperatingPoint op,
 		       const std::string &bc_full_syst, const std::string &udsg_full_syst,
 		       bool do_deep_csv, bool do_by_proc, Runs runs = Runs::all) const;
 
-  double JetBTagWeight(pat::Jet b, const std::vector<BTagEntry::OperatingPoint> &ops,
+  double JetBTagWeight(const pat::Jet &b, const std::vector<BTagEntry::OperatingPoint> &ops,
 		       const std::string &bc_full_syst, const std::string &udsg_full_syst,
 		       bool do_deep_csv, bool do_by_proc, Runs runs = Runs::all) const;
 
-  double JetBTagWeight(pat::Jet b,const std::vector<BTagEntry::OperatingPoint> &ops,
+  double JetBTagWeight(const pat::Jet &b, const std::vector<BTagEntry::OperatingPoint> &ops,
 		       const std::string &bc_full_syst, const std::string &udsg_full_syst,
 		       const std::string &bc_fast_syst, const std::string &udsg_fast_syst,
 		       bool do_deep_csv, bool do_by_proc, Runs runs = Runs::all) const;
 
+  // One weight asked of JetBTagWeights: operating point, systematics and run period
+  struct WeightRequest{
+    WeightRequest(BTagEntry::OperatingPoint op_,
+		  const std::string &bc_full_syst_, const std::string &udsg_full_syst_,
+		  const std::string &bc_fast_syst_ = "central", const std::string &udsg_fast_syst_ = "central",
+		  Runs runs_ = Runs::all):
+      op(op_), bc_full_syst(bc_full_syst_), udsg_full_syst(udsg_full_syst_),
+      bc_fast_syst(bc_fast_syst_), udsg_fast_syst(udsg_fast_syst_), runs(runs_){}
+    BTagEntry::OperatingPoint op;
+    std::string bc_full_syst, udsg_full_syst;
+    std::string bc_fast_syst, udsg_fast_syst;
+    Runs runs;
+  };
+
+  // Weights for all requests at once, equal to calling JetBTagWeight with a single
+  // operating point for each of them, but without repeating the lookups they share
+  void JetBTagWeights(const pat::Jet &b, const std::vector<WeightRequest> &requests,
+		      bool do_deep_csv, bool do_by_proc, std::vector<double> &weights) const;
+
 private:
+  typedef std::map<BTagEntry::OperatingPoint, std::unique_ptr<BTagCalibrationReader> > ReaderMap;
+
+  static BTagCache* OpenCache(const std::string &proc, const std::string &cache_file);
+  static std::string EfficiencyHistName(BTagEntry::OperatingPoint op, bool do_deep_csv);
+  BTagCalibration* LoadCalibration(const std::string &tagger, const std::string &file) const;
+  TH3D LoadEfficiency(TFile *file, const std::string &file_name, const std::string &hist_name) const;
+
+  const ReaderMap* FullReaders(Runs runs, bool do_deep_csv) const;
+  float OpCut(BTagEntry::OperatingPoint op, bool do_deep_csv) const;
+
   double GetMCTagEfficiency(int pdgId, float pT, float eta,
 			    BTagEntry::OperatingPoint op, bool do_deep_csv, bool do_by_proc) const;
 
   static const std::vector<BTagEntry::OperatingPoint> op_pts_;
   static const std::vector<BTagEntry::JetFlavor> flavors_;
 
+  std::unique_ptr<BTagCache> cache_;  // only set while constructing
   std::unique_ptr<BTagCalibration> calib_full_;
   std::unique_ptr<BTagCalibration> calib_full_bf_;
   std::unique_ptr<BTagCalibration> calib_full_gh_;
@@ -75,8 +122,6 @@ private:
   std::map<BTagEntry::OperatingPoint, std::unique_ptr<BTagCalibrationReader> > readers_full_cd_;
   std::map<BTagEntry::OperatingPoint, std::unique_ptr<BTagCalibrationReader> > readers_full_ef_;
   std::map<BTagEntry::OperatingPoint, std::unique_ptr<BTagCalibrationReader> > readers_fast_;
-  std::vector<TH3D> btag_efficiencies_;
-  std::vector<TH3D> btag_efficiencies_proc_;
 
   std::unique_ptr<BTagCalibration> calib_deep_full_;
   std::unique_ptr<BTagCalibration> calib_deep_full_bf_;
@@ -86,8 +131,13 @@ private:
   std::map<BTagEntry::OperatingPoint, std::unique_ptr<BTagCalibrationReader> > readers_deep_full_bf_;
   std::map<BTagEntry::OperatingPoint, std::unique_ptr<BTagCalibrationReader> > readers_deep_full_gh_;
   std::map<BTagEntry::OperatingPoint, std::unique_ptr<BTagCalibrationReader> > readers_deep_fast_;
-  std::vector<TH3D> btag_efficiencies_deep_;
-  std::vector<TH3D> btag_efficiencies_deep_proc_;
+
+  // Efficiency maps of the operating points, flattened when they are loaded: inclusive
+  // and by process, for CSVv2 and DeepCSV
+  BTagEfficiencyTable eff_table_;
+  BTagEfficiencyTable eff_table_proc_;
+  BTagEfficiencyTable eff_table_deep_;
+  BTagEfficiencyTable eff_table_deep_proc_;
 
   double csv_loose_, csv_medium_, csv_tight_;
   double deep_csv_loose_, deep_csv_medium_, deep_csv_tight_;
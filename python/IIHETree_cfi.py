@@ -29,6 +29,26 @@ IIHEAnalysis = cms.EDAnalyzer("IIHEAnalysis",
     #Trigger paths that we want to save
 #    triggers                                    = cms.untracked.string("singleElectron;doubleElectron;singleMuon;singlePhoton;singleElectronSingleMuon;doubleMuon"),
     triggers                                    = cms.untracked.string("singleElectron;doubleElectron;singleMuon;singlePhoton;singleElectronSingleMuon;doubleMuon;MET"),
+    # Store the trigger decisions as bit words (trig_packedAccept etc) instead of one branch
+    # per path.  The path of each bit is in trig_packedPathNames in the meta tree.
+    packTriggerBits                             = cms.untracked.bool(False),
+    # The filter objects are saved for paths with any of these in their name
+    saveFiltersTriggers                         = cms.untracked.vstring(
+        "Ele27_eta2p1_WPTight_Gsf_v",
+        "DoubleEle33_CaloIdL_MW_v",
+        "DoubleEle33_CaloIdL_GsfTrkIdVL_v",
+        "Ele23_Ele12_CaloIdL_TrackIdL_IsoVL_DZ_v",
+        "Mu17_TrkIsoVVL_TkMu8_TrkIsoVVL_v",
+        "Mu17_TrkIsoVVL_Mu8_TrkIsoVVL_v",
+        "Mu17_TrkIsoVVL_Mu8_TrkIsoVVL_DZ_v",
+        "Mu17_TrkIsoVVL_TkMu8_TrkIsoVVL_DZ_v",
+        "Iso_TkMu24_v",
+        "Iso_Mu24_v",
+        "Mu23_TrkIsoVVL_Ele8_CaloIdL_TrackIdL_IsoVL_v",
+        "Mu8_TrkIsoVVL_Ele23_CaloIdL_TrackIdL_IsoVL_v",
+        "Mu23_TrkIsoVVL_Ele8_CaloIdL_TrackIdL_IsoVL_DZ_v",
+        "Mu8_TrkIsoVVL_Ele23_CaloIdL_TrackIdL_IsoVL_DZ_v"
+    ),
     globalTag                                   = cms.string(""),
     
     # Trigger matching stuff.  0.5 should be sufficient.
@@ -67,6 +87,28 @@ IIHEAnalysis = cms.EDAnalyzer("IIHEAnalysis",
     jetPtThreshold                              = cms.untracked.double(20),
     tauPtTThreshold                             = cms.untracked.double(15),
     
+    # ECAL rechits saved by the electron module (EBHits_*, EEHits_*): those at or above
+    # this energy (GeV), with one branch per stored flag. EHits_isSaturated is set if any
+    # rechit has one of the saturation flags.
+    # EEHits_ieta and EEHits_iphi hold the EEDetId iy and ix, as gsf_sc_seed_ieta/iphi do
+    # for the endcap (they used to be read through EBDetId, which gave meaningless values),
+    # and EEHits_iRechit numbers the stored endcap rechits from 1 (it used to repeat the
+    # barrel count).
+    rechitEnergyThreshold                       = cms.untracked.double(200.0),
+    rechitSaturationFlags                       = cms.untracked.vstring("kSaturated"),
+    rechitStoredFlags                           = cms.untracked.vstring(
+        "kSaturated", "kLeadingEdgeRecovered", "kNeighboursRecovered", "kWeird"),
+    
+    # Tabulate the b-tag scale factor functions and interpolate instead of evaluating
+    # the TF1 for every jet. Each table gets as many points as it needs to stay within
+    # this absolute difference of the TF1 (0 = exact, negative values are rejected).
+    # The maximum deviation is printed at startup.
+    btagSFTableTolerance                        = cms.untracked.double(0.0),
+    # Binary cache of the b-tag calibrations and efficiency maps, used when it matches
+    # the files in data/ (empty = always read them). See test/compileBTagCache.py.
+    btagCacheFile                               = cms.untracked.string(""),
+    btagCompileCache                            = cms.untracked.bool(False),
+    
     # IMPORTANT         ****SKIM EVENT****
     leptonsAcceptPtThreshold                    = cms.untracked.double(15),
     leptonsAccept_nEle                          = cms.untracked.int32(2),
@@ -75,6 +117,8 @@ IIHEAnalysis = cms.EDAnalyzer("IIHEAnalysis",
     leptonsAccept_nMu                           = cms.untracked.int32(2),
     leptonsAccept_nMuTau                        = cms.untracked.int32(2),
     leptonsAccept_nTau                          = cms.untracked.int32(999),
+    # Run the leptons accept module as a gate: events it rejects skip all other modules
+    leptonsAcceptAsGate                         = cms.untracked.bool(False),
     #***********************************************************************
     
     #tell the code if you are running on data or MC
@@ -103,5 +147,8 @@ IIHEAnalysis = cms.EDAnalyzer("IIHEAnalysis",
     
     #change it to true if you want to save all events
     includeAutoAcceptEventModule                = cms.untracked.bool(False),
+    # Measure the net heap growth of each module (slow, for debugging memory use).
+    # The profile_* columns of the meta tree are vectors of doubles, exact up to 2^53.
+    profileModuleMemory                         = cms.untracked.bool(False),
     debug                                       = cms.bool(False)
     )
@@ -0,0 +1,349 @@
+#include "UserCode/IIHETree/interface/BTagCache.h"
+
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <TFile.h>
+
+#include "UserCode/IIHETree/interface/utilities.h"
+
+namespace {
+  const char kMagic[8] = {'I', 'I', 'H', 'E', 'B', 'T', 'A', 'G'};
+  const unsigned kVersion = 1;
+
+  // 64 bit FNV-1a
+  const unsigned long long kFNVOffset = 14695981039346656037ULL;
+  const unsigned long long kFNVPrime = 1099511628211ULL;
+
+  unsigned long long fnv1a(const char * data, size_t size,
+                           unsigned long long sum = kFNVOffset)
+  {
+    for (size_t i=0; i<size; ++i) {
+      sum ^= static_cast<unsigned char>(data[i]);
+      sum *= kFNVPrime;
+    }
+    return sum;
+  }
+
+  class Writer {
+  public:
+    template <class T> void put(const T & value) {
+      buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    void putString(const std::string & s) {
+      put<unsigned>(s.size());
+      buffer.append(s);
+    }
+    void putDoubles(const std::vector<double> & v) {
+      put<unsigned>(v.size());
+      buffer.append(reinterpret_cast<const char*>(v.data()), v.size()*sizeof(double));
+    }
+    std::string buffer;
+  };
+
+  // Decodes straight from the mapped file; every read is bounds checked and
+  // sets ok to false instead of running past the end
+  class Reader {
+  public:
+    Reader(const char * data, size_t size): ok(true), data_(data), size_(size), pos_(0) {}
+    template <class T> T get() {
+      T value = T();
+      if (!need(sizeof(T))) return value;
+      std::memcpy(&value, data_+pos_, sizeof(T));
+      pos_ += sizeof(T);
+      return value;
+    }
+    std::string getString() {
+      unsigned n = get<unsigned>();
+      if (!need(n)) return std::string();
+      std::string s(data_+pos_, n);
+      pos_ += n;
+      return s;
+    }
+    std::vector<double> getDoubles() {
+      unsigned n = get<unsigned>();
+      std::vector<double> v;
+      if (!need(static_cast<size_t>(n)*sizeof(double))) return v;
+      v.resize(n);
+      std::memcpy(v.data(), data_+pos_, n*sizeof(double));
+      pos_ += n*sizeof(double);
+      return v;
+    }
+    size_t pos() const { return pos_; }
+    bool ok;
+  private:
+    bool need(size_t n) {
+      if (!ok || n > size_-pos_) {
+        ok = false;
+      }
+      return ok;
+    }
+    const char * data_;
+    size_t size_;
+    size_t pos_;
+  };
+}
+
+bool BTagCache::checksum(const std::string & filename,
+                         unsigned long long & size,
+                         unsigned long long & sum)
+{
+  std::ifstream ifs(filename, std::ios::binary);
+  if (!ifs.good()) {
+    return false;
+  }
+  size = 0;
+  sum = kFNVOffset;
+  char buffer[1 << 16];
+  while (ifs) {
+    ifs.read(buffer, sizeof(buffer));
+    size += ifs.gcount();
+    sum = fnv1a(buffer, ifs.gcount(), sum);
+  }
+  return true;
+}
+
+void BTagCache::addSource(const std::string & filename)
+{
+  Source s;
+  if (!checksum(filename, s.size, s.checksum)) {
+    ERROR(("BTagCache: input file not available: "+filename));
+  }
+  sources_[filename] = s;
+}
+
+void BTagCache::addCalibration(const std::string & tagger, const std::string & filename)
+{
+  addSource(filename);
+  calibrations_[filename] = std::make_shared<BTagCalibration>(tagger, filename);
+}
+
+void BTagCache::addEfficiency(const std::string & filename, const std::string & histName)
+{
+  if (!sources_.count(filename)) {
+    addSource(filename);
+  }
+  TFile file(filename.c_str(), "read");
+  const TH3D * hist = dynamic_cast<const TH3D*>(file.Get(histName.c_str()));
+  if (!hist) {
+    ERROR(("BTagCache: TH3D "+histName+" not found in "+filename));
+  }
+
+  Efficiency & eff = efficiencies_[std::make_pair(filename, histName)];
+  eff.name = hist->GetName();
+  const TAxis * axes[3] = {hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis()};
+  for (unsigned a=0; a<3; ++a) {
+    eff.axes[a].edges.clear();
+    for (int i=1; i<=axes[a]->GetNbins()+1; ++i) {
+      eff.axes[a].edges.push_back(axes[a]->GetBinLowEdge(i));
+    }
+  }
+  eff.contents.clear();
+  for (int i=0; i<hist->GetNcells(); ++i) {
+    eff.contents.push_back(hist->GetBinContent(i));
+  }
+}
+
+void BTagCache::write(const std::string & filename) const
+{
+  Writer w;
+  w.buffer.append(kMagic, sizeof(kMagic));
+  w.put<unsigned>(kVersion);
+
+  w.put<unsigned>(sources_.size());
+  for (const auto & s : sources_) {
+    w.putString(s.first);
+    w.put<unsigned long long>(s.second.size);
+    w.put<unsigned long long>(s.second.checksum);
+  }
+
+  w.put<unsigned>(calibrations_.size());
+  for (const auto & c : calibrations_) {
+    w.putString(c.first);
+    w.putString(c.second->tagger());
+    const auto & data = c.second->getAllEntries();
+    unsigned nEntries = 0;
+    for (const auto & d : data) {
+      nEntries += d.second.size();
+    }
+    w.put<unsigned>(nEntries);
+    for (const auto & d : data) {
+      for (const auto & e : d.second) {
+        w.put<unsigned>(e.params.operatingPoint);
+        w.putString(e.params.measurementType);
+        w.putString(e.params.sysType);
+        w.put<unsigned>(e.params.jetFlavor);
+        w.put<float>(e.params.etaMin);
+        w.put<float>(e.params.etaMax);
+        w.put<float>(e.params.ptMin);
+        w.put<float>(e.params.ptMax);
+        w.put<float>(e.params.discrMin);
+        w.put<float>(e.params.discrMax);
+        w.putString(e.formula);
+      }
+    }
+  }
+
+  w.put<unsigned>(efficiencies_.size());
+  for (const auto & e : efficiencies_) {
+    w.putString(e.first.first);
+    w.putString(e.first.second);
+    for (unsigned a=0; a<3; ++a) {
+      w.putDoubles(e.second.axes[a].edges);
+    }
+    w.putDoubles(e.second.contents);
+  }
+
+  w.put<unsigned long long>(fnv1a(w.buffer.data(), w.buffer.size()));
+
+  std::ofstream ofs(filename, std::ios::binary | std::ios::trunc);
+  ofs.write(w.buffer.data(), w.buffer.size());
+  if (!ofs.good()) {
+    ERROR(("BTagCache: could not write "+filename));
+  }
+}
+
+bool BTagCache::read(const std::string & filename)
+{
+  sources_.clear();
+  calibrations_.clear();
+  efficiencies_.clear();
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(kMagic)+sizeof(unsigned long long))) {
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  void * mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  const char * data = static_cast<const char*>(mapped);
+
+  // the trailing checksum catches truncated or partly written files
+  size_t payload = size - sizeof(unsigned long long);
+  unsigned long long stored;
+  std::memcpy(&stored, data+payload, sizeof(stored));
+  bool ok = std::memcmp(data, kMagic, sizeof(kMagic)) == 0
+         && fnv1a(data, payload) == stored;
+
+  Reader r(data+sizeof(kMagic), payload-sizeof(kMagic));
+  ok = ok && r.get<unsigned>() == kVersion;
+
+  unsigned nSources = ok ? r.get<unsigned>() : 0;
+  for (unsigned i=0; i<nSources && r.ok; ++i) {
+    std::string path = r.getString();
+    Source & s = sources_[path];
+    s.size = r.get<unsigned long long>();
+    s.checksum = r.get<unsigned long long>();
+  }
+
+  unsigned nCalibrations = ok ? r.get<unsigned>() : 0;
+  for (unsigned i=0; i<nCalibrations && r.ok; ++i) {
+    std::string path = r.getString();
+    auto calibration = std::make_shared<BTagCalibration>(r.getString());
+    unsigned nEntries = r.get<unsigned>();
+    for (unsigned j=0; j<nEntries && r.ok; ++j) {
+      // fill the entry directly: the formula was checked when the cache was made
+      BTagEntry e;
+      e.params.operatingPoint = BTagEntry::OperatingPoint(r.get<unsigned>());
+      e.params.measurementType = r.getString();
+      e.params.sysType = r.getString();
+      e.params.jetFlavor = BTagEntry::JetFlavor(r.get<unsigned>());
+      e.params.etaMin = r.get<float>();
+      e.params.etaMax = r.get<float>();
+      e.params.ptMin = r.get<float>();
+      e.params.ptMax = r.get<float>();
+      e.params.discrMin = r.get<float>();
+      e.params.discrMax = r.get<float>();
+      e.formula = r.getString();
+      calibration->addEntry(e);
+    }
+    calibrations_[path] = calibration;
+  }
+
+  unsigned nEfficiencies = ok ? r.get<unsigned>() : 0;
+  for (unsigned i=0; i<nEfficiencies && r.ok; ++i) {
+    std::string path = r.getString();
+    std::string name = r.getString();
+    Efficiency & eff = efficiencies_[std::make_pair(path, name)];
+    eff.name = name;
+    for (unsigned a=0; a<3; ++a) {
+      eff.axes[a].edges = r.getDoubles();
+    }
+    eff.contents = r.getDoubles();
+  }
+
+  munmap(mapped, size);
+
+  ok = ok && r.ok && r.pos() == payload-sizeof(kMagic);
+  if (!ok) {
+    sources_.clear();
+    calibrations_.clear();
+    efficiencies_.clear();
+  }
+  return ok;
+}
+
+bool BTagCache::matches(const std::vector<std::string> & sources) const
+{
+  for (const auto & filename : sources) {
+    auto s = sources_.find(filename);
+    if (s == sources_.end()) {
+      return false;
+    }
+    unsigned long long size, sum;
+    if (!checksum(filename, size, sum)) {
+      return false;
+    }
+    if (size != s->second.size || sum != s->second.checksum) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const BTagCalibration & BTagCache::calibration(const std::string & filename) const
+{
+  if (!calibrations_.count(filename)) {
+    ERROR(("BTagCache: no calibration for "+filename));
+  }
+  return *calibrations_.at(filename);
+}
+
+TH3D BTagCache::efficiency(const std::string & filename, const std::string & histName) const
+{
+  auto e = efficiencies_.find(std::make_pair(filename, histName));
+  if (e == efficiencies_.end()) {
+    ERROR(("BTagCache: no efficiency map "+histName+" for "+filename));
+  }
+  const Efficiency & eff = e->second;
+  const auto & x = eff.axes[0].edges;
+  const auto & y = eff.axes[1].edges;
+  const auto & z = eff.axes[2].edges;
+  if (x.size() < 2 || y.size() < 2 || z.size() < 2) {
+    ERROR(("BTagCache: corrupt efficiency map "+histName+" for "+filename));
+  }
+
+  TH3D hist(eff.name.c_str(), eff.name.c_str(),
+            x.size()-1, x.data(), y.size()-1, y.data(), z.size()-1, z.data());
+  hist.SetDirectory(nullptr);
+  if (eff.contents.size() != static_cast<size_t>(hist.GetNcells())) {
+    ERROR(("BTagCache: corrupt efficiency map "+histName+" for "+filename));
+  }
+  for (int i=0; i<hist.GetNcells(); ++i) {
+    hist.SetBinContent(i, eff.contents[i]);
+  }
+  return hist;
+}
@@ -1,5 +1,8 @@
 #include "UserCode/IIHETree/interface/BTagCalibrationReader.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "UserCode/IIHETree/interface/utilities.h"
 
 class BTagCalibrationReader::BTagCalibrationReaderImpl
@@ -14,7 +17,27 @@ public:
     float ptMax;
     float discrMin;
     float discrMax;
-    TF1 func;
+    std::string formula;
+    // Compiled, and tabulated if asked for, when the entry is first evaluated: most
+    // entries of a calibration are never used by a job
+    mutable bool compiled;
+    mutable TF1 func;
+    mutable std::vector<double> table;  // func sampled on a regular grid, empty if not tabulated
+    mutable float tableMin;
+    mutable float tableStep;
+  };
+
+  // Every distinct eta, pt and discr boundary of one jet flavour's entries cuts the
+  // parameter space into cells.  An entry either covers a cell completely or not at all,
+  // so the first matching entry only has to be found once per cell, at load time.  The
+  // pt bounds do not depend on pt, so they are kept per eta and discr cell, with one more
+  // discr slot per eta cell for a discr outside every entry.
+  struct EntryIndex {
+    std::vector<float> etaEdges;
+    std::vector<float> ptEdges;
+    std::vector<float> discrEdges;  // only used for reshaping
+    std::vector<int> cells;         // index into tmpData_[jf], -1 if nothing matches
+    std::vector<std::pair<float, float> > ptBounds;  // min_max_pt per eta and discr slot
   };
 
 private:
@@ -31,20 +54,56 @@ private:
               float pt,
               float discr) const;
 
+  double eval_linear(BTagEntry::JetFlavor jf,
+                     float eta,
+                     float pt,
+                     float discr) const;
+
   double eval_auto_bounds(const std::string & sys,
                           BTagEntry::JetFlavor jf,
                           float eta,
                           float pt,
                           float discr) const;
 
+  void eval_auto_bounds(const std::vector<std::string> & systs,
+                        BTagEntry::JetFlavor jf,
+                        float eta,
+                        float pt,
+                        float discr,
+                        std::vector<double> & sfs) const;
+
+  void buildIndex(BTagEntry::JetFlavor jf);
+  int etaCell(const EntryIndex & index, float eta) const;
+  int discrCell(const EntryIndex & index, float discr) const;
+  void compile(const TmpEntry & te) const;
+  void tabulate(const TmpEntry & te, float xMin, float xMax) const;
+  double evalEntry(const TmpEntry & e, float x) const;
+  void set_table_tolerance(double tolerance);
+  double max_table_deviation() const;
+  int findEntry(BTagEntry::JetFlavor jf,
+                float eta,
+                float pt,
+                float discr) const;
+
   std::pair<float, float> min_max_pt(BTagEntry::JetFlavor jf,
                                      float eta,
                                      float discr) const;
 
+  std::pair<float, float> min_max_pt_linear(BTagEntry::JetFlavor jf,
+                                            float eta,
+                                            float discr) const;
+
+  std::pair<float, float> scan_pt_bounds(BTagEntry::JetFlavor jf,
+                                         float eta,
+                                         float discr) const;
+
   BTagEntry::OperatingPoint op_;
   std::string sysType_;
   std::vector<std::vector<TmpEntry> > tmpData_;  // first index: jetFlavor
   std::vector<bool> useAbsEta_;                  // first index: jetFlavor
+  std::vector<EntryIndex> index_;                // first index: jetFlavor
+  double tableTolerance_;                        // 0: always evaluate the TF1
+  mutable double maxTableDeviation_;
   std::map<std::string, std::shared_ptr<BTagCalibrationReaderImpl>> otherSysTypeReaders_;
 };
 
@@ -56,7 +115,10 @@ BTagCalibrationReader::BTagCalibrationReaderImpl::BTagCalibrationReaderImpl(
   op_(op),
   sysType_(sysType),
   tmpData_(3),
-  useAbsEta_(3, true)
+  useAbsEta_(3, true),
+  index_(3),
+  tableTolerance_(0.),
+  maxTableDeviation_(0.)
 {
   for (const std::string & ost : otherSysTypes) {
     if (otherSysTypeReaders_.count(ost)) {
@@ -92,26 +154,242 @@ void BTagCalibrationReader::BTagCalibrationReaderImpl::load(
     te.ptMax = be.params.ptMax;
     te.discrMin = be.params.discrMin;
     te.discrMax = be.params.discrMax;
-
-    if (op_ == BTagEntry::OP_RESHAPING) {
-      te.func = TF1("", be.formula.c_str(),
-                    be.params.discrMin, be.params.discrMax);
-    } else {
-      te.func = TF1("", be.formula.c_str(),
-                    be.params.ptMin, be.params.ptMax);
-    }
+    te.formula = be.formula;
+    te.compiled = false;
 
     tmpData_[be.params.jetFlavor].push_back(te);
     if (te.etaMin < 0) {
       useAbsEta_[be.params.jetFlavor] = false;
     }
   }
+  buildIndex(jf);
 
   for (auto & p : otherSysTypeReaders_) {
     p.second->load(c, jf, measurementType);
   }
 }
 
+void BTagCalibrationReader::BTagCalibrationReaderImpl::buildIndex(
+                                             BTagEntry::JetFlavor jf)
+{
+  bool use_discr = (op_ == BTagEntry::OP_RESHAPING);
+  const auto &entries = tmpData_.at(jf);
+  EntryIndex &index = index_.at(jf);
+
+  auto makeEdges = [](std::vector<float> &edges) {
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  };
+  index = EntryIndex();
+  for (const auto &e : entries) {
+    index.etaEdges.push_back(e.etaMin);
+    index.etaEdges.push_back(e.etaMax);
+    index.ptEdges.push_back(e.ptMin);
+    index.ptEdges.push_back(e.ptMax);
+    if (use_discr) {
+      index.discrEdges.push_back(e.discrMin);
+      index.discrEdges.push_back(e.discrMax);
+    }
+  }
+  makeEdges(index.etaEdges);
+  makeEdges(index.ptEdges);
+  makeEdges(index.discrEdges);
+
+  // cells run between consecutive edges; without discr there is a single discr "cell"
+  unsigned nEta = index.etaEdges.size() > 1 ? index.etaEdges.size()-1 : 0;
+  unsigned nPt = index.ptEdges.size() > 1 ? index.ptEdges.size()-1 : 0;
+  unsigned nDiscr = use_discr ? (index.discrEdges.size() > 1 ? index.discrEdges.size()-1 : 0) : 1;
+  index.cells.assign(nEta*nPt*nDiscr, -1);
+
+  // walk the entries backwards so that the first entry in file order wins, as in eval_linear
+  for (int i=entries.size()-1; i>=0; --i) {
+    const auto &e = entries.at(i);
+    auto range = [](const std::vector<float> &edges, float lo, float hi) {
+      unsigned first = std::lower_bound(edges.begin(), edges.end(), lo) - edges.begin();
+      unsigned last = std::lower_bound(edges.begin(), edges.end(), hi) - edges.begin();
+      return std::make_pair(first, last);
+    };
+    auto etaRange = range(index.etaEdges, e.etaMin, e.etaMax);
+    auto ptRange = range(index.ptEdges, e.ptMin, e.ptMax);
+    auto discrRange = use_discr ? range(index.discrEdges, e.discrMin, e.discrMax)
+                                : std::make_pair(0u, 1u);
+    for (unsigned ie=etaRange.first; ie<etaRange.second; ++ie) {
+      for (unsigned ip=ptRange.first; ip<ptRange.second; ++ip) {
+        for (unsigned id=discrRange.first; id<discrRange.second; ++id) {
+          index.cells[(ie*nPt + ip)*nDiscr + id] = i;
+        }
+      }
+    }
+  }
+
+  // the edges are entry boundaries, so the lower edge of a cell stands for all of it; a
+  // NaN discr matches no entry, as a discr outside all of them
+  unsigned nSlots = use_discr ? nDiscr+1 : 1;
+  index.ptBounds.resize(nEta*nSlots);
+  for (unsigned ie=0; ie<nEta; ++ie) {
+    for (unsigned id=0; id<nSlots; ++id) {
+      float discr = (use_discr && id < nDiscr) ? index.discrEdges[id] : std::nanf("");
+      index.ptBounds[ie*nSlots + id] = scan_pt_bounds(jf, index.etaEdges[ie], discr);
+    }
+  }
+}
+
+int BTagCalibrationReader::BTagCalibrationReaderImpl::etaCell(
+                                             const EntryIndex & index,
+                                             float eta) const
+{
+  // eta ranges are [min, max)
+  const auto &etaEdges = index.etaEdges;
+  int ie = std::upper_bound(etaEdges.begin(), etaEdges.end(), eta) - etaEdges.begin() - 1;
+  if (ie < 0 || ie >= int(etaEdges.size())-1) {
+    return -1;
+  }
+  return ie;
+}
+
+int BTagCalibrationReader::BTagCalibrationReaderImpl::discrCell(
+                                             const EntryIndex & index,
+                                             float discr) const
+{
+  // discr ranges are [min, max); without reshaping there is a single discr cell
+  if (op_ != BTagEntry::OP_RESHAPING) {
+    return 0;
+  }
+  const auto &discrEdges = index.discrEdges;
+  int id = std::upper_bound(discrEdges.begin(), discrEdges.end(), discr) - discrEdges.begin() - 1;
+  if (id < 0 || id >= int(discrEdges.size())-1) {
+    return -1;
+  }
+  return id;
+}
+
+int BTagCalibrationReader::BTagCalibrationReaderImpl::findEntry(
+                                             BTagEntry::JetFlavor jf,
+                                             float eta,
+                                             float pt,
+                                             float discr) const
+{
+  const EntryIndex &index = index_.at(jf);
+  if (index.cells.empty()) {
+    return -1;
+  }
+
+  int ie = etaCell(index, eta);
+  if (ie < 0) {
+    return -1;
+  }
+  // pt ranges are (min, max]
+  const auto &ptEdges = index.ptEdges;
+  int ip = std::lower_bound(ptEdges.begin(), ptEdges.end(), pt) - ptEdges.begin() - 1;
+  if (ip < 0 || ip >= int(ptEdges.size())-1) {
+    return -1;
+  }
+  int id = discrCell(index, discr);
+  if (id < 0) {
+    return -1;
+  }
+
+  int nPt = ptEdges.size()-1;
+  int nDiscr = (op_ == BTagEntry::OP_RESHAPING) ? index.discrEdges.size()-1 : 1;
+  return index.cells[(ie*nPt + ip)*nDiscr + id];
+}
+
+void BTagCalibrationReader::BTagCalibrationReaderImpl::compile(
+                                             const TmpEntry & te) const
+{
+  // marked first, so that tabulate can check its tables through evalEntry
+  te.compiled = true;
+  if (op_ == BTagEntry::OP_RESHAPING) {
+    te.func = TF1("", te.formula.c_str(), te.discrMin, te.discrMax);
+    tabulate(te, te.discrMin, te.discrMax);
+  } else {
+    te.func = TF1("", te.formula.c_str(), te.ptMin, te.ptMax);
+    tabulate(te, te.ptMin, te.ptMax);
+  }
+}
+
+void BTagCalibrationReader::BTagCalibrationReaderImpl::tabulate(
+                                             const TmpEntry & te,
+                                             float xMin,
+                                             float xMax) const
+{
+  // nodes per table: 17, 33, 65, ... until the table is within tolerance
+  static const unsigned firstPoints = 17;
+  static const unsigned maxPoints = 65537;
+  static const unsigned checksPerInterval = 8;
+
+  te.table.clear();
+  if (!(tableTolerance_ > 0.) || !(xMax > xMin)) {
+    return;
+  }
+
+  te.tableMin = xMin;
+  for (unsigned nPoints=firstPoints; nPoints<=maxPoints; nPoints=2*nPoints-1) {
+    te.tableStep = (xMax - xMin) / (nPoints - 1);
+    te.table.clear();
+    for (unsigned i=0; i<nPoints; ++i) {
+      te.table.push_back(te.func.Eval(xMin + i*te.tableStep));
+    }
+
+    // compare with the exact function at checksPerInterval points between
+    // every pair of nodes, where linear interpolation is furthest off
+    double deviation = 0.;
+    for (unsigned i=0; i+1<nPoints; ++i) {
+      for (unsigned k=1; k<=checksPerInterval; ++k) {
+        float x = xMin + (i + k/(checksPerInterval+1.f))*te.tableStep;
+        deviation = std::max(deviation, std::fabs(evalEntry(te, x) - te.func.Eval(x)));
+      }
+    }
+    if (deviation <= tableTolerance_) {
+      maxTableDeviation_ = std::max(maxTableDeviation_, deviation);
+      return;
+    }
+  }
+
+  // the tolerance cannot be reached with a table of reasonable size, keep the TF1
+  te.table.clear();
+}
+
+double BTagCalibrationReader::BTagCalibrationReaderImpl::evalEntry(
+                                             const TmpEntry & e,
+                                             float x) const
+{
+  if (!e.compiled) {
+    compile(e);
+  }
+  if (e.table.empty()) {
+    return e.func.Eval(x);
+  }
+
+  // linear interpolation between the two nearest nodes
+  float t = (x - e.tableMin) / e.tableStep;
+  int i = static_cast<int>(std::floor(t));
+  i = std::max(0, std::min(i, static_cast<int>(e.table.size())-2));
+  double f = t - i;
+  return e.table[i]*(1.-f) + e.table[i+1]*f;
+}
+
+void BTagCalibrationReader::BTagCalibrationReaderImpl::set_table_tolerance(
+                                             double tolerance)
+{
+  if (!(tolerance >= 0.)) {
+    ERROR(("BTagCalibrationReader: the table tolerance must not be negative, got "+std::to_string(tolerance)));
+  }
+  tableTolerance_ = tolerance;
+  for (auto & p : otherSysTypeReaders_) {
+    p.second->set_table_tolerance(tolerance);
+  }
+}
+
+double BTagCalibrationReader::BTagCalibrationReaderImpl::max_table_deviation() const
+{
+  double deviation = maxTableDeviation_;
+  for (const auto & p : otherSysTypeReaders_) {
+    deviation = std::max(deviation, p.second->max_table_deviation());
+  }
+  return deviation;
+}
+
 double BTagCalibrationReader::BTagCalibrationReaderImpl::eval(
                                              BTagEntry::JetFlavor jf,
                                              float eta,
@@ -123,8 +401,27 @@ double BTagCalibrationReader::BTagCalibrationReaderImpl::eval(
     eta = -eta;
   }
 
+  int i = findEntry(jf, eta, pt, discr);
+  if (i < 0) {
+    return 0.;  // default value
+  }
+  const auto &e = tmpData_.at(jf).at(i);
+  return use_discr ? evalEntry(e, discr) : evalEntry(e, pt);
+}
+
+double BTagCalibrationReader::BTagCalibrationReaderImpl::eval_linear(
+                                                    BTagEntry::JetFlavor jf,
+                                                    float eta,
+                                                    float pt,
+                                                    float discr) const
+{
+  bool use_discr = (op_ == BTagEntry::OP_RESHAPING);
+  if (useAbsEta_[jf] && eta < 0) {
+    eta = -eta;
+  }
+
   // search linearly through eta, pt and discr ranges and eval
-  // future: find some clever data structure based on intervals
+  // kept as a cross-check of the cell index used by eval()
   const auto &entries = tmpData_.at(jf);
   for (unsigned i=0; i<entries.size(); ++i) {
     const auto &e = entries.at(i);
@@ -134,10 +431,10 @@ double BTagCalibrationReader::BTagCalibrationReaderImpl::eval(
     ){
       if (use_discr) {                                    // discr. reshaping?
         if (e.discrMin <= discr && discr < e.discrMax) {  // check discr
-          return e.func.Eval(discr);
+          return evalEntry(e, discr);
         }
       } else {
-        return e.func.Eval(pt);
+        return evalEntry(e, pt);
       }
     }
   }
@@ -184,16 +481,91 @@ double BTagCalibrationReader::BTagCalibrationReaderImpl::eval_auto_bounds(
   return sf_err;
 }
 
+void BTagCalibrationReader::BTagCalibrationReaderImpl::eval_auto_bounds(
+                                             const std::vector<std::string> & systs,
+                                             BTagEntry::JetFlavor jf,
+                                             float eta,
+                                             float pt,
+                                             float discr,
+                                             std::vector<double> & sfs) const
+{
+  // same as the single sys version, but the bounds and the central SF are
+  // only looked up once for all systematics
+  auto sf_bounds = min_max_pt(jf, eta, discr);
+  float pt_for_eval = pt;
+  bool is_out_of_bounds = false;
+
+  if (pt <= sf_bounds.first) {
+    pt_for_eval = sf_bounds.first + .0001;
+    is_out_of_bounds = true;
+  } else if (pt > sf_bounds.second) {
+    pt_for_eval = sf_bounds.second - .0001;
+    is_out_of_bounds = true;
+  }
+
+  double sf = eval(jf, eta, pt_for_eval, discr);
+  sfs.clear();
+  for (const auto & sys : systs) {
+    if (sys == sysType_) {
+      sfs.push_back(sf);
+      continue;
+    }
+    if (!otherSysTypeReaders_.count(sys)) {
+      ERROR(("BTagCalibrationReader: sysType not available (maybe not loaded?): "+sys));
+    }
+    double sf_err = otherSysTypeReaders_.at(sys)->eval(jf, eta, pt_for_eval, discr);
+    if (is_out_of_bounds) {
+      sf_err = sf + 2*(sf_err - sf);
+    }
+    sfs.push_back(sf_err);
+  }
+}
+
 std::pair<float, float> BTagCalibrationReader::BTagCalibrationReaderImpl::min_max_pt(
                                                BTagEntry::JetFlavor jf,
                                                float eta,
                                                float discr) const
 {
-  bool use_discr = (op_ == BTagEntry::OP_RESHAPING);
   if (useAbsEta_[jf] && eta < 0) {
     eta = -eta;
   }
 
+  const EntryIndex &index = index_.at(jf);
+  int ie = etaCell(index, eta);
+  if (ie < 0) {
+    return std::make_pair(-1.f, -1.f);
+  }
+  int nSlots = 1;
+  int id = 0;
+  if (op_ == BTagEntry::OP_RESHAPING) {
+    nSlots = index.discrEdges.size();
+    id = discrCell(index, discr);
+    if (id < 0) {
+      id = nSlots-1;
+    }
+  }
+  return index.ptBounds[ie*nSlots + id];
+}
+
+std::pair<float, float> BTagCalibrationReader::BTagCalibrationReaderImpl::min_max_pt_linear(
+                                               BTagEntry::JetFlavor jf,
+                                               float eta,
+                                               float discr) const
+{
+  if (useAbsEta_[jf] && eta < 0) {
+    eta = -eta;
+  }
+  return scan_pt_bounds(jf, eta, discr);
+}
+
+std::pair<float, float> BTagCalibrationReader::BTagCalibrationReaderImpl::scan_pt_bounds(
+                                               BTagEntry::JetFlavor jf,
+                                               float eta,
+                                               float discr) const
+{
+  // search linearly through the eta and discr ranges; used to fill the
+  // bounds of the cell index, and kept as a cross-check of min_max_pt()
+  bool use_discr = (op_ == BTagEntry::OP_RESHAPING);
   const auto &entries = tmpData_.at(jf);
   float min_pt = -1., max_pt = -1.;
   for (const auto & e: entries) {
@@ -227,6 +599,16 @@ BTagCalibrationReader::BTagCalibrationReader(BTagEntry::OperatingPoint op,
                                              const std::vector<std::string> & otherSysTypes):
   pimpl(new BTagCalibrationReaderImpl(op, sysType, otherSysTypes)) {}
 
+void BTagCalibrationReader::set_table_tolerance(double tolerance)
+{
+  pimpl->set_table_tolerance(tolerance);
+}
+
+double BTagCalibrationReader::max_table_deviation() const
+{
+  return pimpl->max_table_deviation();
+}
+
 void BTagCalibrationReader::load(const BTagCalibration & c,
                                  BTagEntry::JetFlavor jf,
                                  const std::string & measurementType)
@@ -242,6 +624,14 @@ double BTagCalibrationReader::eval(BTagEntry::JetFlavor jf,
   return pimpl->eval(jf, eta, pt, discr);
 }
 
+double BTagCalibrationReader::eval_linear(BTagEntry::JetFlavor jf,
+                                          float eta,
+                                          float pt,
+                                          float discr) const
+{
+  return pimpl->eval_linear(jf, eta, pt, discr);
+}
+
 double BTagCalibrationReader::eval_auto_bounds(const std::string & sys,
                                                BTagEntry::JetFlavor jf,
                                                float eta,
@@ -251,9 +641,26 @@ double BTagCalibrationReader::eval_auto_bounds(const std::string & sys,
   return pimpl->eval_auto_bounds(sys, jf, eta, pt, discr);
 }
 
+void BTagCalibrationReader::eval_auto_bounds(const std::vector<std::string> & systs,
+                                             BTagEntry::JetFlavor jf,
+                                             float eta,
+                                             float pt,
+                                             float discr,
+                                             std::vector<double> & sfs) const
+{
+  pimpl->eval_auto_bounds(systs, jf, eta, pt, discr, sfs);
+}
+
 std::pair<float, float> BTagCalibrationReader::min_max_pt(BTagEntry::JetFlavor jf,
                                                           float eta,
                                                           float discr) const
 {
   return pimpl->min_max_pt(jf, eta, discr);
 }
+
+std::pair<float, float> BTagCalibrationReader::min_max_pt_linear(BTagEntry::JetFlavor jf,
+                                                                 float eta,
+                                                                 float discr) const
+{
+  return pimpl->min_max_pt_linear(jf, eta, discr);
+}
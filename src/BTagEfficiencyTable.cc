@@ -0,0 +1,73 @@
+#include "UserCode/IIHETree/interface/BTagEfficiencyTable.h"
+
+#include <algorithm>
+
+#include "UserCode/IIHETree/interface/utilities.h"
+
+BTagEfficiencyTable::Axis::Axis(const TAxis & axis):
+  nBins(axis.GetNbins()),
+  min(axis.GetXmin()),
+  max(axis.GetXmax())
+{
+  const TArrayD * bins = axis.GetXbins();
+  if (bins->GetSize() > 0) {
+    edges.assign(bins->GetArray(), bins->GetArray()+bins->GetSize());
+  }
+}
+
+bool BTagEfficiencyTable::Axis::operator==(const Axis & other) const
+{
+  return nBins == other.nBins && min == other.min && max == other.max && edges == other.edges;
+}
+
+int BTagEfficiencyTable::Axis::findBin(double x) const
+{
+  // same arithmetic as TAxis::FindFixBin
+  if (x < min) {
+    return 0;
+  }
+  if (!(x < max)) {
+    return nBins+1;
+  }
+  if (edges.empty()) {
+    return 1 + int(nBins*(x-min)/(max-min));
+  }
+  return std::upper_bound(edges.begin(), edges.end(), x) - edges.begin();
+}
+
+bool BTagEfficiencyTable::Binning::operator==(const Binning & other) const
+{
+  return x == other.x && y == other.y && z == other.z;
+}
+
+BTagEfficiencyTable::BTagEfficiencyTable(const std::vector<TH3D> & hists)
+{
+  for (const auto & hist : hists) {
+    Binning binning{Axis(*hist.GetXaxis()), Axis(*hist.GetYaxis()), Axis(*hist.GetZaxis())};
+    unsigned b = std::find(binnings_.begin(), binnings_.end(), binning) - binnings_.begin();
+    if (b == binnings_.size()) {
+      binnings_.push_back(binning);
+    }
+
+    Map map;
+    map.binning = b;
+    map.offset = contents_.size();
+    maps_.push_back(map);
+    for (int i=0; i<hist.GetNcells(); ++i) {
+      contents_.push_back(hist.GetBinContent(i));
+    }
+  }
+}
+
+double BTagEfficiencyTable::value(unsigned map, double x, double y, double z) const
+{
+  if (map >= maps_.size()) {
+    ERROR(("BTagEfficiencyTable: no map "+std::to_string(map)));
+  }
+  const Map & m = maps_[map];
+  const Binning & b = binnings_[m.binning];
+  int bx = b.x.findBin(x);
+  int by = b.y.findBin(y);
+  int bz = b.z.findBin(z);
+  return contents_[m.offset + bx + (b.x.nBins+2)*(by + (b.y.nBins+2)*bz)];
+}
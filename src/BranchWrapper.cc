@@ -18,45 +18,6 @@ void BranchWrapperBase::endEvent(){}
 //////////////////////////////////////////////////////////////////////////////////////////
 //                                     Simple classes                                   //
 //////////////////////////////////////////////////////////////////////////////////////////
-BranchWrapperB::BranchWrapperB(std::string name): BranchWrapperBase(name){
-  value_ = false ;
-}
-int BranchWrapperB::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &value_, Form("%s/O", name().c_str())) ;
-  return 0 ;
-}
-void BranchWrapperB::set(bool value){
-  value_ = value ;
-  fill() ;
-}
-void BranchWrapperB::beginEvent(){
-  value_ = false ;
-  unfill() ;
-}
-void BranchWrapperB::endEvent(){}
-
-// double
-BranchWrapperD::BranchWrapperD(std::string name): BranchWrapperBase(name){
-  value_ = -999 ;
-}
-int BranchWrapperD::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &value_, Form("%s/D", name().c_str())) ;
-  return 0 ;
-}
-void BranchWrapperD::set(double value){
-  value_ = value ;
-  fill() ;
-}
-void BranchWrapperD::beginEvent(){
-  value_ = -999 ;
-  unfill() ;
-}
-void BranchWrapperD::endEvent(){}
-
 // float
 BranchWrapperF::BranchWrapperF(std::string name): BranchWrapperBase(name){
   value_ = -999 ;
@@ -77,125 +38,9 @@ void BranchWrapperF::beginEvent(){
 }
 void BranchWrapperF::endEvent(){}
 
-// int
-BranchWrapperI::BranchWrapperI(std::string name): BranchWrapperBase(name){
-  value_ = -999 ;
-}
-int BranchWrapperI::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &value_, Form("%s/I", name().c_str())) ;
-  return 0 ;
-}
-void BranchWrapperI::set(int value){
-  value_ = value ;
-  fill() ;
-}
-void BranchWrapperI::beginEvent(){
-  value_ = -999 ;
-  unfill() ;
-}
-void BranchWrapperI::endEvent(){}
-
-//char
-BranchWrapperC::BranchWrapperC(std::string name): BranchWrapperBase(name){
-}
-int BranchWrapperC::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(),&value_) ;
-  return 0 ;
-}
-void BranchWrapperC::set(std::string value){
-  value_ = value ;
-  fill() ;
-}
-void BranchWrapperC::beginEvent(){
-  unfill() ;
-}
-void BranchWrapperC::endEvent(){}
-
-
-// unsigned int
-BranchWrapperU::BranchWrapperU(std::string name): BranchWrapperBase(name){
-  value_ = 999 ;
-}
-int BranchWrapperU::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &value_, Form("%s/i", name().c_str())) ;
-  return 0 ;
-}
-void BranchWrapperU::set(unsigned int value){
-  value_ = value ;
-  fill() ;
-}
-void BranchWrapperU::beginEvent(){
-  value_ = 999 ;
-  unfill() ;
-}
-void BranchWrapperU::endEvent(){}
-
-// unsigned long int
-BranchWrapperUL::BranchWrapperUL(std::string name): BranchWrapperBase(name){
-  value_ = 999 ;
-}
-int BranchWrapperUL::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &value_, Form("%s/l", name().c_str())) ;
-  return 0 ;
-}
-void BranchWrapperUL::set(unsigned long int value){
-  value_ = value ;
-  fill() ;
-}
-void BranchWrapperUL::beginEvent(){
-  value_ = 999 ;
-  unfill() ;
-}
-void BranchWrapperUL::endEvent(){}
 //////////////////////////////////////////////////////////////////////////////////////////
 //                                    Vector classes                                    //
 //////////////////////////////////////////////////////////////////////////////////////////
-// Vector of bools
-BranchWrapperBV::BranchWrapperBV(std::string name): BranchWrapperBase(name){}
-BranchWrapperBV::~BranchWrapperBV(){}
-int BranchWrapperBV::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &values_) ;
-  return 0 ;
-}
-void BranchWrapperBV::push(bool value){
-  values_.push_back(value) ;
-  fill() ;
-}
-void BranchWrapperBV::beginEvent(){
-  unfill() ;
-  values_.clear() ;
-}
-void BranchWrapperBV::endEvent(){}
-
-// Vector of doubles
-BranchWrapperDV::BranchWrapperDV(std::string name): BranchWrapperBase(name){}
-BranchWrapperDV::~BranchWrapperDV(){}
-int BranchWrapperDV::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &values_) ;
-  return 0 ;
-}
-void BranchWrapperDV::push(double value){
-  values_.push_back(value) ;
-  fill();
-}
-void BranchWrapperDV::beginEvent(){
-  unfill() ;
-  values_.clear() ;
-}
-void BranchWrapperDV::endEvent(){}
-
 // Vector of floats
 BranchWrapperFV::BranchWrapperFV(std::string name): BranchWrapperBase(name){}
 BranchWrapperFV::~BranchWrapperFV(){}
@@ -215,24 +60,24 @@ void BranchWrapperFV::beginEvent(){
 }
 void BranchWrapperFV::endEvent(){}
 
-// Vector of ints
-BranchWrapperIV::BranchWrapperIV(std::string name): BranchWrapperBase(name){}
-BranchWrapperIV::~BranchWrapperIV(){}
-int BranchWrapperIV::config(TTree* tree){
+// Vector of doubles
+BranchWrapperDV::BranchWrapperDV(std::string name): BranchWrapperBase(name){}
+BranchWrapperDV::~BranchWrapperDV(){}
+int BranchWrapperDV::config(TTree* tree){
   if(!tree) return 1 ;
   if(tree->GetBranch(name().c_str())) return 2 ;
   tree->Branch(name().c_str(), &values_) ;
   return 0 ;
 }
-void BranchWrapperIV::push(int value){
+void BranchWrapperDV::push(double value){
   values_.push_back(value) ;
   fill() ;
 }
-void BranchWrapperIV::beginEvent(){
+void BranchWrapperDV::beginEvent(){
   unfill() ;
   values_.clear() ;
 }
-void BranchWrapperIV::endEvent(){}
+void BranchWrapperDV::endEvent(){}
 
 // Vector of char
 BranchWrapperCV::BranchWrapperCV(std::string name): BranchWrapperBase(name){}
@@ -252,198 +97,3 @@ void BranchWrapperCV::beginEvent(){
   values_.clear() ;
 }
 void BranchWrapperCV::endEvent(){}
-
-
-// Vector of unsigned long ints
-BranchWrapperULV::BranchWrapperULV(std::string name): BranchWrapperBase(name){}
-BranchWrapperULV::~BranchWrapperULV(){}
-int BranchWrapperULV::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &values_) ;
-  return 0 ;
-}
-void BranchWrapperULV::push(unsigned long int value){
-  values_.push_back(value) ;
-  fill() ;
-}
-void BranchWrapperULV::beginEvent(){
-  unfill() ;
-  values_.clear() ;
-}
-void BranchWrapperULV::endEvent(){}
-
-// Vector of unsigned  ints
-BranchWrapperUV::BranchWrapperUV(std::string name): BranchWrapperBase(name){}
-BranchWrapperUV::~BranchWrapperUV(){}
-int BranchWrapperUV::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &values_) ;
-  return 0 ;
-}
-void BranchWrapperUV::push(unsigned int value){
-  values_.push_back(value) ;
-  fill() ;
-}
-void BranchWrapperUV::beginEvent(){
-  unfill() ;
-  values_.clear() ;
-}
-void BranchWrapperUV::endEvent(){}
-
-
-////////////////////////////////////////////////////////////////////////////////////////
-//                                Vector vector classes                               //
-////////////////////////////////////////////////////////////////////////////////////////
-// Vector of vector of bools
-BranchWrapperBVV::BranchWrapperBVV(std::string name): BranchWrapperBase(name){}
-BranchWrapperBVV::~BranchWrapperBVV(){}
-int BranchWrapperBVV::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &values_) ;
-  return 0 ;
-}
-void BranchWrapperBVV::push(std::vector<bool> value){
-  values_.push_back(value) ;
-  fill();
-}
-void BranchWrapperBVV::beginEvent(){
-  unfill() ;
-  values_.clear() ;
-}
-void BranchWrapperBVV::endEvent(){}
-
-// Vector of vector of doubles
-BranchWrapperDVV::BranchWrapperDVV(std::string name): BranchWrapperBase(name){}
-BranchWrapperDVV::~BranchWrapperDVV(){}
-int BranchWrapperDVV::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &values_) ;
-  return 0 ;
-}
-void BranchWrapperDVV::push(std::vector<double> value){
-  values_.push_back(value) ;
-  fill();
-}
-void BranchWrapperDVV::beginEvent(){
-  unfill() ;
-  values_.clear() ;
-}
-void BranchWrapperDVV::endEvent(){}
-
-// Vector of vector of floats
-BranchWrapperFVV::BranchWrapperFVV(std::string name): BranchWrapperBase(name){}
-BranchWrapperFVV::~BranchWrapperFVV(){}
-int BranchWrapperFVV::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &values_) ;
-  return 0 ;
-}
-void BranchWrapperFVV::push(std::vector<float> value){
-  values_.push_back(value) ;
-  fill() ;
-}
-void BranchWrapperFVV::beginEvent(){
-  unfill() ;
-  values_.clear() ;
-}
-void BranchWrapperFVV::endEvent(){}
-
-// Vector of vector of ints
-BranchWrapperIVV::BranchWrapperIVV(std::string name): BranchWrapperBase(name){}
-BranchWrapperIVV::~BranchWrapperIVV(){}
-int BranchWrapperIVV::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &values_) ;
-  return 0 ;
-}
-void BranchWrapperIVV::push(std::vector<int> value){
-  values_.push_back(value) ;
-  fill() ;
-}
-void BranchWrapperIVV::beginEvent(){
-  unfill() ;
-  values_.clear() ;
-}
-void BranchWrapperIVV::endEvent(){}
-
-// Vector of vector of unsigned ints
-BranchWrapperUVV::BranchWrapperUVV(std::string name): BranchWrapperBase(name){}
-BranchWrapperUVV::~BranchWrapperUVV(){}
-int BranchWrapperUVV::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &values_) ;
-  return 0 ;
-}
-void BranchWrapperUVV::push(std::vector<unsigned int> value){
-  values_.push_back(value) ;
-  fill() ;
-}
-void BranchWrapperUVV::beginEvent(){
-  unfill() ;
-  values_.clear() ;
-}
-void BranchWrapperUVV::endEvent(){}
-
-//////////////////////////////////////////////////////////////////////////////////////////
-//                           Templated classes (not used, yet)                          //
-//////////////////////////////////////////////////////////////////////////////////////////
-template <class T>
-branchWrapper_simple<T>::branchWrapper_simple(std::string name){
-  name_  = name ;
-  value_ = -999 ;
-}
-template <class T>
-int branchWrapper_simple<T>::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &value_, Form("%s/F", name().c_str())) ;
-  return 0 ;
-}
-template <class T> void branchWrapper_simple<T>::beginEvent(){ value_ = -999 ; }
-template <class T> void branchWrapper_simple<T>::endEvent(){}
-template <class T> void branchWrapper_simple<T>::set(T value){ value_ = value ; }
-template <class T> T    branchWrapper_simple<T>::get(){ return value_ ; }
-
-template <class T>
-branchWrapper_vector<T>::branchWrapper_vector(std::string name){
-  name_   = name ;
-  values_ = 0 ;
-  std::cout << typeid(T).name() << std::endl ;
-}
-template <class T>
-int branchWrapper_vector<T>::config(TTree* tree){
-  if(!tree) return 1 ;
-  if(tree->GetBranch(name().c_str())) return 2 ;
-  tree->Branch(name().c_str(), &values_) ;
-  return 0 ;
-}
-template <class T> bool branchWrapper_vector<T>::beginEvent(){
-  if(!values_) return false ;
-  values_->clear() ;
-  return true ;
-}
-template <class T> bool branchWrapper_vector<T>::endEvent(){
-  if(!values_) return false ;
-  return true ;
-}
-template <class T> bool branchWrapper_vector<T>::push(T value){
-  if(!values_) return false ;
-  values_->push_back(value) ;
-  return true ;
-}
-template <class T> T    branchWrapper_vector<T>::get(int index){
-  if(!values_) return -999 ;
-  return values_->at(index) ;
-}
-template <class T> int  branchWrapper_vector<T>::nEntries(){
-  if(!values_) return -1 ;
-  return values_->size() ;
-}
-
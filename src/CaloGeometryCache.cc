@@ -0,0 +1,33 @@
+#include "UserCode/IIHETree/interface/CaloGeometryCache.h"
+
+#include "FWCore/Framework/interface/ESHandle.h"
+#include "Geometry/Records/interface/CaloGeometryRecord.h"
+#include "DataFormats/DetId/interface/DetId.h"
+#include "DataFormats/EcalDetId/interface/EcalSubdetector.h"
+
+CaloGeometryCache::CaloGeometryCache():
+cacheId_(0),
+geometry_(0),
+geometryPreshower_(0),
+nBuilds_(0){}
+
+void CaloGeometryCache::update(const edm::EventSetup& iSetup){
+  const CaloGeometryRecord& record = iSetup.get<CaloGeometryRecord>() ;
+  unsigned long long cacheId = record.cacheIdentifier() ;
+  if(geometry_ && cacheId==cacheId_) return ;
+
+  // The product stays valid as long as the IOV does not change, so keeping the pointer
+  // is safe until cacheIdentifier moves on
+  edm::ESHandle<CaloGeometry> pGeometry ;
+  record.get(pGeometry) ;
+  update(cacheId, pGeometry.product()) ;
+}
+
+void CaloGeometryCache::update(unsigned long long cacheId, const CaloGeometry* geometry){
+  if(geometry_ && cacheId==cacheId_) return ;
+  geometry_ = geometry ;
+  geometryPreshower_ = geometry_->getSubdetectorGeometry(DetId::Ecal, EcalPreshower) ;
+  topologyPreshower_.reset(geometryPreshower_ ? new EcalPreshowerTopology(geometry_) : 0) ;
+  cacheId_ = cacheId ;
+  nBuilds_++ ;
+}
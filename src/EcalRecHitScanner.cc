@@ -0,0 +1,90 @@
+#include "UserCode/IIHETree/interface/EcalRecHitScanner.h"
+#include "UserCode/IIHETree/interface/utilities.h"
+
+#include "DataFormats/EcalDetId/interface/EBDetId.h"
+#include "DataFormats/EcalDetId/interface/EEDetId.h"
+
+EcalRecHitScanner::EcalRecHitScanner(std::string prefix, bool isEndcap, float energyThreshold,
+                                     const std::vector<std::string>& saturationFlags,
+                                     const std::vector<std::string>& storedFlags){
+  prefix_          = prefix ;
+  isEndcap_        = isEndcap ;
+  energyThreshold_ = energyThreshold ;
+  saturationMask_  = 0 ;
+  flagsOr_         = 0 ;
+  for(unsigned int i=0 ; i<saturationFlags.size() ; ++i){
+    int flag = flagFromName(saturationFlags.at(i)) ;
+    if(flag<0) ERROR(("EcalRecHitScanner: unknown rechit flag "+saturationFlags.at(i))) ;
+    saturationMask_ |= (0x1u << flag) ;
+  }
+  for(unsigned int i=0 ; i<storedFlags.size() ; ++i){
+    int flag = flagFromName(storedFlags.at(i)) ;
+    if(flag<0) ERROR(("EcalRecHitScanner: unknown rechit flag "+storedFlags.at(i))) ;
+    storedFlags_.push_back(flag) ;
+    storedFlagNames_.push_back(storedFlags.at(i)) ;
+  }
+  flags_.resize(storedFlags_.size()) ;
+}
+
+int EcalRecHitScanner::flagFromName(const std::string& name){
+  static const char* names[] = {
+    "kGood", "kPoorReco", "kOutOfTime", "kFaultyHardware", "kNoisy", "kPoorCalib",
+    "kSaturated", "kLeadingEdgeRecovered", "kNeighboursRecovered", "kTowerRecovered",
+    "kDead", "kKilled", "kTPSaturated", "kL1SpikeFlag", "kWeird", "kDiWeird",
+    "kHasSwitchToGain6", "kHasSwitchToGain1"
+  } ;
+  static const int values[] = {
+    EcalRecHit::kGood, EcalRecHit::kPoorReco, EcalRecHit::kOutOfTime, EcalRecHit::kFaultyHardware,
+    EcalRecHit::kNoisy, EcalRecHit::kPoorCalib, EcalRecHit::kSaturated,
+    EcalRecHit::kLeadingEdgeRecovered, EcalRecHit::kNeighboursRecovered,
+    EcalRecHit::kTowerRecovered, EcalRecHit::kDead, EcalRecHit::kKilled,
+    EcalRecHit::kTPSaturated, EcalRecHit::kL1SpikeFlag, EcalRecHit::kWeird,
+    EcalRecHit::kDiWeird, EcalRecHit::kHasSwitchToGain6, EcalRecHit::kHasSwitchToGain1
+  } ;
+  for(unsigned int i=0 ; i<sizeof(values)/sizeof(values[0]) ; ++i){
+    if(name==names[i]) return values[i] ;
+  }
+  return -1 ;
+}
+
+void EcalRecHitScanner::scan(const EcalRecHitCollection& hits){
+  // First pass over every hit: a branch free OR of the flag words, and the positions of
+  // the hits that pass the threshold.  Hits below it are never looked at again.
+  const unsigned int nHits = hits.size() ;
+  uint32_t flagsOr = 0 ;
+  selected_.clear() ;
+  for(unsigned int i=0 ; i<nHits ; ++i){
+    const EcalRecHit& hit = hits[i] ;
+    flagsOr |= hit.flagsBits() ;
+    if(!(hit.energy()<energyThreshold_)) selected_.push_back(i) ;
+  }
+  flagsOr_ = flagsOr ;
+
+  const unsigned int nSelected = selected_.size() ;
+  rawId_   .resize(nSelected) ;
+  iRechit_ .resize(nSelected) ;
+  energy_  .resize(nSelected) ;
+  ieta_    .resize(nSelected) ;
+  iphi_    .resize(nSelected) ;
+  recoFlag_.resize(nSelected) ;
+  for(unsigned int f=0 ; f<storedFlags_.size() ; ++f) flags_.at(f).resize(nSelected) ;
+  for(unsigned int j=0 ; j<nSelected ; ++j){
+    const EcalRecHit& hit = hits[selected_[j]] ;
+    rawId_   [j] = hit.id().rawId() ;
+    iRechit_ [j] = j+1 ;
+    energy_  [j] = hit.energy() ;
+    recoFlag_[j] = hit.recoFlag() ;
+    if(isEndcap_){
+      // Same convention as gsf_sc_seed_ieta/iphi for the endcap
+      EEDetId elementId(hit.id()) ;
+      ieta_[j] = elementId.iy() ;
+      iphi_[j] = elementId.ix() ;
+    }
+    else{
+      EBDetId elementId(hit.id()) ;
+      ieta_[j] = elementId.ieta() ;
+      iphi_[j] = elementId.iphi() ;
+    }
+    for(unsigned int f=0 ; f<storedFlags_.size() ; ++f) flags_[f][j] = hit.checkFlag(storedFlags_[f]) ;
+  }
+}
@@ -0,0 +1,77 @@
+#include "UserCode/IIHETree/interface/EcalShapeCache.h"
+#include "UserCode/IIHETree/interface/CaloGeometryCache.h"
+
+#include "DataFormats/EgammaReco/interface/BasicCluster.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+EcalShapeCache::EcalShapeCache():
+nLookups_(0),
+nHits_(0),
+nLookupsTotal_(0),
+nHitsTotal_(0){}
+
+void EcalShapeCache::clear(){
+  tools_.reset() ;
+  shapes_.clear() ;
+  nLookups_ = 0 ;
+  nHits_    = 0 ;
+}
+
+EcalClusterLazyTools& EcalShapeCache::tools(const edm::Event& iEvent, const edm::EventSetup& iSetup,
+                                            edm::EDGetTokenT<EcalRecHitCollection> ebRecHits,
+                                            edm::EDGetTokenT<EcalRecHitCollection> eeRecHits,
+                                            edm::EDGetTokenT<EcalRecHitCollection> esRecHits){
+  if(!tools_){
+    tools_.reset(new EcalClusterLazyTools(iEvent, iSetup, ebRecHits, eeRecHits, esRecHits)) ;
+    ebRecHits_ = ebRecHits ;
+    eeRecHits_ = eeRecHits ;
+    esRecHits_ = esRecHits ;
+  }
+  else if(ebRecHits.index()!=ebRecHits_.index() || eeRecHits.index()!=eeRecHits_.index() || esRecHits.index()!=esRecHits_.index()){
+    throw cms::Exception("LogicError") << "EcalShapeCache::tools called with other rechit collections than the tools of this event were made from" ;
+  }
+  return *tools_ ;
+}
+
+const EcalClusterShapes& EcalShapeCache::shapes(const reco::SuperClusterRef& sc, const CaloGeometryCache& caloGeometry){
+  nLookups_++ ;
+  nLookupsTotal_++ ;
+  std::map<reco::SuperClusterRef, EcalClusterShapes>::iterator it = shapes_.find(sc) ;
+  if(it!=shapes_.end()){
+    nHits_++ ;
+    nHitsTotal_++ ;
+    return it->second ;
+  }
+
+  EcalClusterLazyTools& lazytool = *tools_ ;
+  const reco::CaloClusterPtr seed = sc->seed() ;
+  EcalClusterShapes& s = shapes_[sc] ;
+  s.e2x5Right  = lazytool.e2x5Right (*seed) ;
+  s.e2x5Left   = lazytool.e2x5Left  (*seed) ;
+  s.e2x5Top    = lazytool.e2x5Top   (*seed) ;
+  s.e2x5Bottom = lazytool.e2x5Bottom(*seed) ;
+  s.eMax       = lazytool.eMax      (*seed) ;
+  s.e2nd       = lazytool.e2nd      (*seed) ;
+  s.eRight     = lazytool.eRight    (*seed) ;
+  s.eLeft      = lazytool.eLeft     (*seed) ;
+  s.eTop       = lazytool.eTop      (*seed) ;
+  s.eBottom    = lazytool.eBottom   (*seed) ;
+  s.e2x2       = lazytool.e2x2      (*seed) ;
+  s.e3x3       = lazytool.e3x3      (*seed) ;
+  s.e4x4       = lazytool.e4x4      (*seed) ;
+  s.e5x5       = lazytool.e5x5      (*seed) ;
+  s.e1x5       = lazytool.e1x5      (*seed) ;
+  s.e5x1       = lazytool.e5x1      (*seed) ;
+  s.e1x3       = lazytool.e1x3      (*seed) ;
+  s.e3x1       = lazytool.e3x1      (*seed) ;
+  s.seedTime   = lazytool.BasicClusterSeedTime(*seed) ;
+
+  CaloGeometry* geometry = (CaloGeometry*) caloGeometry.geometry() ;
+  CaloSubdetectorTopology* topology_ES = (CaloSubdetectorTopology*) caloGeometry.topologyPreshower() ;
+  s.eshitsixix = lazytool.getESHits(sc->x(), sc->y(), sc->z(), lazytool.rechits_map_, geometry, topology_ES, 0, 1) ;
+  s.eshitsiyiy = lazytool.getESHits(sc->x(), sc->y(), sc->z(), lazytool.rechits_map_, geometry, topology_ES, 0, 2) ;
+  s.eseffsixix = lazytool.eseffsixix(*sc) ;
+  s.eseffsiyiy = lazytool.eseffsiyiy(*sc) ;
+  s.eseffsirir = lazytool.eseffsirir(*sc) ;
+  return s ;
+}
@@ -0,0 +1,136 @@
+#include "UserCode/IIHETree/interface/EtaPhiGrid.h"
+
+#include "DataFormats/Math/interface/deltaR.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Below this many objects a plain scan is cheaper than walking the cells
+static const unsigned int kLinearScanSize = 16 ;
+
+// Allowance for rounding in DeltaR when comparing against a cell distance
+static const float kDeltaRMargin = 1e-4 ;
+
+EtaPhiGrid::EtaPhiGrid(float etaMax, float cellSize){
+  etaMax_ = etaMax ;
+  // Regular cells in eta, plus one overflow cell on each side
+  int nEtaRegular = std::max(1, (int) std::ceil(2*etaMax/cellSize)) ;
+  etaWidth_ = 2*etaMax/nEtaRegular ;
+  nEta_ = nEtaRegular + 2 ;
+  // Phi cells are never narrower than the eta cells, so one cell width bounds both
+  nPhi_ = std::max(1, (int) std::floor(2*M_PI/cellSize)) ;
+  phiWidth_ = 2*M_PI/nPhi_ ;
+  cells_.resize(nEta_*nPhi_) ;
+}
+
+void EtaPhiGrid::clear(){
+  for(unsigned int i=0 ; i<cells_.size() ; ++i) cells_.at(i).clear() ;
+  etas_   .clear() ;
+  phis_   .clear() ;
+  indices_.clear() ;
+}
+
+int EtaPhiGrid::etaCell(float eta) const {
+  if(!(eta>-etaMax_)) return 0 ; // Also catches NaN
+  if(!(eta< etaMax_)) return nEta_-1 ;
+  int ieta = 1 + (int) ((eta+etaMax_)/etaWidth_) ;
+  return std::min(ieta, nEta_-2) ;
+}
+int EtaPhiGrid::phiCell(float phi) const {
+  if(!(phi==phi)) return 0 ;
+  double x = std::fmod(phi+M_PI, 2*M_PI) ;
+  if(x<0) x += 2*M_PI ;
+  int iphi = (int) (x/phiWidth_) ;
+  return std::min(std::max(iphi, 0), nPhi_-1) ;
+}
+
+void EtaPhiGrid::insert(float eta, float phi, int index){
+  cells_.at(cell(etaCell(eta), phiCell(phi))).push_back(etas_.size()) ;
+  etas_   .push_back(eta  ) ;
+  phis_   .push_back(phi  ) ;
+  indices_.push_back(index) ;
+}
+
+void EtaPhiGrid::neighbours(float eta, float phi, float radius, std::vector<int>& result) const {
+  int ieta = etaCell(eta) ;
+  int iphi = phiCell(phi) ;
+  int nRings = 1 + (int) std::ceil((radius+kDeltaRMargin)/etaWidth_) ;
+  int phiLow  = -std::min(nRings, (nPhi_-1)/2) ;
+  int phiHigh =  std::min(nRings,  nPhi_   /2) ;
+  for(int r=std::max(0, ieta-nRings) ; r<=std::min(nEta_-1, ieta+nRings) ; ++r){
+    for(int d=phiLow ; d<=phiHigh ; ++d){
+      const std::vector<int>& slots = cells_.at(cell(r, (iphi+d+nPhi_)%nPhi_)) ;
+      for(unsigned int i=0 ; i<slots.size() ; ++i) result.push_back(indices_.at(slots.at(i))) ;
+    }
+  }
+}
+
+void EtaPhiGrid::visit(int r, int d, int iphi, float eta, float phi, float& bestDR, int& bestIndex) const {
+  if(r<0 || r>=nEta_) return ;
+  const std::vector<int>& slots = cells_.at(cell(r, ((iphi+d)%nPhi_+nPhi_)%nPhi_)) ;
+  for(unsigned int i=0 ; i<slots.size() ; ++i){
+    int slot = slots.at(i) ;
+    float DR = deltaR(etas_.at(slot), phis_.at(slot), eta, phi) ;
+    int index = indices_.at(slot) ;
+    if(DR<bestDR || (DR==bestDR && bestIndex>=0 && index<bestIndex)){
+      bestDR = DR ;
+      bestIndex = index ;
+    }
+  }
+}
+
+int EtaPhiGrid::nearestLinear(const std::vector<float>& etas, const std::vector<float>& phis, float eta, float phi){
+  float bestDR = 1e6 ;
+  int bestIndex = -1 ;
+  for(unsigned int i=0 ; i<etas.size() ; ++i){
+    float DR = deltaR(etas.at(i), phis.at(i), eta, phi) ;
+    if(DR<bestDR){
+      bestDR = DR ;
+      bestIndex = i ;
+    }
+  }
+  return bestIndex ;
+}
+
+int EtaPhiGrid::nearest(float eta, float phi) const {
+  float bestDR = 1e6 ;
+  int bestIndex = -1 ;
+  if(etas_.size()<kLinearScanSize){
+    for(unsigned int slot=0 ; slot<etas_.size() ; ++slot){
+      float DR = deltaR(etas_.at(slot), phis_.at(slot), eta, phi) ;
+      int index = indices_.at(slot) ;
+      if(DR<bestDR || (DR==bestDR && bestIndex>=0 && index<bestIndex)){
+        bestDR = DR ;
+        bestIndex = index ;
+      }
+    }
+    return bestIndex ;
+  }
+
+  // Walk outwards one ring of cells at a time.  Everything in ring k is at least (k-1)
+  // cell widths away, so once that exceeds the best DeltaR found nothing can beat it.
+  int ieta = etaCell(eta) ;
+  int iphi = phiCell(phi) ;
+  int maxRing = std::max(nEta_, nPhi_/2) + 1 ;
+  for(int k=0 ; k<=maxRing ; ++k){
+    float lowerBound = (k-1)*etaWidth_ ;
+    if(bestIndex>=0 && lowerBound>bestDR+kDeltaRMargin) break ;
+
+    // Rows k cells away in eta take every phi cell up to k away...
+    int phiLow  = -std::min(k, (nPhi_-1)/2) ;
+    int phiHigh =  std::min(k,  nPhi_   /2) ;
+    for(int d=phiLow ; d<=phiHigh ; ++d){
+      visit(ieta-k, d, iphi, eta, phi, bestDR, bestIndex) ;
+      if(k>0) visit(ieta+k, d, iphi, eta, phi, bestDR, bestIndex) ;
+    }
+    // ...and the rows in between only take the phi cells exactly k away
+    if(k==0) continue ;
+    bool lowSide  = (k<=(nPhi_-1)/2) ;
+    bool highSide = (k<= nPhi_   /2) ;
+    for(int r=ieta-k+1 ; r<=ieta+k-1 ; ++r){
+      if(lowSide ) visit(r, -k, iphi, eta, phi, bestDR, bestIndex) ;
+      if(highSide) visit(r,  k, iphi, eta, phi, bestDR, bestIndex) ;
+    }
+  }
+  return bestIndex ;
+}
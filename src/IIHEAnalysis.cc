@@ -2,8 +2,14 @@
 #include <iostream>
 #include <TMath.h>
 #include <vector>
+#include <algorithm>
+
+#include <chrono>
+#include <malloc.h>
+#include <typeinfo>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/core/demangle.hpp>
 
 // IIHE includes
 #include "UserCode/IIHETree/interface/IIHEAnalysis.h"
@@ -34,6 +40,13 @@ using namespace reco;
 using namespace edm ;
 
 IIHEAnalysis::IIHEAnalysis(const edm::ParameterSet& iConfig):
+vars_B_(false),
+vars_D_(-999),
+vars_F_(-999),
+vars_I_(-999),
+vars_C_(std::string(), false),
+vars_U_(999),
+vars_UL_(999),
 hltPrescaleProvider_(iConfig, consumesCollector(), *this)
 {
   currentVarType_ = -1 ;
@@ -72,7 +85,15 @@ hltPrescaleProvider_(iConfig, consumesCollector(), *this)
   includeZBosonModule_          = iConfig.getUntrackedParameter<bool>("includeZBosonModule"        ) ;
   includeAutoAcceptEventModule_ = iConfig.getUntrackedParameter<bool>("includeAutoAcceptEventModule") ;
   
-  if(includeLeptonsAcceptModule_  ) childModules_.push_back(new IIHEModuleLeptonsAccept(iConfig ,consumesCollector())  ) ;   
+  // Gates are cheap selectors that run before everything else.  When one of them rejects
+  // the event the rest of the modules are not run at all.
+  leptonsAcceptAsGate_          = iConfig.getUntrackedParameter<bool>("leptonsAcceptAsGate", false) ;
+  
+  if(includeLeptonsAcceptModule_  ){
+    IIHEModule* leptonsAcceptModule = new IIHEModuleLeptonsAccept(iConfig ,consumesCollector()) ;
+    childModules_.push_back(leptonsAcceptModule) ;
+    if(leptonsAcceptAsGate_) addGate("LeptonsAccept", leptonsAcceptModule) ;
+  }
   if(includeEventModule_          ) childModules_.push_back(new IIHEModuleEvent(iConfig   ,consumesCollector()       )) ;
   if(includeLHEWeightModule_         ) childModules_.push_back(new IIHEModuleLHEWeight(iConfig ,consumesCollector())         ) ;
   if(includeMCTruthModule_        ){
@@ -92,10 +113,71 @@ hltPrescaleProvider_(iConfig, consumesCollector(), *this)
   if(includeZBosonModule_         ) childModules_.push_back(new IIHEModuleZBoson(iConfig ,consumesCollector())         ) ;  
   if(includeAutoAcceptEventModule_) childModules_.push_back(new IIHEModuleAutoAcceptEvent(iConfig ,consumesCollector())) ; 
   if(includeTriggerModule_        ) childModules_.push_back(new IIHEModuleTrigger(iConfig,consumesCollector())        ) ; 
+  
+  // Everything that is not a gate runs in the main stage, in the order given above
+  for(unsigned int i=0 ; i<childModules_.size() ; ++i){
+    if(std::find(gateIndices_.begin(), gateIndices_.end(), i)!=gateIndices_.end()) continue ;
+    mainIndices_.push_back(i) ;
+  }
+  
+  profileModuleMemory_ = iConfig.getUntrackedParameter<bool>("profileModuleMemory", false) ;
+  for(unsigned int i=0 ; i<childModules_.size() ; ++i){
+    moduleProfiles_.push_back(IIHEModuleProfile(boost::core::demangle(typeid(*childModules_.at(i)).name()))) ;
+  }
+}
+
+void IIHEAnalysis::addGate(std::string name, IIHEModule* module){
+  unsigned int index = std::find(childModules_.begin(), childModules_.end(), module) - childModules_.begin() ;
+  gateIndices_   .push_back(index) ;
+  gateNames_     .push_back(name ) ;
+  gatePassCounts_.push_back(0    ) ;
+}
+
+// Wall time and (optionally) net heap growth of each module call.  The heap is measured
+// with mallinfo2, which walks the allocator state, so it is only done on request.  Older
+// glibc only has mallinfo, whose int fields wrap once the heap passes 2 GB.  The totals
+// are then only known modulo 2^32, which still gives the growth within one call as long
+// as it is below 2 GB either way.
+#if defined(__GLIBC__) && (__GLIBC__>2 || (__GLIBC__==2 && __GLIBC_MINOR__>=33))
+#define IIHE_HAVE_MALLINFO2
+#endif
+static double heapBytesInUse(){
+#ifdef IIHE_HAVE_MALLINFO2
+  struct mallinfo2 info = mallinfo2() ;
+  return (double)info.uordblks + (double)info.hblkhd ;
+#else
+  struct mallinfo info = mallinfo() ;
+  return (double)(unsigned int)info.uordblks + (double)(unsigned int)info.hblkhd ;
+#endif
+}
+static double heapGrowth(double start, double end){
+  double growth = end - start ;
+#ifndef IIHE_HAVE_MALLINFO2
+  const double wrap = 4294967296. ;
+  while(growth >  0.5*wrap) growth -= wrap ;
+  while(growth < -0.5*wrap) growth += wrap ;
+#endif
+  return growth ;
+}
+void IIHEAnalysis::startProfile(){
+  if(profileModuleMemory_) profileHeapStart_ = heapBytesInUse() ;
+  profileTimeStart_ = std::chrono::steady_clock::now() ;
+}
+void IIHEAnalysis::stopProfile(unsigned int index, bool countCall){
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - profileTimeStart_ ;
+  IIHEModuleProfile& profile = moduleProfiles_.at(index) ;
+  profile.wallTime += elapsed.count() ;
+  if(countCall) profile.nCalls++ ;
+  if(profileModuleMemory_) profile.heapBytes += heapGrowth(profileHeapStart_, heapBytesInUse()) ;
 }
 
 IIHEAnalysis::~IIHEAnalysis(){}
 
+const CaloGeometryCache& IIHEAnalysis::getCaloGeometry(const edm::EventSetup& iSetup){
+  caloGeometry_.update(iSetup) ;
+  return caloGeometry_ ;
+}
+
 const MCTruthObject* IIHEAnalysis::MCTruth_getRecordByIndex(int index){
   if(MCTruthModule_){
     return MCTruthModule_->getRecordByIndex(index) ;
@@ -132,11 +214,26 @@ bool IIHEAnalysis::addFVValueToMetaTree(std::string parName, std::vector<float>
   return true ;
 }
 
-bool IIHEAnalysis::branchExists(std::string name){
-  for(unsigned int i=0 ; i<allVars_.size() ; ++i){
-    if(allVars_.at(i)->name()==name) return true ;
+bool IIHEAnalysis::addDVValueToMetaTree(std::string parName, std::vector<double> value){
+  BranchWrapperDV* bw = new BranchWrapperDV(parName) ;
+  for (unsigned int i=0 ; i<value.size() ; ++i){
+    bw->push(value[i]);
   }
-  return false ;
+  bw->config(metaTree_) ;
+  return true ;
+}
+
+bool IIHEAnalysis::addCVValueToMetaTree(std::string parName, std::vector<std::string> value){
+  BranchWrapperCV* bw = new BranchWrapperCV(parName) ;
+  for (unsigned int i=0 ; i<value.size() ; ++i){
+    bw->push(value[i]);
+  }
+  bw->config(metaTree_) ;
+  return true ;
+}
+
+bool IIHEAnalysis::branchExists(std::string name){
+  return branchHandles_.find(name)!=branchHandles_.end() ;
 }
 
 void IIHEAnalysis::setBranchType(int type){ currentVarType_ = type ; }
@@ -144,131 +241,46 @@ int  IIHEAnalysis::getBranchType(){ return currentVarType_ ; }
 
 bool IIHEAnalysis::addBranch(std::string name){ return addBranch(name, currentVarType_) ; }
 bool IIHEAnalysis::addBranch(std::string name, int type){
+  BranchHandle handle ;
+  return addBranch(name, type, handle) ;
+}
+// Same as above, but also hands back a handle to the new branch for use with store()
+bool IIHEAnalysis::addBranch(std::string name, int type, BranchHandle& handle){
+  handle = BranchHandle() ;
   // First check to see if this branch name has already been used
   bool success = !(branchExists(name)) ;
   if(debug_) std::cout << "Adding a branch named " << name << " " << success << endl ;
   if(success==false){
     return false ;
   }
-  listOfBranches_.push_back(std::pair<std::string,int>(name,type)) ;
+  int index = -1 ;
   switch(type){
-    case kBool:{
-      BranchWrapperB*  bw = new BranchWrapperB(name) ;
-      vars_B_  .push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kDouble:{
-      BranchWrapperD*  bw = new BranchWrapperD(name) ;
-      vars_D_  .push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-    }
-    case kFloat:{
-      BranchWrapperF*  bw = new BranchWrapperF(name) ;
-      vars_F_  .push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kInt:{
-      BranchWrapperI*  bw = new BranchWrapperI(name) ;
-      vars_I_  .push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kChar:{
-      BranchWrapperC*  bw = new BranchWrapperC(name) ;
-      vars_C_  .push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kUInt:{
-      BranchWrapperU*  bw = new BranchWrapperU(name) ;
-      vars_U_  .push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kULInt:{
-      BranchWrapperUL*  bw = new BranchWrapperUL(name) ;
-      vars_UL_  .push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kVectorBool:{
-      BranchWrapperBV* bw = new BranchWrapperBV(name) ;
-      vars_BV_ .push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kVectorDouble:{
-      BranchWrapperDV* bw = new BranchWrapperDV(name) ;
-      vars_DV_ .push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kVectorFloat:{
-      BranchWrapperFV* bw = new BranchWrapperFV(name) ;
-      vars_FV_ .push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kVectorInt:{
-      BranchWrapperIV* bw = new BranchWrapperIV(name) ;
-      vars_IV_ .push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kVectorChar:{
-      BranchWrapperCV* bw = new BranchWrapperCV(name) ;
-      vars_CV_ .push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kVectorUInt:{
-      BranchWrapperUV* bw = new BranchWrapperUV(name) ;
-      vars_UV_ .push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kVectorULInt:{
-      BranchWrapperULV* bw = new BranchWrapperULV(name) ;
-      vars_ULV_ .push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kVectorVectorBool:{
-      BranchWrapperBVV* bw = new BranchWrapperBVV(name) ;
-      vars_BVV_.push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kVectorVectorDouble:{
-      BranchWrapperDVV* bw = new BranchWrapperDVV(name) ;
-      vars_DVV_.push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kVectorVectorFloat:{
-      BranchWrapperFVV* bw = new BranchWrapperFVV(name) ;
-      vars_FVV_.push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kVectorVectorInt:{
-      BranchWrapperIVV* bw = new BranchWrapperIVV(name) ;
-      vars_IVV_.push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
-    case kVectorVectorUInt:{
-      BranchWrapperUVV* bw = new BranchWrapperUVV(name) ;
-      vars_UVV_.push_back(bw) ;
-      allVars_.push_back((BranchWrapperBase*)bw) ;
-      break ;
-    }
+    case kBool               : index = vars_B_  .add(name) ; break ;
+    case kDouble             : index = vars_D_  .add(name) ; break ;
+    case kFloat              : index = vars_F_  .add(name) ; break ;
+    case kInt                : index = vars_I_  .add(name) ; break ;
+    case kChar               : index = vars_C_  .add(name) ; break ;
+    case kUInt               : index = vars_U_  .add(name) ; break ;
+    case kULInt              : index = vars_UL_ .add(name) ; break ;
+    case kVectorBool         : index = vars_BV_ .add(name) ; break ;
+    case kVectorDouble       : index = vars_DV_ .add(name) ; break ;
+    case kVectorFloat        : index = vars_FV_ .add(name) ; break ;
+    case kVectorInt          : index = vars_IV_ .add(name) ; break ;
+    case kVectorChar         : index = vars_CV_ .add(name) ; break ;
+    case kVectorUInt         : index = vars_UV_ .add(name) ; break ;
+    case kVectorULInt        : index = vars_ULV_.add(name) ; break ;
+    case kVectorVectorBool   : index = vars_BVV_.add(name) ; break ;
+    case kVectorVectorDouble : index = vars_DVV_.add(name) ; break ;
+    case kVectorVectorFloat  : index = vars_FVV_.add(name) ; break ;
+    case kVectorVectorInt    : index = vars_IVV_.add(name) ; break ;
+    case kVectorVectorUInt   : index = vars_UVV_.add(name) ; break ;
     default :
       std::cout << "Failed to make a branch" << std::endl ;
       return false ; // Bail out if we don't know the type of branch
   }
+  listOfBranches_.push_back(std::pair<std::string,int>(name,type)) ;
+  handle = BranchHandle(type, index) ;
+  branchHandles_[name] = handle ;
   return true ;
 }
 
@@ -284,6 +296,12 @@ void IIHEAnalysis::beginJob(){
   // where we break the chicken and egg problem.
   if(MCTruthModule_) MCTruthModule_->setWhitelist() ;
   
+  // Use of the shower shape cache in each event, by the modules that share it
+  if(includeElectronModule_){
+    addBranch("ev_nEcalShapeLookups", kInt, ecalShapeLookupsBranch_) ;
+    addBranch("ev_nEcalShapeHits"   , kInt, ecalShapeHitsBranch_   ) ;
+  }
+  
   configureBranches() ;
 }
 
@@ -298,9 +316,25 @@ int IIHEAnalysis::saveToFile(TObject* obj){
 }
 
 void IIHEAnalysis::configureBranches(){
-  for(unsigned int i=0 ; i<allVars_.size() ; ++i){
-    allVars_.at(i)->config(dataTree_) ;
-  }
+  vars_B_  .config(dataTree_) ;
+  vars_D_  .config(dataTree_) ;
+  vars_F_  .config(dataTree_) ;
+  vars_I_  .config(dataTree_) ;
+  vars_C_  .config(dataTree_) ;
+  vars_U_  .config(dataTree_) ;
+  vars_UL_ .config(dataTree_) ;
+  vars_BV_ .config(dataTree_) ;
+  vars_DV_ .config(dataTree_) ;
+  vars_FV_ .config(dataTree_) ;
+  vars_IV_ .config(dataTree_) ;
+  vars_CV_ .config(dataTree_) ;
+  vars_UV_ .config(dataTree_) ;
+  vars_ULV_.config(dataTree_) ;
+  vars_BVV_.config(dataTree_) ;
+  vars_DVV_.config(dataTree_) ;
+  vars_FVV_.config(dataTree_) ;
+  vars_IVV_.config(dataTree_) ;
+  vars_UVV_.config(dataTree_) ;
   return ;
 }
 
@@ -324,9 +358,20 @@ void IIHEAnalysis::addToMCTruthWhitelist(std::vector<int> pdgIds){
 void IIHEAnalysis::analyze(const edm::Event& iEvent, const edm::EventSetup& iSetup){
   preScaleIndex_ = hltPrescaleProvider_.prescaleSet(iEvent,iSetup);
   beginEvent() ;
-  for(unsigned i=0 ; i<childModules_.size() ; ++i){
-    childModules_.at(i)->pubAnalyze(iEvent, iSetup) ;
+  for(unsigned i=0 ; i<gateIndices_.size() ; ++i){
+    startProfile() ;
+    childModules_.at(gateIndices_.at(i))->pubAnalyze(iEvent, iSetup) ;
+    stopProfile(gateIndices_.at(i), true) ;
     if(rejectEvent_) break ;
+    gatePassCounts_.at(i)++ ;
+  }
+  if(false==rejectEvent_){
+    for(unsigned i=0 ; i<mainIndices_.size() ; ++i){
+      startProfile() ;
+      childModules_.at(mainIndices_.at(i))->pubAnalyze(iEvent, iSetup) ;
+      stopProfile(mainIndices_.at(i), true) ;
+      if(rejectEvent_) break ;
+    }
   }
   endEvent() ;
 }
@@ -344,12 +389,42 @@ void IIHEAnalysis::beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup)
 void IIHEAnalysis::beginEvent(){
   acceptEvent_ = false ;
   rejectEvent_ = false ;
-  for(unsigned int i=0 ; i<childModules_.size() ; ++i){ childModules_.at(i)->pubBeginEvent() ; }
-  for(unsigned int i=0 ; i<allVars_.size()      ; ++i){ allVars_.at(i)->beginEvent()         ; }
+  ecalShapes_.clear() ;
+  for(unsigned int i=0 ; i<childModules_.size() ; ++i){
+    startProfile() ;
+    childModules_.at(i)->pubBeginEvent() ;
+    stopProfile(i, false) ;
+  }
+  vars_B_  .beginEvent() ;
+  vars_D_  .beginEvent() ;
+  vars_F_  .beginEvent() ;
+  vars_I_  .beginEvent() ;
+  vars_C_  .beginEvent() ;
+  vars_U_  .beginEvent() ;
+  vars_UL_ .beginEvent() ;
+  vars_BV_ .beginEvent() ;
+  vars_DV_ .beginEvent() ;
+  vars_FV_ .beginEvent() ;
+  vars_IV_ .beginEvent() ;
+  vars_CV_ .beginEvent() ;
+  vars_UV_ .beginEvent() ;
+  vars_ULV_.beginEvent() ;
+  vars_BVV_.beginEvent() ;
+  vars_DVV_.beginEvent() ;
+  vars_FVV_.beginEvent() ;
+  vars_IVV_.beginEvent() ;
+  vars_UVV_.beginEvent() ;
 }
 void IIHEAnalysis::endEvent(){
-  for(unsigned int i=0 ; i<childModules_.size() ; ++i){ childModules_.at(i)->pubEndEvent() ; }
-  for(unsigned int i=0 ; i<allVars_.size()      ; ++i){      allVars_.at(i)->endEvent()    ; }
+  for(unsigned int i=0 ; i<childModules_.size() ; ++i){
+    startProfile() ;
+    childModules_.at(i)->pubEndEvent() ;
+    stopProfile(i, false) ;
+  }
+  if(ecalShapeHitsBranch_.valid()){
+    store(ecalShapeLookupsBranch_, ecalShapes_.nLookups()) ;
+    store(ecalShapeHitsBranch_   , ecalShapes_.nHits()   ) ;
+  }
   if(true==acceptEvent_ && false==rejectEvent_){
     dataTree_->Fill() ;
     nEventsStored_++ ;
@@ -362,8 +437,8 @@ void IIHEAnalysis::endJob(){
 
   for(unsigned int i=0 ; i<childModules_.size() ; ++i){ childModules_.at(i)->pubEndJob() ; }
   std::vector<std::string> untouchedBranchNames ;
-  for(unsigned int i=0 ; i<allVars_.size() ; ++i){
-    if(allVars_.at(i)->is_touched()==false) untouchedBranchNames.push_back(allVars_.at(i)->name()) ;
+  for(unsigned int i=0 ; i<listOfBranches_.size() ; ++i){
+    if(branchIsTouched(branchHandles_[listOfBranches_.at(i).first])==false) untouchedBranchNames.push_back(listOfBranches_.at(i).first) ;
   }
   if(debug_==true){
     if(untouchedBranchNames.size()>0){
@@ -377,267 +452,229 @@ void IIHEAnalysis::endJob(){
   addValueToMetaTree("nEventsRaw"   , nEvents_      ) ;
   addValueToMetaTree("nEventsStored", nEventsStored_) ;
   addFVValueToMetaTree("nRuns", nRuns_) ;
+  for(unsigned int i=0 ; i<gateNames_.size() ; ++i){
+    addValueToMetaTree("nEventsPassGate_"+gateNames_.at(i), gatePassCounts_.at(i)) ;
+  }
+  
+  // Cost breakdown of this job: time and heap per module, bytes per branch
+  std::vector<std::string> moduleNames ;
+  std::vector<double> moduleCalls ;
+  std::vector<double> moduleWallTimes ;
+  std::vector<double> moduleHeapBytes ;
+  for(unsigned int i=0 ; i<moduleProfiles_.size() ; ++i){
+    moduleNames    .push_back(moduleProfiles_.at(i).name     ) ;
+    moduleCalls    .push_back(moduleProfiles_.at(i).nCalls   ) ;
+    moduleWallTimes.push_back(moduleProfiles_.at(i).wallTime ) ;
+    moduleHeapBytes.push_back(moduleProfiles_.at(i).heapBytes) ;
+  }
+  addCVValueToMetaTree("profile_moduleName"    , moduleNames    ) ;
+  addDVValueToMetaTree("profile_moduleNCalls"  , moduleCalls    ) ;
+  addDVValueToMetaTree("profile_moduleWallTime", moduleWallTimes) ;
+  if(profileModuleMemory_) addDVValueToMetaTree("profile_moduleHeapBytes", moduleHeapBytes) ;
+  // One per geometry IOV; with profileModuleMemory the heap columns above show that the
+  // modules using it no longer grow from event to event
+  addValueToMetaTree("profile_nCaloGeometryBuilds", caloGeometry_.nBuilds()) ;
+  // Shower shape requests over the job, and how many of them were served from the cache;
+  // the same per stored event is in ev_nEcalShapeLookups and ev_nEcalShapeHits
+  addValueToMetaTree("profile_nEcalShapeLookups", ecalShapes_.nLookupsTotal()) ;
+  addValueToMetaTree("profile_nEcalShapeHits"   , ecalShapes_.nHitsTotal()   ) ;
+  
+  std::vector<std::string> branchNames ;
+  std::vector<double> branchTotBytes ;
+  std::vector<double> branchZipBytes ;
+  for(unsigned int i=0 ; i<listOfBranches_.size() ; ++i){
+    TBranch* branch = dataTree_->GetBranch(listOfBranches_.at(i).first.c_str()) ;
+    if(!branch) continue ;
+    branchNames   .push_back(listOfBranches_.at(i).first) ;
+    branchTotBytes.push_back(branch->GetTotBytes()) ;
+    branchZipBytes.push_back(branch->GetZipBytes()) ;
+  }
+  addCVValueToMetaTree("profile_branchName"    , branchNames   ) ;
+  addDVValueToMetaTree("profile_branchTotBytes", branchTotBytes) ;
+  addDVValueToMetaTree("profile_branchZipBytes", branchZipBytes) ;
   metaTree_->Fill() ;
   
   std::cout << "There were " << nEvents_ << " total events of which " << nEventsStored_ << " were stored to file." << std::endl ;
+  for(unsigned int i=0 ; i<gateNames_.size() ; ++i){
+    std::cout << "  Gate " << gateNames_.at(i) << " passed " << gatePassCounts_.at(i) << " events." << std::endl ;
+  }
+  if(debug_==true){
+    std::cout << "Time spent in each module:" << std::endl ;
+    for(unsigned int i=0 ; i<moduleProfiles_.size() ; ++i){
+      std::cout << "  " << moduleProfiles_.at(i).name << " " << moduleProfiles_.at(i).wallTime << " s in " << moduleProfiles_.at(i).nCalls << " calls" << std::endl ;
+    }
+  }
 
 }
 
 // ------------ method for storing information into the TTree  ------------
-bool IIHEAnalysis::store(std::string name, bool value){
-  for(unsigned int i=0 ; i<vars_B_.size() ; ++i){
-    if(vars_B_.at(i)->name()==name){
-      vars_B_ .at(i)->set(value) ;
-      return true ;
-    }
-  }
-  for(unsigned int i=0 ; i<vars_BV_.size() ; ++i){
-    if(vars_BV_.at(i)->name()==name){
-      vars_BV_ .at(i)->push(value) ;
-      return true ;
-    }
+// The name is resolved to a handle and the value is stored through it.  Modules that
+// store many values per event should keep the handle from addBranch instead.
+bool IIHEAnalysis::store(std::string name, bool                      value){ return store(findBranch(name), value) ; }
+bool IIHEAnalysis::store(std::string name, double                    value){ return store(findBranch(name), value) ; }
+bool IIHEAnalysis::store(std::string name, float                     value){ return store(findBranch(name), value) ; }
+bool IIHEAnalysis::store(std::string name, int                       value){ return store(findBranch(name), value) ; }
+bool IIHEAnalysis::store(std::string name, std::string               value){ return store(findBranch(name), value) ; }
+bool IIHEAnalysis::store(std::string name, unsigned int              value){ return store(findBranch(name), value) ; }
+bool IIHEAnalysis::store(std::string name, unsigned long int         value){ return store(findBranch(name), value) ; }
+bool IIHEAnalysis::store(std::string name, std::vector<bool>         value){ return store(findBranch(name), value) ; }
+bool IIHEAnalysis::store(std::string name, std::vector<double>       value){ return store(findBranch(name), value) ; }
+bool IIHEAnalysis::store(std::string name, std::vector<float>        value){ return store(findBranch(name), value) ; }
+bool IIHEAnalysis::store(std::string name, std::vector<int>          value){ return store(findBranch(name), value) ; }
+bool IIHEAnalysis::store(std::string name, std::vector<unsigned int> value){ return store(findBranch(name), value) ; }
+
+BranchHandle IIHEAnalysis::findBranch(const std::string& name){
+  std::map<std::string, BranchHandle>::const_iterator it = branchHandles_.find(name) ;
+  if(it==branchHandles_.end()){
+    if(debug_) std::cout << "Could not find a branch named " << name << std::endl ;
+    return BranchHandle() ;
+  }
+  return it->second ;
+}
+
+bool IIHEAnalysis::branchIsTouched(const BranchHandle& handle){
+  switch(handle.type()){
+    case kBool               : return vars_B_  .is_touched(handle.index()) ;
+    case kDouble             : return vars_D_  .is_touched(handle.index()) ;
+    case kFloat              : return vars_F_  .is_touched(handle.index()) ;
+    case kInt                : return vars_I_  .is_touched(handle.index()) ;
+    case kChar               : return vars_C_  .is_touched(handle.index()) ;
+    case kUInt               : return vars_U_  .is_touched(handle.index()) ;
+    case kULInt              : return vars_UL_ .is_touched(handle.index()) ;
+    case kVectorBool         : return vars_BV_ .is_touched(handle.index()) ;
+    case kVectorDouble       : return vars_DV_ .is_touched(handle.index()) ;
+    case kVectorFloat        : return vars_FV_ .is_touched(handle.index()) ;
+    case kVectorInt          : return vars_IV_ .is_touched(handle.index()) ;
+    case kVectorChar         : return vars_CV_ .is_touched(handle.index()) ;
+    case kVectorUInt         : return vars_UV_ .is_touched(handle.index()) ;
+    case kVectorULInt        : return vars_ULV_.is_touched(handle.index()) ;
+    case kVectorVectorBool   : return vars_BVV_.is_touched(handle.index()) ;
+    case kVectorVectorDouble : return vars_DVV_.is_touched(handle.index()) ;
+    case kVectorVectorFloat  : return vars_FVV_.is_touched(handle.index()) ;
+    case kVectorVectorInt    : return vars_IVV_.is_touched(handle.index()) ;
+    case kVectorVectorUInt   : return vars_UVV_.is_touched(handle.index()) ;
+    default : break ;
   }
-  if(debug_) std::cout << "Could not find a (bool) branch named " << name << std::endl ;
   return false ;
 }
-bool IIHEAnalysis::store(std::string name, double value){
-  // Try to fill doubles, then floats
-  for(unsigned int i=0 ; i<vars_D_.size() ; ++i){
-    if(vars_D_.at(i)->name()==name){
-      vars_D_ .at(i)->set(value) ;
-      return true ;
-    }
-  }
-  for(unsigned int i=0 ; i<vars_DV_.size() ; ++i){
-    if(vars_DV_.at(i)->name()==name){
-      vars_DV_ .at(i)->push(value) ;
-      return true ;
-    }
-  }
-  for(unsigned int i=0 ; i<vars_F_.size() ; ++i){
-    if(vars_F_.at(i)->name()==name){
-      vars_F_ .at(i)->set(value) ;
-      return true ;
-    }
-  }
-  for(unsigned int i=0 ; i<vars_FV_.size() ; ++i){
-    if(vars_FV_.at(i)->name()==name){
-      vars_FV_ .at(i)->push(value) ;
-      return true ;
-    }
+
+// ------------ methods for storing information through a branch handle  ------------
+// A scalar branch is set, a vector branch has the value appended.  Doubles and floats
+// can be stored in each other's branches, as can ints and unsigned ints.
+bool IIHEAnalysis::store(const BranchHandle& handle, bool value){
+  switch(handle.type()){
+    case kBool       : vars_B_ .set (handle.index(), value) ; return true ;
+    case kVectorBool : vars_BV_.push(handle.index(), value) ; return true ;
+    default : break ;
   }
-  if(debug_) std::cout << "Could not find a (double) branch named " << name << std::endl ;
+  if(debug_) std::cout << "Could not store a (bool) value through a handle of type " << handle.type() << std::endl ;
   return false ;
 }
-bool IIHEAnalysis::store(std::string name, float value){
-  // Try to fill floats, then doubles
-  for(unsigned int i=0 ; i<vars_F_.size() ; ++i){
-    if(vars_F_.at(i)->name()==name){
-      vars_F_ .at(i)->set(value) ;
-      return true ;
-    }
-  }
-  for(unsigned int i=0 ; i<vars_FV_.size() ; ++i){
-    if(vars_FV_.at(i)->name()==name){
-      vars_FV_ .at(i)->push(value) ;
-      return true ;
-    }
-  }
-  for(unsigned int i=0 ; i<vars_D_.size() ; ++i){
-    if(vars_D_.at(i)->name()==name){
-      vars_D_ .at(i)->set(value) ;
-      return true ;
-    }
-  }
-  for(unsigned int i=0 ; i<vars_DV_.size() ; ++i){
-    if(vars_DV_.at(i)->name()==name){
-      vars_DV_ .at(i)->push(value) ;
-      return true ;
-    }
-  }
-  if(debug_) std::cout << "Could not find a (float) branch named " << name << std::endl ;
+bool IIHEAnalysis::store(const BranchHandle& handle, double value){
+  switch(handle.type()){
+    case kDouble      : vars_D_ .set (handle.index(), value) ; return true ;
+    case kVectorDouble: vars_DV_.push(handle.index(), value) ; return true ;
+    case kFloat       : vars_F_ .set (handle.index(), value) ; return true ;
+    case kVectorFloat : vars_FV_.push(handle.index(), (float) value) ; return true ;
+    default : break ;
+  }
+  if(debug_) std::cout << "Could not store a (double) value through a handle of type " << handle.type() << std::endl ;
   return false ;
 }
-bool IIHEAnalysis::store(std::string name, int value){
-  for(unsigned int i=0 ; i<vars_I_.size() ; ++i){
-    if(vars_I_.at(i)->name()==name){
-      vars_I_ .at(i)->set(value) ;
-      return true ;
-    }
-  }
-  for(unsigned int i=0 ; i<vars_IV_.size() ; ++i){
-    if(vars_IV_.at(i)->name()==name){
-      vars_IV_ .at(i)->push(value) ;
-      return true ;
-    }
-  }
-  for(unsigned int i=0 ; i<vars_U_.size() ; ++i){
-    if(vars_U_.at(i)->name()==name){
-      vars_U_ .at(i)->set(value) ;
-      return true ;
-    }
-  }
-  for(unsigned int i=0 ; i<vars_UV_.size() ; ++i){
-    if(vars_UV_.at(i)->name()==name){
-      vars_UV_ .at(i)->push(value) ;
-      return true ;
-    }
-  }
-  if(debug_) std::cout << "Could not find a (int) branch named " << name << std::endl ;
+bool IIHEAnalysis::store(const BranchHandle& handle, float value){
+  switch(handle.type()){
+    case kFloat       : vars_F_ .set (handle.index(), value) ; return true ;
+    case kVectorFloat : vars_FV_.push(handle.index(), value) ; return true ;
+    case kDouble      : vars_D_ .set (handle.index(), value) ; return true ;
+    case kVectorDouble: vars_DV_.push(handle.index(), (double) value) ; return true ;
+    default : break ;
+  }
+  if(debug_) std::cout << "Could not store a (float) value through a handle of type " << handle.type() << std::endl ;
   return false ;
 }
-
-
-bool IIHEAnalysis::store(std::string name, std::string value){
-  for(unsigned int i=0 ; i<vars_C_.size() ; ++i){
-    if(vars_C_.at(i)->name()==name){
-      vars_C_ .at(i)->set(value) ;
-      return true ;
-    }
-  }
-  for(unsigned int i=0 ; i<vars_CV_.size() ; ++i){
-    if(vars_CV_.at(i)->name()==name){
-      vars_CV_ .at(i)->push(value) ;
-      return true ;
-    }
-  }
-  if(debug_) std::cout << "Could not find a (char) branch named " << name << std::endl ;
+bool IIHEAnalysis::store(const BranchHandle& handle, int value){
+  switch(handle.type()){
+    case kInt        : vars_I_ .set (handle.index(), value) ; return true ;
+    case kVectorInt  : vars_IV_.push(handle.index(), value) ; return true ;
+    case kUInt       : vars_U_ .set (handle.index(), value) ; return true ;
+    case kVectorUInt : vars_UV_.push(handle.index(), (unsigned int) value) ; return true ;
+    default : break ;
+  }
+  if(debug_) std::cout << "Could not store a (int) value through a handle of type " << handle.type() << std::endl ;
   return false ;
 }
-bool IIHEAnalysis::store(std::string name, unsigned int value){
-  for(unsigned int i=0 ; i<vars_U_.size() ; ++i){
-    if(vars_U_.at(i)->name()==name){
-      vars_U_ .at(i)->set(value) ;
-      return true ;
-    }
-  }
-  for(unsigned int i=0 ; i<vars_UV_.size() ; ++i){
-    if(vars_UV_.at(i)->name()==name){
-      vars_UV_ .at(i)->push(value) ;
-      return true ;
-    }
-  }
-  for(unsigned int i=0 ; i<vars_I_.size() ; ++i){
-    if(vars_I_.at(i)->name()==name){
-      vars_I_ .at(i)->set(value) ;
-      return true ;
-    }
-  }
-  for(unsigned int i=0 ; i<vars_IV_.size() ; ++i){
-    if(vars_IV_.at(i)->name()==name){
-      vars_IV_ .at(i)->push(value) ;
-      return true ;
-    }
+bool IIHEAnalysis::store(const BranchHandle& handle, std::string value){
+  switch(handle.type()){
+    case kChar       : vars_C_ .set (handle.index(), value) ; return true ;
+    case kVectorChar : vars_CV_.push(handle.index(), value) ; return true ;
+    default : break ;
   }
-  if(debug_) std::cout << "Could not find a (uint) branch named " << name << std::endl ;
+  if(debug_) std::cout << "Could not store a (char) value through a handle of type " << handle.type() << std::endl ;
   return false ;
 }
-
-bool IIHEAnalysis::store(std::string name, unsigned long int value){ 
-  for(unsigned int i=0 ; i<vars_UL_.size() ; ++i){
-    if(vars_UL_.at(i)->name()==name){
-      vars_UL_ .at(i)->set(value) ;
-      return true ;
-    }
-  } 
-  for(unsigned int i=0 ; i<vars_ULV_.size() ; ++i){
-    if(vars_ULV_.at(i)->name()==name){
-      vars_ULV_ .at(i)->push(value) ;
-      return true ;
-    }
-  }
-  if(debug_) std::cout << "Could not find a (ulint) branch named " << name << std::endl ;
+bool IIHEAnalysis::store(const BranchHandle& handle, unsigned int value){
+  switch(handle.type()){
+    case kUInt       : vars_U_ .set (handle.index(), value) ; return true ;
+    case kVectorUInt : vars_UV_.push(handle.index(), value) ; return true ;
+    case kInt        : vars_I_ .set (handle.index(), value) ; return true ;
+    case kVectorInt  : vars_IV_.push(handle.index(), (int) value) ; return true ;
+    default : break ;
+  }
+  if(debug_) std::cout << "Could not store a (uint) value through a handle of type " << handle.type() << std::endl ;
   return false ;
 }
-
-bool IIHEAnalysis::store(std::string name, std::vector<bool> values){
-  for(unsigned int i=0 ; i<vars_BVV_.size() ; ++i){
-    if(vars_BVV_.at(i)->name()==name){
-      vars_BVV_ .at(i)->push(values) ;
-      return true ;
-    }
-  }
-  for(unsigned int i=0 ; i<vars_BV_.size() ; ++i){
-    if(vars_BV_.at(i)->name()==name){
-      for(unsigned j=0 ; j<values.size() ; ++j){
-        vars_BV_ .at(i)->push(values.at(j)) ;
-      }
-      return true ;
-    }
+bool IIHEAnalysis::store(const BranchHandle& handle, unsigned long int value){
+  switch(handle.type()){
+    case kULInt       : vars_UL_ .set (handle.index(), value) ; return true ;
+    case kVectorULInt : vars_ULV_.push(handle.index(), value) ; return true ;
+    default : break ;
   }
-  if(debug_) std::cout << "Could not find a (vector bool) branch named " << name << std::endl ;
+  if(debug_) std::cout << "Could not store a (ulint) value through a handle of type " << handle.type() << std::endl ;
   return false ;
 }
-bool IIHEAnalysis::store(std::string name, std::vector<float> values){
-  for(unsigned int i=0 ; i<vars_FVV_.size() ; ++i){
-    if(vars_FVV_.at(i)->name()==name){
-      vars_FVV_ .at(i)->push(values) ;
-      return true ;
-    }
+bool IIHEAnalysis::store(const BranchHandle& handle, const std::vector<bool>& values){
+  switch(handle.type()){
+    case kVectorVectorBool : vars_BVV_.push  (handle.index(), values) ; return true ;
+    case kVectorBool       : vars_BV_ .append(handle.index(), values) ; return true ;
+    default : break ;
   }
-  for(unsigned int i=0 ; i<vars_FV_.size() ; ++i){
-    if(vars_FV_.at(i)->name()==name){
-      for(unsigned j=0 ; j<values.size() ; ++j){
-        vars_FV_ .at(i)->push(values.at(j)) ;
-      }
-      return true ;
-    }
-  }
-  if(debug_) std::cout << "Could not find a (vector float) branch named " << name << std::endl ;
+  if(debug_) std::cout << "Could not store a (vector bool) value through a handle of type " << handle.type() << std::endl ;
   return false ;
 }
-bool IIHEAnalysis::store(std::string name, std::vector<double> values){
-  for(unsigned int i=0 ; i<vars_DVV_.size() ; ++i){
-    if(vars_DVV_.at(i)->name()==name){
-      vars_DVV_ .at(i)->push(values) ;
-      return true ;
-    }
+bool IIHEAnalysis::store(const BranchHandle& handle, const std::vector<double>& values){
+  switch(handle.type()){
+    case kVectorVectorDouble : vars_DVV_.push  (handle.index(), values) ; return true ;
+    case kVectorDouble       : vars_DV_ .append(handle.index(), values) ; return true ;
+    default : break ;
   }
-  for(unsigned int i=0 ; i<vars_DV_.size() ; ++i){
-    if(vars_DV_.at(i)->name()==name){
-      for(unsigned j=0 ; j<values.size() ; ++j){
-        vars_DV_ .at(i)->push(values.at(j)) ;
-      }
-      return true ;
-    }
-  }
-  if(debug_) std::cout << "Could not find a (vector double) branch named " << name << std::endl ;
+  if(debug_) std::cout << "Could not store a (vector double) value through a handle of type " << handle.type() << std::endl ;
   return false ;
 }
-bool IIHEAnalysis::store(std::string name, std::vector<int> values){
-  for(unsigned int i=0 ; i<vars_IVV_.size() ; ++i){
-    if(vars_IVV_.at(i)->name()==name){
-      vars_IVV_ .at(i)->push(values) ;
-      return true ;
-    }
+bool IIHEAnalysis::store(const BranchHandle& handle, const std::vector<float>& values){
+  switch(handle.type()){
+    case kVectorVectorFloat : vars_FVV_.push  (handle.index(), values) ; return true ;
+    case kVectorFloat       : vars_FV_ .append(handle.index(), values) ; return true ;
+    default : break ;
   }
-  for(unsigned int i=0 ; i<vars_IV_.size() ; ++i){
-    if(vars_IV_.at(i)->name()==name){
-      for(unsigned j=0 ; j<values.size() ; ++j){
-        vars_IV_ .at(i)->push(values.at(j)) ;
-      }
-      return true ;
-    }
-  }
-  if(debug_) std::cout << "Could not find a (vector int) branch named " << name << std::endl ;
+  if(debug_) std::cout << "Could not store a (vector float) value through a handle of type " << handle.type() << std::endl ;
   return false ;
 }
-bool IIHEAnalysis::store(std::string name, std::vector<unsigned int> values){
-  for(unsigned int i=0 ; i<vars_UVV_.size() ; ++i){
-    if(vars_UVV_.at(i)->name()==name){
-      vars_UVV_ .at(i)->push(values) ;
-      return true ;
-    }
+bool IIHEAnalysis::store(const BranchHandle& handle, const std::vector<int>& values){
+  switch(handle.type()){
+    case kVectorVectorInt : vars_IVV_.push  (handle.index(), values) ; return true ;
+    case kVectorInt       : vars_IV_ .append(handle.index(), values) ; return true ;
+    default : break ;
   }
-  for(unsigned int i=0 ; i<vars_UV_.size() ; ++i){
-    if(vars_UV_.at(i)->name()==name){
-      for(unsigned j=0 ; j<values.size() ; ++j){
-        vars_UV_ .at(i)->push(values.at(j)) ;
-      }
-      return true ;
-    }
+  if(debug_) std::cout << "Could not store a (vector int) value through a handle of type " << handle.type() << std::endl ;
+  return false ;
+}
+bool IIHEAnalysis::store(const BranchHandle& handle, const std::vector<unsigned int>& values){
+  switch(handle.type()){
+    case kVectorVectorUInt : vars_UVV_.push  (handle.index(), values) ; return true ;
+    case kVectorUInt       : vars_UV_ .append(handle.index(), values) ; return true ;
+    default : break ;
   }
-  if(debug_) std::cout << "Could not find a (vector uint) branch named " << name << std::endl ;
+  if(debug_) std::cout << "Could not store a (vector uint) value through a handle of type " << handle.type() << std::endl ;
   return false ;
 }
 
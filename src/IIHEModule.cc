@@ -1,7 +1,7 @@
 #include "UserCode/IIHETree/interface/IIHEAnalysis.h"
 #include "UserCode/IIHETree/interface/IIHEModule.h"
 
-IIHEModule::IIHEModule(const edm::ParameterSet& iConfig){}
+IIHEModule::IIHEModule(const edm::ParameterSet& iConfig): parent_(0){}
 IIHEModule::~IIHEModule(){}
 
 void IIHEModule::config(IIHEAnalysis* parent){
@@ -12,6 +12,10 @@ bool IIHEModule::addBranch(std::string name, int type){
   bool result = parent_->addBranch(name, type) ;
   return result ;
 }
+bool IIHEModule::addBranch(std::string name, int type, BranchHandle& handle){
+  bool result = parent_->addBranch(name, type, handle) ;
+  return result ;
+}
 bool IIHEModule::addBranch(std::string name){
   bool result = parent_->addBranch(name) ;
   return result ;
@@ -33,6 +37,18 @@ void IIHEModule::store(std::string name, std::vector<double>       value){ paren
 void IIHEModule::store(std::string name, std::vector<float>        value){ parent_->store(name, value) ; }
 void IIHEModule::store(std::string name, std::vector<int>          value){ parent_->store(name, value) ; }
 void IIHEModule::store(std::string name, std::vector<unsigned int> value){ parent_->store(name, value) ; }
+void IIHEModule::store(const BranchHandle& handle, bool                             value){ parent_->store(handle, value) ; }
+void IIHEModule::store(const BranchHandle& handle, double                           value){ parent_->store(handle, value) ; }
+void IIHEModule::store(const BranchHandle& handle, float                            value){ parent_->store(handle, value) ; }
+void IIHEModule::store(const BranchHandle& handle, int                              value){ parent_->store(handle, value) ; }
+void IIHEModule::store(const BranchHandle& handle, std::string                      value){ parent_->store(handle, value) ; }
+void IIHEModule::store(const BranchHandle& handle, unsigned int                     value){ parent_->store(handle, value) ; }
+void IIHEModule::store(const BranchHandle& handle, unsigned long int                value){ parent_->store(handle, value) ; }
+void IIHEModule::store(const BranchHandle& handle, const std::vector<bool>&         value){ parent_->store(handle, value) ; }
+void IIHEModule::store(const BranchHandle& handle, const std::vector<double>&       value){ parent_->store(handle, value) ; }
+void IIHEModule::store(const BranchHandle& handle, const std::vector<float>&        value){ parent_->store(handle, value) ; }
+void IIHEModule::store(const BranchHandle& handle, const std::vector<int>&          value){ parent_->store(handle, value) ; }
+void IIHEModule::store(const BranchHandle& handle, const std::vector<unsigned int>& value){ parent_->store(handle, value) ; }
 void IIHEModule::setBranchType(int type){ parent_->setBranchType(type) ; }
 
 bool IIHEModule::addValueToMetaTree(std::string name, float value){
@@ -51,6 +67,13 @@ int IIHEModule::MCTruth_matchEtaPhi_getIndex(float eta, float phi){
 
 void IIHEModule::addToMCTruthWhitelist(std::vector<int> pdgIds){ parent_->addToMCTruthWhitelist(pdgIds) ; }
 
+const CaloGeometryCache& IIHEModule::getCaloGeometry(const edm::EventSetup& iSetup){
+  return parent_->getCaloGeometry(iSetup) ;
+}
+EcalShapeCache& IIHEModule::getEcalShapes(){
+  return parent_->getEcalShapes() ;
+}
+
 // ------------ method called once each job just before starting event loop  ------------
 void IIHEModule::beginJob(){}
 
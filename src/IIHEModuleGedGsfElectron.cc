@@ -1,4 +1,6 @@
 #include "UserCode/IIHETree/interface/IIHEModuleGedGsfElectron.h"
+#include "UserCode/IIHETree/interface/CaloGeometryCache.h"
+#include "UserCode/IIHETree/interface/EcalShapeCache.h"
 
 #include "DataFormats/EcalRecHit/interface/EcalRecHit.h"
 #include "DataFormats/EcalRecHit/interface/EcalRecHitCollections.h"
@@ -57,8 +59,24 @@ IIHEModuleGedGsfElectron::IIHEModuleGedGsfElectron(const edm::ParameterSet& iCon
   ETThreshold_ = iConfig.getUntrackedParameter<double>("electronPtThreshold") ;
   primaryVertexLabel_          = iConfig.getParameter<edm::InputTag>("primaryVertex") ;
   vtxToken_ = iC.consumes<View<reco::Vertex>>(primaryVertexLabel_);
+  
+  // Rechits at or above the threshold are stored, the saturation flags are checked on all
+  float rechitEnergyThreshold = iConfig.getUntrackedParameter<double>("rechitEnergyThreshold", 200.0) ;
+  std::vector<std::string> defaultSaturationFlags(1, "kSaturated") ;
+  std::vector<std::string> defaultStoredFlags ;
+  defaultStoredFlags.push_back("kSaturated"           ) ;
+  defaultStoredFlags.push_back("kLeadingEdgeRecovered") ;
+  defaultStoredFlags.push_back("kNeighboursRecovered" ) ;
+  defaultStoredFlags.push_back("kWeird"               ) ;
+  std::vector<std::string> saturationFlags = iConfig.getUntrackedParameter<std::vector<std::string> >("rechitSaturationFlags", defaultSaturationFlags) ;
+  std::vector<std::string> storedFlags     = iConfig.getUntrackedParameter<std::vector<std::string> >("rechitStoredFlags"    , defaultStoredFlags    ) ;
+  EBHitsScanner_ = new EcalRecHitScanner("EBHits", false, rechitEnergyThreshold, saturationFlags, storedFlags) ;
+  EEHitsScanner_ = new EcalRecHitScanner("EEHits", true , rechitEnergyThreshold, saturationFlags, storedFlags) ;
+}
+IIHEModuleGedGsfElectron::~IIHEModuleGedGsfElectron(){
+  delete EBHitsScanner_ ;
+  delete EEHitsScanner_ ;
 }
-IIHEModuleGedGsfElectron::~IIHEModuleGedGsfElectron(){}
 
 // ------------ method called once each job just before starting event loop  ------------
 void IIHEModuleGedGsfElectron::beginJob(){
@@ -237,33 +255,8 @@ void IIHEModuleGedGsfElectron::beginJob(){
 
   // Saturation information
   addBranch("EHits_isSaturated", kBool) ;
-  setBranchType(kVectorInt) ;
-  addBranch("EBHits_rawId"   ) ;
-  addBranch("EBHits_iRechit" ) ;
-  addBranch("EBHits_energy", kVectorFloat) ;
-  addBranch("EBHits_ieta"    ) ;
-  addBranch("EBHits_iphi"    ) ;
-  addBranch("EBHits_RecoFlag") ;
-
-  setBranchType(kVectorBool) ;
-  addBranch("EBHits_kSaturated"           ) ;
-  addBranch("EBHits_kLeadingEdgeRecovered") ;
-  addBranch("EBHits_kNeighboursRecovered" ) ;
-  addBranch("EBHits_kWeird"               ) ;
-
-  setBranchType(kVectorInt) ;
-  addBranch("EEHits_rawId"   ) ;
-  addBranch("EEHits_iRechit" ) ;
-  addBranch("EEHits_energy", kVectorFloat) ;
-  addBranch("EEHits_ieta"    ) ;
-  addBranch("EEHits_iphi"    ) ;
-  addBranch("EEHits_RecoFlag") ;
-
-  setBranchType(kVectorBool) ;
-  addBranch("EEHits_kSaturated"           ) ;
-  addBranch("EEHits_kLeadingEdgeRecovered") ;
-  addBranch("EEHits_kNeighboursRecovered" ) ;
-  addBranch("EEHits_kWeird"               ) ;
+  addRecHitBranches(*EBHitsScanner_, EBHitsBranches_) ;
+  addRecHitBranches(*EEHitsScanner_, EEHitsBranches_) ;
 
 }
 
@@ -311,18 +304,17 @@ void IIHEModuleGedGsfElectron::analyze(const edm::Event& iEvent, const edm::Even
   edm::Handle<reco::BeamSpot> beamspotHandle_ ;
   iEvent.getByToken(beamSpotToken_, beamspotHandle_) ;
 
-  edm::ESHandle<CaloGeometry> pGeometry ;
-  iSetup.get<CaloGeometryRecord>().get(pGeometry) ;
-  CaloGeometry* geometry = (CaloGeometry*) pGeometry.product() ;
-  const CaloSubdetectorGeometry* geometryES = geometry->getSubdetectorGeometry(DetId::Ecal, EcalPreshower) ;
-  CaloSubdetectorTopology* topology_ES = (geometryES) ? new EcalPreshowerTopology(geometry) : 0 ;
+  // Owned by the parent and rebuilt only when the geometry IOV changes
+  const CaloGeometryCache& caloGeometry = getCaloGeometry(iSetup) ;
 
   edm::Handle<View<reco::Vertex> > pvCollection_ ;
   iEvent.getByToken( vtxToken_ , pvCollection_);
   edm::Ptr<reco::Vertex> firstpvertex = pvCollection_->ptrAt( 0 );
 
   float pv_z = firstpvertex->z() ; 
-  EcalClusterLazyTools lazytool(iEvent, iSetup, ebReducedRecHitCollection_, eeReducedRecHitCollection_, esReducedRecHitCollection_) ;
+  // Shared with the other modules for the rest of the event
+  EcalShapeCache& ecalShapes = getEcalShapes() ;
+  EcalClusterLazyTools& lazytool = ecalShapes.tools(iEvent, iSetup, ebReducedRecHitCollection_, eeReducedRecHitCollection_, esReducedRecHitCollection_) ;
 
   edm::Handle<double> rhoHandle ;
   iEvent.getByToken(rhoTokenAll_, rhoHandle) ;
@@ -485,35 +477,32 @@ void IIHEModuleGedGsfElectron::analyze(const edm::Event& iEvent, const edm::Even
     store("gsf_sc_preshowerEnergy"          , gsfiter->superCluster()->preshowerEnergy()) ;
 
     reco::SuperClusterRef    cl_ref = gsfiter->superCluster() ;
-    const reco::CaloClusterPtr seed = gsfiter->superCluster()->seed() ;
-
-    store("gsf_sc_lazyTools_e2x5Right"   , lazytool.e2x5Right (*seed)            );
-    store("gsf_sc_lazyTools_e2x5Left"    , lazytool.e2x5Left (*seed)             );
-    store("gsf_sc_lazyTools_e2x5Top"     , lazytool.e2x5Top (*seed)              );
-    store("gsf_sc_lazyTools_e2x5Bottom"  , lazytool.e2x5Bottom (*seed)           );
-    store("gsf_sc_lazyTools_eMax"        , lazytool.eMax (*seed)                 );
-    store("gsf_sc_lazyTools_e2nd"        , lazytool.e2nd (*seed)                 );
-    store("gsf_sc_lazyTools_eRight"      , lazytool.eRight (*seed)               );
-    store("gsf_sc_lazyTools_eLeft"       , lazytool.eLeft (*seed)                );
-    store("gsf_sc_lazyTools_eTop"        , lazytool.eTop (*seed)                 );
-    store("gsf_sc_lazyTools_eBottom"     , lazytool.eBottom (*seed)              );
-    store("gsf_sc_lazyTools_e2x2"        , lazytool.e2x2 (*seed)                 );
-    store("gsf_sc_lazyTools_e3x3"        , lazytool.e3x3 (*seed)                 );
-    store("gsf_sc_lazyTools_e4x4"        , lazytool.e4x4 (*seed)                 );
-    store("gsf_sc_lazyTools_e5x5"        , lazytool.e5x5 (*seed)                 );
-    store("gsf_sc_lazyTools_e1x5"        , lazytool.e1x5 (*seed)                 );
-    store("gsf_sc_lazyTools_e5x1"        , lazytool.e5x1 (*seed)                 );
-    store("gsf_sc_lazyTools_e1x3"        , lazytool.e1x3 (*seed)                 );
-    store("gsf_sc_lazyTools_e3x1"        , lazytool.e3x1 (*seed)                 );
-    store("gsf_sc_lazyTools_BasicClusterSeedTime"        , lazytool.BasicClusterSeedTime (*seed)  );
-    double x = gsfiter->superCluster()->x() ;
-    double y = gsfiter->superCluster()->y() ;
-    double z = gsfiter->superCluster()->z() ;
-    store("gsf_sc_lazyTools_eshitsixix", lazytool.getESHits(x, y, z, lazytool.rechits_map_, geometry, topology_ES, 0, 1)) ;
-    store("gsf_sc_lazyTools_eshitsiyiy", lazytool.getESHits(x, y, z, lazytool.rechits_map_, geometry, topology_ES, 0, 2)) ;
-    store("gsf_sc_lazyTools_eseffsixix", lazytool.eseffsixix(*cl_ref)) ;
-    store("gsf_sc_lazyTools_eseffsiyiy", lazytool.eseffsiyiy(*cl_ref)) ;
-    store("gsf_sc_lazyTools_eseffsirir", lazytool.eseffsirir(*cl_ref)) ;
+    const EcalClusterShapes& shapes = ecalShapes.shapes(cl_ref, caloGeometry) ;
+
+    store("gsf_sc_lazyTools_e2x5Right"   , shapes.e2x5Right             );
+    store("gsf_sc_lazyTools_e2x5Left"    , shapes.e2x5Left              );
+    store("gsf_sc_lazyTools_e2x5Top"     , shapes.e2x5Top               );
+    store("gsf_sc_lazyTools_e2x5Bottom"  , shapes.e2x5Bottom            );
+    store("gsf_sc_lazyTools_eMax"        , shapes.eMax                  );
+    store("gsf_sc_lazyTools_e2nd"        , shapes.e2nd                  );
+    store("gsf_sc_lazyTools_eRight"      , shapes.eRight                );
+    store("gsf_sc_lazyTools_eLeft"       , shapes.eLeft                 );
+    store("gsf_sc_lazyTools_eTop"        , shapes.eTop                  );
+    store("gsf_sc_lazyTools_eBottom"     , shapes.eBottom               );
+    store("gsf_sc_lazyTools_e2x2"        , shapes.e2x2                  );
+    store("gsf_sc_lazyTools_e3x3"        , shapes.e3x3                  );
+    store("gsf_sc_lazyTools_e4x4"        , shapes.e4x4                  );
+    store("gsf_sc_lazyTools_e5x5"        , shapes.e5x5                  );
+    store("gsf_sc_lazyTools_e1x5"        , shapes.e1x5                  );
+    store("gsf_sc_lazyTools_e5x1"        , shapes.e5x1                  );
+    store("gsf_sc_lazyTools_e1x3"        , shapes.e1x3                  );
+    store("gsf_sc_lazyTools_e3x1"        , shapes.e3x1                  );
+    store("gsf_sc_lazyTools_BasicClusterSeedTime"        , shapes.seedTime  );
+    store("gsf_sc_lazyTools_eshitsixix", shapes.eshitsixix) ;
+    store("gsf_sc_lazyTools_eshitsiyiy", shapes.eshitsiyiy) ;
+    store("gsf_sc_lazyTools_eseffsixix", shapes.eseffsixix) ;
+    store("gsf_sc_lazyTools_eseffsiyiy", shapes.eseffsiyiy) ;
+    store("gsf_sc_lazyTools_eseffsirir", shapes.eseffsirir) ;
 
     reco::HitPattern kfHitPattern = gsfiter->gsfTrack()->hitPattern();
     int nbtrackhits = kfHitPattern.numberOfHits(reco::HitPattern::TRACK_HITS) ;
@@ -579,47 +568,37 @@ void IIHEModuleGedGsfElectron::analyze(const edm::Event& iEvent, const edm::Even
   store("gsf_n", gsf_n) ;
 
 
-  int nEBRecHits = 0 ;
-  bool isSaturated = false;
-  for(EcalRecHitCollection::const_iterator EBIt = theBarrelEcalRecHits->begin() ; EBIt!=theBarrelEcalRecHits->end() ; ++EBIt){
-    if((*EBIt).checkFlag(EcalRecHit::kSaturated)) isSaturated = true;
-    if( (*EBIt).energy() < 200.0 ) continue ;
-    nEBRecHits++ ;
-    EBDetId elementId = EBIt->id() ;
-    store("EBHits_rawId"   , elementId.rawId()) ;
-    store("EBHits_iRechit" , nEBRecHits) ;
-    store("EBHits_energy"  , (*EBIt).energy() ) ;
-    store("EBHits_ieta"    , elementId.ieta() ) ;
-    store("EBHits_iphi"    , elementId.iphi() ) ;
-    store("EBHits_RecoFlag", (*EBIt).recoFlag() ) ;
-
-    store("EBHits_kSaturated"           , (*EBIt).checkFlag(EcalRecHit::kSaturated           )) ;
-    store("EBHits_kLeadingEdgeRecovered", (*EBIt).checkFlag(EcalRecHit::kLeadingEdgeRecovered)) ;
-    store("EBHits_kNeighboursRecovered" , (*EBIt).checkFlag(EcalRecHit::kNeighboursRecovered )) ;
-    store("EBHits_kWeird"               , (*EBIt).checkFlag(EcalRecHit::kWeird               )) ;
-  }
+  EBHitsScanner_->scan(*theBarrelEcalRecHits) ;
+  EEHitsScanner_->scan(*theEndcapEcalRecHits) ;
+  storeRecHits(*EBHitsScanner_, EBHitsBranches_) ;
+  storeRecHits(*EEHitsScanner_, EEHitsBranches_) ;
+  store("EHits_isSaturated", EBHitsScanner_->isSaturated() || EEHitsScanner_->isSaturated()) ;
 
+}
 
-  int nEERecHits = 0 ;
-  for(EcalRecHitCollection::const_iterator EEIt = theEndcapEcalRecHits->begin() ; EEIt!=theEndcapEcalRecHits->end() ; ++EEIt){
-    if((*EEIt).checkFlag(EcalRecHit::kSaturated)) isSaturated = true;
-    if( (*EEIt).energy() < 200.0 ) continue ;
-    nEERecHits++ ;
-    EBDetId elementId = EEIt->id() ;
-    store("EEHits_rawId"   , elementId.rawId()) ;
-    store("EEHits_iRechit" , nEBRecHits) ;
-    store("EEHits_energy"  , (*EEIt).energy() ) ;
-    store("EEHits_ieta"    , elementId.ieta() ) ;
-    store("EEHits_iphi"    , elementId.iphi() ) ;
-    store("EEHits_RecoFlag", (*EEIt).recoFlag() ) ;
-
-    store("EEHits_kSaturated"           , (*EEIt).checkFlag(EcalRecHit::kSaturated           )) ;
-    store("EEHits_kLeadingEdgeRecovered", (*EEIt).checkFlag(EcalRecHit::kLeadingEdgeRecovered)) ;
-    store("EEHits_kNeighboursRecovered" , (*EEIt).checkFlag(EcalRecHit::kNeighboursRecovered )) ;
-    store("EEHits_kWeird"               , (*EEIt).checkFlag(EcalRecHit::kWeird               )) ;
+void IIHEModuleGedGsfElectron::addRecHitBranches(const EcalRecHitScanner& scanner, RecHitBranches& branches){
+  const std::string& prefix = scanner.prefix() ;
+  addBranch(prefix+"_rawId"   , kVectorInt  , branches.rawId   ) ;
+  addBranch(prefix+"_iRechit" , kVectorInt  , branches.iRechit ) ;
+  addBranch(prefix+"_energy"  , kVectorFloat, branches.energy  ) ;
+  addBranch(prefix+"_ieta"    , kVectorInt  , branches.ieta    ) ;
+  addBranch(prefix+"_iphi"    , kVectorInt  , branches.iphi    ) ;
+  addBranch(prefix+"_RecoFlag", kVectorInt  , branches.recoFlag) ;
+  const std::vector<std::string>& flagNames = scanner.storedFlagNames() ;
+  branches.flags.resize(flagNames.size()) ;
+  for(unsigned int i=0 ; i<flagNames.size() ; ++i){
+    addBranch(prefix+"_"+flagNames.at(i), kVectorBool, branches.flags.at(i)) ;
   }
-  store("EHits_isSaturated", isSaturated);
+}
 
+void IIHEModuleGedGsfElectron::storeRecHits(const EcalRecHitScanner& scanner, const RecHitBranches& branches){
+  store(branches.rawId   , scanner.rawId()   ) ;
+  store(branches.iRechit , scanner.iRechit() ) ;
+  store(branches.energy  , scanner.energy()  ) ;
+  store(branches.ieta    , scanner.ieta()    ) ;
+  store(branches.iphi    , scanner.iphi()    ) ;
+  store(branches.recoFlag, scanner.recoFlag()) ;
+  for(unsigned int i=0 ; i<branches.flags.size() ; ++i) store(branches.flags.at(i), scanner.flag(i)) ;
 }
 
 void IIHEModuleGedGsfElectron::beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup){}
@@ -28,7 +28,35 @@ IIHEModuleJet::IIHEModuleJet(const edm::ParameterSet& iConfig, edm::ConsumesColl
 
   ETThreshold_ = iConfig.getUntrackedParameter<double>("jetPtThreshold") ;
   isMC_ = iConfig.getUntrackedParameter<bool>("isMC") ;
-  btw = new BTagWeighter("tt");
+  string btagCacheFile = iConfig.getUntrackedParameter<string>("btagCacheFile", "") ;
+  if(iConfig.getUntrackedParameter<bool>("btagCompileCache", false) && btagCacheFile!=""){
+    BTagWeighter::CompileCache("tt", btagCacheFile) ;
+  }
+  double btagSFTableTolerance = iConfig.getUntrackedParameter<double>("btagSFTableTolerance", 0.0) ;
+  if(!(btagSFTableTolerance>=0)){
+    throw cms::Exception("Configuration") << "btagSFTableTolerance must not be negative, got " << btagSFTableTolerance ;
+  }
+  btw = new BTagWeighter("tt", false, false, btagSFTableTolerance, btagCacheFile);
+
+  // b-tag scale factors stored per jet, all evaluated in one JetBTagWeights call
+  const string ctr = "central";
+  const string vup = "up";
+  const string vdown = "down";
+  const vector<pair<BTagEntry::OperatingPoint, string> > ops = {{BTagEntry::OP_LOOSE , "loose" },
+                                                                {BTagEntry::OP_MEDIUM, "medium"},
+                                                                {BTagEntry::OP_TIGHT , "tight" }} ;
+  for(const auto& op : ops){
+    btagRequests_.push_back(BTagWeighter::WeightRequest(op.first, ctr  , ctr  )) ;
+    btagBranchNames_.push_back("jet_BtagSF_"         + op.second) ;
+    btagRequests_.push_back(BTagWeighter::WeightRequest(op.first, vup  , ctr  )) ;
+    btagBranchNames_.push_back("jet_BtagSFbcUp_"     + op.second) ;
+    btagRequests_.push_back(BTagWeighter::WeightRequest(op.first, vdown, ctr  )) ;
+    btagBranchNames_.push_back("jet_BtagSFbcDown_"   + op.second) ;
+    btagRequests_.push_back(BTagWeighter::WeightRequest(op.first, ctr  , vup  )) ;
+    btagBranchNames_.push_back("jet_BtagSFudsgUp_"   + op.second) ;
+    btagRequests_.push_back(BTagWeighter::WeightRequest(op.first, ctr  , vdown)) ;
+    btagBranchNames_.push_back("jet_BtagSFudsgDown_" + op.second) ;
+  }
 
 }
 IIHEModuleJet::~IIHEModuleJet(){}
@@ -124,13 +152,6 @@ void IIHEModuleJet::analyze(const edm::Event& iEvent, const edm::EventSetup& iSe
   edm::Handle<edm::View<pat::Jet> > pfJetHandleSmearedJetResDown_;
   iEvent.getByToken(pfJetTokenSmearedJetResDown_, pfJetHandleSmearedJetResDown_);
 
-  const string ctr = "central";
-  const string vup = "up";
-  const string vdown = "down";
-  const auto op_loose = BTagEntry::OP_LOOSE;
-  const auto op_med = BTagEntry::OP_MEDIUM;
-  const auto op_tight = BTagEntry::OP_TIGHT;
-
   store("jet_n", (unsigned int) pfJetHandle_ -> size() );
   for ( unsigned int i = 0; i <pfJetHandle_->size(); ++i) {
     Ptr<pat::Jet> pfjet = pfJetHandle_->ptrAt( i );
@@ -204,25 +225,10 @@ void IIHEModuleJet::analyze(const edm::Event& iEvent, const edm::EventSetup& iSe
       store("jet_EnDown_pt",pfJetHandleEnDown_->at(i).pt());
       store("jet_EnDown_energy",pfJetHandleEnDown_->at(i).energy());
 
-//JetBTagWeight( edm::View<pat::Jet>&b, size_t ijet, const vector<BTagEntry::OperatingPoinconst string &bc_full_syst, const string &udsg_full_syst,const string &bc_full_syst, const string &udsg_full_syst,const string &bc_fast_syst, const string &udsg_fast_syst,bool do_deep_csv, bool do_by_proc, Runs runs)
-
-      store("jet_BtagSF_loose"         ,btw->JetBTagWeight(pfJetHandleSmeared_->at(i), op_loose, ctr  , ctr  ,  ctr, ctr, false, false, BTagWeighter::Runs::all));
-      store("jet_BtagSFbcUp_loose"     ,btw->JetBTagWeight(pfJetHandleSmeared_->at(i), op_loose, vup  , ctr  ,  ctr, ctr, false, false, BTagWeighter::Runs::all));
-      store("jet_BtagSFbcDown_loose"   ,btw->JetBTagWeight(pfJetHandleSmeared_->at(i), op_loose, vdown, ctr  ,  ctr, ctr, false, false, BTagWeighter::Runs::all));
-      store("jet_BtagSFudsgUp_loose"   ,btw->JetBTagWeight(pfJetHandleSmeared_->at(i), op_loose, ctr  , vup  ,  ctr, ctr, false, false, BTagWeighter::Runs::all));
-      store("jet_BtagSFudsgDown_loose" ,btw->JetBTagWeight(pfJetHandleSmeared_->at(i), op_loose, ctr  , vdown, ctr, ctr, false, false, BTagWeighter::Runs::all));
-
-      store("jet_BtagSF_medium"        ,btw->JetBTagWeight(pfJetHandleSmeared_->at(i), op_med  , ctr  , ctr  ,  ctr, ctr, false, false, BTagWeighter::Runs::all));
-      store("jet_BtagSFbcUp_medium"    ,btw->JetBTagWeight(pfJetHandleSmeared_->at(i), op_med  , vup  , ctr  ,  ctr, ctr, false, false, BTagWeighter::Runs::all));
-      store("jet_BtagSFbcDown_medium"  ,btw->JetBTagWeight(pfJetHandleSmeared_->at(i), op_med  , vdown, ctr  ,  ctr, ctr, false, false, BTagWeighter::Runs::all));
-      store("jet_BtagSFudsgUp_medium"  ,btw->JetBTagWeight(pfJetHandleSmeared_->at(i), op_med  , ctr  , vup  ,  ctr, ctr, false, false, BTagWeighter::Runs::all));
-      store("jet_BtagSFudsgDown_medium",btw->JetBTagWeight(pfJetHandleSmeared_->at(i), op_med  , ctr  , vdown, ctr, ctr, false, false, BTagWeighter::Runs::all));
-
-      store("jet_BtagSF_tight"         ,btw->JetBTagWeight(pfJetHandleSmeared_->at(i), op_tight, ctr  , ctr  ,  ctr, ctr, false, false, BTagWeighter::Runs::all));
-      store("jet_BtagSFbcUp_tight"     ,btw->JetBTagWeight(pfJetHandleSmeared_->at(i), op_tight, vup  , ctr  ,  ctr, ctr, false, false, BTagWeighter::Runs::all));
-      store("jet_BtagSFbcDown_tight"   ,btw->JetBTagWeight(pfJetHandleSmeared_->at(i), op_tight, vdown, ctr  ,  ctr, ctr, false, false, BTagWeighter::Runs::all));
-      store("jet_BtagSFudsgUp_tight"   ,btw->JetBTagWeight(pfJetHandleSmeared_->at(i), op_tight, ctr  , vup  ,  ctr, ctr, false, false, BTagWeighter::Runs::all));
-      store("jet_BtagSFudsgDown_tight" ,btw->JetBTagWeight(pfJetHandleSmeared_->at(i), op_tight, ctr  , vdown, ctr, ctr, false, false, BTagWeighter::Runs::all));
+      btw->JetBTagWeights(pfJetHandleSmeared_->at(i), btagRequests_, false, false, btagWeights_) ;
+      for(unsigned int k=0 ; k<btagWeights_.size() ; ++k){
+        store(btagBranchNames_.at(k), btagWeights_.at(k)) ;
+      }
 
    }
 
@@ -235,6 +241,10 @@ void IIHEModuleJet::endEvent(){}
 
 // ------------ method called once each job just after ending the event loop  ------------
 void IIHEModuleJet::endJob(){
+  // The scale factor tables are built as the jets need them
+  if(btw->MaxTableDeviation()>0){
+    std::cout << "BTagWeighter: max deviation of the scale factor tables from TF1 " << btw->MaxTableDeviation() << std::endl ;
+  }
 }
 
 DEFINE_FWK_MODULE(IIHEModuleJet);
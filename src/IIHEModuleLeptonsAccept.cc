@@ -16,6 +16,7 @@ IIHEModuleLeptonsAccept::IIHEModuleLeptonsAccept(const edm::ParameterSet& iConfi
   nMuThreshold_        = iConfig.getUntrackedParameter<int>("leptonsAccept_nMu"      ) ;
   nMuTauThreshold_     = iConfig.getUntrackedParameter<int>("leptonsAccept_nMuTau"   ) ;
   nTauThreshold_       = iConfig.getUntrackedParameter<int>("leptonsAccept_nTau"     ) ;
+  asGate_              = iConfig.getUntrackedParameter<bool>("leptonsAcceptAsGate", false) ;
 
   electronCollectionLabel_     = iConfig.getParameter<edm::InputTag>("electronCollection"      ) ;
   muonCollectionLabel_         = iConfig.getParameter<edm::InputTag>("muonCollection"          ) ;
@@ -81,8 +82,9 @@ void IIHEModuleLeptonsAccept::analyze(const edm::Event& iEvent, const edm::Event
     acceptEvent() ;
     nAcceptAll_++ ;
   }
-  else{
-    //rejectEvent() ;
+  else if(asGate_){
+    // Running as a gate, so stop the other modules from doing any work on this event
+    rejectEvent() ;
   }
 }
 void IIHEModuleLeptonsAccept::beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup){}
@@ -8,7 +8,7 @@ using namespace std ;
 using namespace reco;
 using namespace edm ;
 
-IIHEModuleMCTruth::IIHEModuleMCTruth(const edm::ParameterSet& iConfig, edm::ConsumesCollector && iC): IIHEModule(iConfig){
+IIHEModuleMCTruth::IIHEModuleMCTruth(const edm::ParameterSet& iConfig, edm::ConsumesCollector && iC): IIHEModule(iConfig), truthGrid_(5.0, 0.2){
   pt_threshold_            = iConfig.getUntrackedParameter<double>("MCTruth_ptThreshold"            ) ;
   m_threshold_             = iConfig.getUntrackedParameter<double>("MCTruth_mThreshold"             ) ;
   DeltaROverlapThreshold_  = iConfig.getUntrackedParameter<double>("MCTruth_DeltaROverlapThreshold" ) ;
@@ -178,12 +178,13 @@ void IIHEModuleMCTruth::analyze(const edm::Event& iEvent, const edm::EventSetup&
   
   Handle<GenParticleCollection> pGenParticles ;
   iEvent.getByToken(genParticlesCollection_, pGenParticles) ;
-  GenParticleCollection genParticles(pGenParticles->begin(),pGenParticles->end()) ;
+  const GenParticleCollection& genParticles = *pGenParticles ;
   
   // These variables are used to match up mothers to daughters at the end.
   int counter = 0 ;
   
   MCTruthRecord_.clear() ;
+  truthGrid_.clear() ;
 
   MCTruthObject* MCTruth ;
 //  const Candidate* parent ;
@@ -193,15 +194,16 @@ void IIHEModuleMCTruth::analyze(const edm::Event& iEvent, const edm::EventSetup&
     if(mc_iter->status()<20 || mc_iter->status()>30) continue;
 //    if(mc_iter->status()!=23) continue;
 //    cout<< mc_iter->status()<<"                "<<mc_iter->pdgId()<<endl;
-    child  = mc_iter->clone()  ;
+    child  = &*mc_iter ;
     // Create a truth record instance.
-    MCTruth = new MCTruthObject((reco::Candidate*)&*mc_iter) ;
+    MCTruth = MCTruthPool_.create((reco::Candidate*)&*mc_iter) ;
     //
     // Add all the mothers
     for(unsigned int mother_iter=0 ; mother_iter<child->numberOfMothers() ; ++mother_iter){
         MCTruth->addMother(child->mother(mother_iter)) ;
     }    
 
+    truthGrid_.insert(MCTruth->eta(), MCTruth->phi(), MCTruthRecord_.size()) ;
     MCTruthRecord_.push_back(MCTruth) ;
     counter++ ;
   }
@@ -237,24 +239,27 @@ void IIHEModuleMCTruth::analyze(const edm::Event& iEvent, const edm::EventSetup&
     if(false==accept) continue ;
     // Now go up the ancestry until we find the real parent
 //    parent = mc_iter->mother() ;
-    child  = mc_iter->clone()  ;
+    child  = &*mc_iter ;
 //    while(parent->pdgId()==pdgId){
 //      child  = parent ;
 //      parent = parent->mother() ;
 //    }
     
     // Create a truth record instance.
-    MCTruth = new MCTruthObject((reco::Candidate*)&*mc_iter) ;
+    MCTruth = MCTruthPool_.create((reco::Candidate*)&*mc_iter) ;
     
     // Add all the mothers
     for(unsigned int mother_iter=0 ; mother_iter<child->numberOfMothers() ; ++mother_iter){
       MCTruth->addMother(child->mother(mother_iter)) ;
     }
     
-    // Finally check to see if this overlaps with an existing truth particle.
+    // Finally check to see if this overlaps with an existing truth particle.  Only the
+    // records in the neighbouring cells can be close enough to overlap.
     bool overlap = false ;
-    for(unsigned int i=0 ; i<MCTruthRecord_.size() ; ++i){
-      const reco::Candidate* comp = MCTruthRecord_.at(i)->getCandidate() ;
+    truthNeighbours_.clear() ;
+    truthGrid_.neighbours(MCTruth->eta(), MCTruth->phi(), DeltaROverlapThreshold_, truthNeighbours_) ;
+    for(unsigned int i=0 ; i<truthNeighbours_.size() ; ++i){
+      const reco::Candidate* comp = MCTruthRecord_.at(truthNeighbours_.at(i))->getCandidate() ;
       float DR = deltaR(comp->eta(),comp->phi(),MCTruth->getCandidate()->eta(),MCTruth->getCandidate()->phi()) ;
       if(DR<DeltaROverlapThreshold_){
         overlap = true ;
@@ -264,6 +269,7 @@ void IIHEModuleMCTruth::analyze(const edm::Event& iEvent, const edm::EventSetup&
     if(true==overlap) continue ;
     
     // Then push back the MC truth information
+    truthGrid_.insert(MCTruth->eta(), MCTruth->phi(), MCTruthRecord_.size()) ;
     MCTruthRecord_.push_back(MCTruth) ;
     counter++ ;
   }
@@ -331,18 +337,20 @@ void IIHEModuleMCTruth::analyze(const edm::Event& iEvent, const edm::EventSetup&
   store("mc_n", (unsigned int)(MCTruthRecord_.size())) ;
 }
 
+// Closest record in DeltaR.  The grid gives the same answer as scanning every record in
+// order and keeping the first one with the smallest DeltaR.
 int IIHEModuleMCTruth::matchEtaPhi_getIndex(float eta, float phi){
-  float bestDR = 1e6 ;
-  int bestIndex = -1 ;
+  return truthGrid_.nearest(eta, phi) ;
+}
+
+// Reference implementation of the above, kept to cross check the grid
+int IIHEModuleMCTruth::matchEtaPhi_getIndexLinear(float eta, float phi){
+  std::vector<float> etas, phis ;
   for(unsigned int i=0 ; i<MCTruthRecord_.size() ; ++i){
-    MCTruthObject* MCTruth = MCTruthRecord_.at(i) ;
-    float DR = deltaR(MCTruth->eta(),MCTruth->phi(),eta,phi) ;
-    if(DR<bestDR){
-      bestDR = DR ;
-      bestIndex = i ;
-    }
+    etas.push_back(MCTruthRecord_.at(i)->eta()) ;
+    phis.push_back(MCTruthRecord_.at(i)->phi()) ;
   }
-  return bestIndex ;
+  return EtaPhiGrid::nearestLinear(etas, phis, eta, phi) ;
 }
 
 const MCTruthObject* IIHEModuleMCTruth::matchEtaPhi(float eta, float phi){
@@ -356,7 +364,12 @@ const MCTruthObject* IIHEModuleMCTruth::getRecordByIndex(int index){
 }
 
 void IIHEModuleMCTruth::beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup){}
-void IIHEModuleMCTruth::beginEvent(){}
+void IIHEModuleMCTruth::beginEvent(){
+  // The records of the previous event are no longer needed, recycle them
+  MCTruthRecord_.clear() ;
+  truthGrid_.clear() ;
+  MCTruthPool_.reset() ;
+}
 void IIHEModuleMCTruth::endEvent(){}
 
 
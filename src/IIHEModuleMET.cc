@@ -26,7 +26,7 @@ IIHEMETVariableBase::IIHEMETVariableBase(std::string prefix, std::string name, i
   branchType_ = type ;
 }
 bool IIHEMETVariableBase::addBranch(IIHEAnalysis* analysis){
-  return analysis->addBranch(branchName_, branchType_) ;
+  return analysis->addBranch(branchName_, branchType_, handle_) ;
 }
 
 IIHEMETVariableInt::IIHEMETVariableInt(std::string prefix, std::string name):
@@ -34,7 +34,7 @@ IIHEMETVariableBase(prefix, name, kVectorInt){
   reset() ;
 }
 void IIHEMETVariableInt::store(IIHEAnalysis* analysis){
-  analysis->store(BranchName(), value_) ;
+  analysis->store(handle(), value_) ;
 }
 
 IIHEMETVariableFloat::IIHEMETVariableFloat(std::string prefix, std::string name):
@@ -42,7 +42,7 @@ IIHEMETVariableBase(prefix, name, kFloat){
   reset() ;
 }
 void IIHEMETVariableFloat::store(IIHEAnalysis* analysis){
-  analysis->store(BranchName(), value_ ) ;
+  analysis->store(handle(), value_ ) ;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -26,7 +26,7 @@ IIHEMuonTrackVariableBase::IIHEMuonTrackVariableBase(std::string prefix, std::st
   branchType_ = type ;
 }
 bool IIHEMuonTrackVariableBase::addBranch(IIHEAnalysis* analysis){
-  return analysis->addBranch(branchName_, branchType_) ;
+  return analysis->addBranch(branchName_, branchType_, handle_) ;
 }
 
 IIHEMuonTrackVariableInt::IIHEMuonTrackVariableInt(std::string prefix, std::string name):
@@ -34,7 +34,7 @@ IIHEMuonTrackVariableBase(prefix, name, kVectorInt){
   reset() ;
 }
 void IIHEMuonTrackVariableInt::store(IIHEAnalysis* analysis){
-  analysis->store(BranchName(), value_) ;
+  analysis->store(handle(), value_) ;
 }
 
 IIHEMuonTrackVariableFloat::IIHEMuonTrackVariableFloat(std::string prefix, std::string name):
@@ -42,7 +42,7 @@ IIHEMuonTrackVariableBase(prefix, name, kVectorFloat){
   reset() ;
 }
 void IIHEMuonTrackVariableFloat::store(IIHEAnalysis* analysis){
-  analysis->store(BranchName(), value_ ) ;
+  analysis->store(handle(), value_ ) ;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -30,11 +30,16 @@ void IIHEModulePreshower::beginJob(){
 
 // ------------ method called to for each event  ------------
 void IIHEModulePreshower::analyze(const edm::Event& iEvent, const edm::EventSetup& iSetup){
-  edm::ESHandle<CaloGeometry> pGeometry ;
-  iSetup.get<CaloGeometryRecord>().get(pGeometry) ;
-  CaloGeometry* geometry = (CaloGeometry*) pGeometry.product() ;
-  geometryPreshower_ = (CaloSubdetectorGeometry*) geometry->getSubdetectorGeometry(DetId::Ecal, EcalPreshower) ;
-  if(geometry) topologyPreshower_ = new EcalPreshowerTopology(geometry) ;
+  // The topology is only rebuilt when the geometry IOV changes
+  const CaloGeometryCache* caloGeometry = &ownGeometry_ ;
+  if(parent_){
+    caloGeometry = &getCaloGeometry(iSetup) ;
+  }
+  else{
+    ownGeometry_.update(iSetup) ;
+  }
+  geometryPreshower_ = caloGeometry->geometryPreshower() ;
+  topologyPreshower_ = caloGeometry->topologyPreshower() ;
 }
 
 void IIHEModulePreshower::printPreshowerCells(int start){
@@ -12,9 +12,99 @@ IIHEModuleTau::IIHEModuleTau(const edm::ParameterSet& iConfig, edm::ConsumesColl
   ETThreshold_ = iConfig.getUntrackedParameter<double>("tauPtTThreshold" ) ;
   tauCollectionLabel_     = iConfig.getParameter<edm::InputTag>("tauCollection");
   tauCollectionToken_     = iC.consumes<View<pat::Tau>> (tauCollectionLabel_);
+  
+  tauIDNames_ = std::vector<std::string>{
+    "decayModeFinding",
+    "decayModeFindingNewDMs",
+    "byLooseCombinedIsolationDeltaBetaCorr3Hits",
+    "byMediumCombinedIsolationDeltaBetaCorr3Hits",
+    "byTightCombinedIsolationDeltaBetaCorr3Hits",
+    "byCombinedIsolationDeltaBetaCorrRaw3Hits",
+    "byIsolationMVArun2v1DBoldDMwLTraw",
+    "byVLooseIsolationMVArun2v1DBoldDMwLT",
+    "byLooseIsolationMVArun2v1DBoldDMwLT",
+    "byMediumIsolationMVArun2v1DBoldDMwLT",
+    "byTightIsolationMVArun2v1DBoldDMwLT",
+    "byVTightIsolationMVArun2v1DBoldDMwLT",
+    "byVVTightIsolationMVArun2v1DBoldDMwLT",
+    "byIsolationMVArun2v1DBnewDMwLTraw",
+    "byVLooseIsolationMVArun2v1DBnewDMwLT",
+    "byLooseIsolationMVArun2v1DBnewDMwLT",
+    "byMediumIsolationMVArun2v1DBnewDMwLT",
+    "byTightIsolationMVArun2v1DBnewDMwLT",
+    "byVTightIsolationMVArun2v1DBnewDMwLT",
+    "byVVTightIsolationMVArun2v1DBnewDMwLT",
+    "byIsolationMVArun2v1PWoldDMwLTraw",
+    "byVLooseIsolationMVArun2v1PWoldDMwLT",
+    "byLooseIsolationMVArun2v1PWoldDMwLT",
+    "byMediumIsolationMVArun2v1PWoldDMwLT",
+    "byTightIsolationMVArun2v1PWoldDMwLT",
+    "byVTightIsolationMVArun2v1PWoldDMwLT",
+    "byVVTightIsolationMVArun2v1PWoldDMwLT",
+    "byIsolationMVArun2v1PWnewDMwLTraw",
+    "byVLooseIsolationMVArun2v1PWnewDMwLT",
+    "byLooseIsolationMVArun2v1PWnewDMwLT",
+    "byMediumIsolationMVArun2v1PWnewDMwLT",
+    "byTightIsolationMVArun2v1PWnewDMwLT",
+    "byVTightIsolationMVArun2v1PWnewDMwLT",
+    "byVVTightIsolationMVArun2v1PWnewDMwLT",
+    "byIsolationMVArun2v1DBdR03oldDMwLTraw",
+    "byVLooseIsolationMVArun2v1DBdR03oldDMwLT",
+    "byLooseIsolationMVArun2v1DBdR03oldDMwLT",
+    "byMediumIsolationMVArun2v1DBdR03oldDMwLT",
+    "byTightIsolationMVArun2v1DBdR03oldDMwLT",
+    "byVTightIsolationMVArun2v1DBdR03oldDMwLT",
+    "byVVTightIsolationMVArun2v1DBdR03oldDMwLT",
+    "byIsolationMVArun2v1PWdR03oldDMwLTraw",
+    "byVLooseIsolationMVArun2v1PWdR03oldDMwLT",
+    "byLooseIsolationMVArun2v1PWdR03oldDMwLT",
+    "byMediumIsolationMVArun2v1PWdR03oldDMwLT",
+    "byTightIsolationMVArun2v1PWdR03oldDMwLT",
+    "byVTightIsolationMVArun2v1PWdR03oldDMwLT",
+    "byVVTightIsolationMVArun2v1PWdR03oldDMwLT",
+    "againstMuonLoose3",
+    "againstMuonTight3",
+    "againstElectronMVA6Raw",
+    "againstElectronMVA6category",
+    "againstElectronVLooseMVA6",
+    "againstElectronLooseMVA6",
+    "againstElectronMediumMVA6",
+    "againstElectronTightMVA6",
+    "againstElectronVTightMVA6"
+  } ;
+  for(unsigned int i=0 ; i<tauIDNames_.size() ; ++i) tauIDBranchNames_.push_back("tau_" + tauIDNames_.at(i)) ;
+  tauIDsResolved_ = false ;
+  tauIDLayoutSize_ = 0 ;
 }
 IIHEModuleTau::~IIHEModuleTau(){}
 
+// Find where each discriminator sits in tauIDs().  pat::Tau::tauID takes the first entry
+// with the name, so this does too.  Missing ones get -1.
+void IIHEModuleTau::resolveTauIDs(const pat::Tau& tau){
+  const std::vector<pat::Tau::IdPair>& tauIDs = tau.tauIDs() ;
+  tauIDIndices_.assign(tauIDNames_.size(), -1) ;
+  for(unsigned int i=0 ; i<tauIDNames_.size() ; ++i){
+    for(unsigned int j=0 ; j<tauIDs.size() ; ++j){
+      if(tauIDs.at(j).first==tauIDNames_.at(i)){
+        tauIDIndices_.at(i) = j ;
+        break ;
+      }
+    }
+  }
+  tauIDLayoutSize_ = tauIDs.size() ;
+  tauIDsResolved_ = true ;
+}
+
+bool IIHEModuleTau::tauIDLayoutMatches(const pat::Tau& tau){
+  const std::vector<pat::Tau::IdPair>& tauIDs = tau.tauIDs() ;
+  if(tauIDs.size()!=tauIDLayoutSize_) return false ;
+  for(unsigned int i=0 ; i<tauIDNames_.size() ; ++i){
+    int index = tauIDIndices_.at(i) ;
+    if(index>=0 && tauIDs.at(index).first!=tauIDNames_.at(i)) return false ;
+  }
+  return true ;
+}
+
 // ------------ method called once each job just before starting event loop  ------------
 void IIHEModuleTau::beginJob(){
 
@@ -129,63 +219,23 @@ void IIHEModuleTau::analyze(const edm::Event& iEvent, const edm::EventSetup& iSe
     store("tau_dxy"   , tauni->dxy()) ;
     store("tau_dxy_error"         , tauni->dxy_error()) ;
     store("tau_ptLeadChargedCand" , tauni->ptLeadChargedCand()) ;
-    store("tau_decayModeFinding"                           , tauni->tauID("decayModeFinding") );
-    store("tau_decayModeFindingNewDMs"                     , tauni->tauID("decayModeFindingNewDMs") );
-    store("tau_byLooseCombinedIsolationDeltaBetaCorr3Hits" , tauni->tauID("byLooseCombinedIsolationDeltaBetaCorr3Hits")) ;
-    store("tau_byMediumCombinedIsolationDeltaBetaCorr3Hits", tauni->tauID("byMediumCombinedIsolationDeltaBetaCorr3Hits") );
-    store("tau_byTightCombinedIsolationDeltaBetaCorr3Hits" , tauni->tauID("byTightCombinedIsolationDeltaBetaCorr3Hits") );
-    store("tau_byCombinedIsolationDeltaBetaCorrRaw3Hits"   , tauni->tauID("byCombinedIsolationDeltaBetaCorrRaw3Hits") );
-    store("tau_byIsolationMVArun2v1DBoldDMwLTraw"          , tauni->tauID("byIsolationMVArun2v1DBoldDMwLTraw") );
-    store("tau_byVLooseIsolationMVArun2v1DBoldDMwLT"       , tauni->tauID("byVLooseIsolationMVArun2v1DBoldDMwLT") );
-    store("tau_byLooseIsolationMVArun2v1DBoldDMwLT"        , tauni->tauID("byLooseIsolationMVArun2v1DBoldDMwLT") );
-    store("tau_byMediumIsolationMVArun2v1DBoldDMwLT"       , tauni->tauID("byMediumIsolationMVArun2v1DBoldDMwLT") );
-    store("tau_byTightIsolationMVArun2v1DBoldDMwLT"        , tauni->tauID("byTightIsolationMVArun2v1DBoldDMwLT") );
-    store("tau_byVTightIsolationMVArun2v1DBoldDMwLT"       , tauni->tauID("byVTightIsolationMVArun2v1DBoldDMwLT") );
-    store("tau_byVVTightIsolationMVArun2v1DBoldDMwLT"      , tauni->tauID("byVVTightIsolationMVArun2v1DBoldDMwLT") );
-    store("tau_byIsolationMVArun2v1DBnewDMwLTraw"          , tauni->tauID("byIsolationMVArun2v1DBnewDMwLTraw") );
-    store("tau_byVLooseIsolationMVArun2v1DBnewDMwLT"       , tauni->tauID("byVLooseIsolationMVArun2v1DBnewDMwLT") );
-    store("tau_byLooseIsolationMVArun2v1DBnewDMwLT"        , tauni->tauID("byLooseIsolationMVArun2v1DBnewDMwLT") );
-    store("tau_byMediumIsolationMVArun2v1DBnewDMwLT"       , tauni->tauID("byMediumIsolationMVArun2v1DBnewDMwLT") );
-    store("tau_byTightIsolationMVArun2v1DBnewDMwLT"        , tauni->tauID("byTightIsolationMVArun2v1DBnewDMwLT") );
-    store("tau_byVTightIsolationMVArun2v1DBnewDMwLT"       , tauni->tauID("byVTightIsolationMVArun2v1DBnewDMwLT") );
-    store("tau_byVVTightIsolationMVArun2v1DBnewDMwLT"      , tauni->tauID("byVVTightIsolationMVArun2v1DBnewDMwLT") );
-    store("tau_byIsolationMVArun2v1PWoldDMwLTraw"          , tauni->tauID("byIsolationMVArun2v1PWoldDMwLTraw") );
-    store("tau_byVLooseIsolationMVArun2v1PWoldDMwLT"       , tauni->tauID("byVLooseIsolationMVArun2v1PWoldDMwLT") );
-    store("tau_byLooseIsolationMVArun2v1PWoldDMwLT"        , tauni->tauID("byLooseIsolationMVArun2v1PWoldDMwLT") );
-    store("tau_byMediumIsolationMVArun2v1PWoldDMwLT"       , tauni->tauID("byMediumIsolationMVArun2v1PWoldDMwLT") );
-    store("tau_byTightIsolationMVArun2v1PWoldDMwLT"        , tauni->tauID("byTightIsolationMVArun2v1PWoldDMwLT") );
-    store("tau_byVTightIsolationMVArun2v1PWoldDMwLT"       , tauni->tauID("byVTightIsolationMVArun2v1PWoldDMwLT") );
-    store("tau_byVVTightIsolationMVArun2v1PWoldDMwLT"      , tauni->tauID("byVVTightIsolationMVArun2v1PWoldDMwLT") );
-    store("tau_byIsolationMVArun2v1PWnewDMwLTraw"          , tauni->tauID("byIsolationMVArun2v1PWnewDMwLTraw") );
-    store("tau_byVLooseIsolationMVArun2v1PWnewDMwLT"       , tauni->tauID("byVLooseIsolationMVArun2v1PWnewDMwLT") );
-    store("tau_byLooseIsolationMVArun2v1PWnewDMwLT"        , tauni->tauID("byLooseIsolationMVArun2v1PWnewDMwLT") );
-    store("tau_byMediumIsolationMVArun2v1PWnewDMwLT"       , tauni->tauID("byMediumIsolationMVArun2v1PWnewDMwLT") );
-    store("tau_byTightIsolationMVArun2v1PWnewDMwLT"        , tauni->tauID("byTightIsolationMVArun2v1PWnewDMwLT") );
-    store("tau_byVTightIsolationMVArun2v1PWnewDMwLT"       , tauni->tauID("byVTightIsolationMVArun2v1PWnewDMwLT") );
-    store("tau_byVVTightIsolationMVArun2v1PWnewDMwLT"      , tauni->tauID("byVVTightIsolationMVArun2v1PWnewDMwLT") );
-    store("tau_byIsolationMVArun2v1DBdR03oldDMwLTraw"      , tauni->tauID("byIsolationMVArun2v1DBdR03oldDMwLTraw") );
-    store("tau_byVLooseIsolationMVArun2v1DBdR03oldDMwLT"   , tauni->tauID("byVLooseIsolationMVArun2v1DBdR03oldDMwLT") );
-    store("tau_byLooseIsolationMVArun2v1DBdR03oldDMwLT"    , tauni->tauID("byLooseIsolationMVArun2v1DBdR03oldDMwLT") );
-    store("tau_byMediumIsolationMVArun2v1DBdR03oldDMwLT"   , tauni->tauID("byMediumIsolationMVArun2v1DBdR03oldDMwLT") );
-    store("tau_byTightIsolationMVArun2v1DBdR03oldDMwLT"    , tauni->tauID("byTightIsolationMVArun2v1DBdR03oldDMwLT") );
-    store("tau_byVTightIsolationMVArun2v1DBdR03oldDMwLT"   , tauni->tauID("byVTightIsolationMVArun2v1DBdR03oldDMwLT") );
-    store("tau_byVVTightIsolationMVArun2v1DBdR03oldDMwLT"  , tauni->tauID("byVVTightIsolationMVArun2v1DBdR03oldDMwLT") );
-    store("tau_byIsolationMVArun2v1PWdR03oldDMwLTraw"      , tauni->tauID("byIsolationMVArun2v1PWdR03oldDMwLTraw") );
-    store("tau_byVLooseIsolationMVArun2v1PWdR03oldDMwLT"   , tauni->tauID("byVLooseIsolationMVArun2v1PWdR03oldDMwLT") );
-    store("tau_byLooseIsolationMVArun2v1PWdR03oldDMwLT"    , tauni->tauID("byLooseIsolationMVArun2v1PWdR03oldDMwLT") );
-    store("tau_byMediumIsolationMVArun2v1PWdR03oldDMwLT"   , tauni->tauID("byMediumIsolationMVArun2v1PWdR03oldDMwLT") );
-    store("tau_byTightIsolationMVArun2v1PWdR03oldDMwLT"    , tauni->tauID("byTightIsolationMVArun2v1PWdR03oldDMwLT") );
-    store("tau_byVTightIsolationMVArun2v1PWdR03oldDMwLT"   , tauni->tauID("byVTightIsolationMVArun2v1PWdR03oldDMwLT") );
-    store("tau_byVVTightIsolationMVArun2v1PWdR03oldDMwLT"  , tauni->tauID("byVVTightIsolationMVArun2v1PWdR03oldDMwLT") );
-    store("tau_againstMuonLoose3"          , tauni->tauID("againstMuonLoose3") );
-    store("tau_againstMuonTight3"          , tauni->tauID("againstMuonTight3") );
-    store("tau_againstElectronMVA6Raw"     , tauni->tauID("againstElectronMVA6Raw") );
-    store("tau_againstElectronMVA6category", tauni->tauID("againstElectronMVA6category") );
-    store("tau_againstElectronVLooseMVA6"  , tauni->tauID("againstElectronVLooseMVA6") );
-    store("tau_againstElectronLooseMVA6"   , tauni->tauID("againstElectronLooseMVA6") );
-    store("tau_againstElectronMediumMVA6"  , tauni->tauID("againstElectronMediumMVA6") );
-    store("tau_againstElectronTightMVA6"   , tauni->tauID("againstElectronTightMVA6") );
-    store("tau_againstElectronVTightMVA6"  , tauni->tauID("againstElectronVTightMVA6") );
+    // Discriminators, read by position once the layout of tauIDs() is known.  The layout
+    // is checked on every tau: one name comparison per discriminator, against a search
+    // through all of tauIDs() for each of them in pat::Tau::tauID.
+    const std::vector<pat::Tau::IdPair>& tauIDs = tauni->tauIDs() ;
+    if(!tauIDsResolved_){
+      resolveTauIDs(*tauni) ;
+    }
+    else if(!tauIDLayoutMatches(*tauni)){
+      std::cout << "IIHEModuleTau: the layout of the tau discriminators changed, resolving them again" << std::endl ;
+      resolveTauIDs(*tauni) ;
+    }
+    for(unsigned int j=0 ; j<tauIDNames_.size() ; ++j){
+      int index = tauIDIndices_.at(j) ;
+      // Anything not found falls back to the lookup by name, which complains as before
+      float value = (index>=0) ? tauIDs.at(index).second : tauni->tauID(tauIDNames_.at(j)) ;
+      store(tauIDBranchNames_.at(j), value) ;
+    }
 
     store("tau_decayMode"         , tauni->decayMode()) ;
     store("tau_charge"            , tauni->charge()) ;
@@ -211,7 +261,9 @@ void IIHEModuleTau::analyze(const edm::Event& iEvent, const edm::EventSetup& iSe
 
   }
 }
-void IIHEModuleTau::beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup){}
+void IIHEModuleTau::beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup){
+  tauIDsResolved_ = false ;
+}
 void IIHEModuleTau::beginEvent(){}
 void IIHEModuleTau::endEvent(){}
 
@@ -1,5 +1,7 @@
 #include "UserCode/IIHETree/interface/IIHEModuleTrigger.h"
 #include "UserCode/IIHETree/interface/TriggerObject.h"
+#include "UserCode/IIHETree/interface/PackedTriggerBits.h"
+#include "UserCode/IIHETree/interface/TriggerNameMatcher.h"
 
 #include "DataFormats/EgammaCandidates/interface/GsfElectron.h"
 #include "DataFormats/Common/interface/TriggerResults.h"
@@ -21,6 +23,15 @@ IIHEModuleTrigger::IIHEModuleTrigger(const edm::ParameterSet& iConfig, edm::Cons
   nWasRun_ = 0 ;
   nAccept_ = 0 ;
   nErrors_ = 0 ;
+  nNameResolutionsRun_   = 0 ;
+  nNameResolutionsEvent_ = 0 ;
+  nMenus_ = 0 ;
+  nEventsTotal_ = 0 ;
+  packTriggerBits_ = iConfig.getUntrackedParameter<bool>("packTriggerBits", false) ;
+  
+  // Paths whose filter objects are saved: any path with one of these in its name
+  std::vector<std::string> saveFiltersPatterns = iConfig.getUntrackedParameter<std::vector<std::string> >("saveFiltersTriggers", defaultSaveFiltersTriggers()) ;
+  saveFiltersMatcher_ = TriggerNameMatcher(saveFiltersPatterns) ;
 
   triggerBitsLabel_       = iConfig.getParameter<edm::InputTag>("triggerResultsCollectionHLT") ;
   triggerBits_ = iC.consumes<edm::TriggerResults>(InputTag(triggerBitsLabel_));
@@ -61,8 +72,41 @@ IIHEModuleTrigger::IIHEModuleTrigger(const edm::ParameterSet& iConfig, edm::Cons
 }
 IIHEModuleTrigger::~IIHEModuleTrigger(){}
 
+std::vector<std::string> IIHEModuleTrigger::defaultSaveFiltersTriggers(){
+  return std::vector<std::string>{
+    "Ele27_eta2p1_WPTight_Gsf_v",
+    "DoubleEle33_CaloIdL_MW_v",
+    "DoubleEle33_CaloIdL_GsfTrkIdVL_v",
+    "Ele23_Ele12_CaloIdL_TrackIdL_IsoVL_DZ_v",
+    "Mu17_TrkIsoVVL_TkMu8_TrkIsoVVL_v",
+    "Mu17_TrkIsoVVL_Mu8_TrkIsoVVL_v",
+    "Mu17_TrkIsoVVL_Mu8_TrkIsoVVL_DZ_v",
+    "Mu17_TrkIsoVVL_TkMu8_TrkIsoVVL_DZ_v",
+    "Iso_TkMu24_v",
+    "Iso_Mu24_v",
+    "Mu23_TrkIsoVVL_Ele8_CaloIdL_TrackIdL_IsoVL_v",
+    "Mu8_TrkIsoVVL_Ele23_CaloIdL_TrackIdL_IsoVL_v",
+    "Mu23_TrkIsoVVL_Ele8_CaloIdL_TrackIdL_IsoVL_DZ_v",
+    "Mu8_TrkIsoVVL_Ele23_CaloIdL_TrackIdL_IsoVL_DZ_v"
+  } ;
+}
+
 // ------------ method called once each job just before starting event loop  ------------
 void IIHEModuleTrigger::beginJob(){
+  if(packTriggerBits_){
+    addBranch("trig_packedAccept"   , kVectorUInt, packedAcceptHandle_   ) ;
+    addBranch("trig_packedRun"      , kVectorUInt, packedRunHandle_      ) ;
+    addBranch("trig_packedPrescaled", kVectorUInt, packedPrescaledHandle_) ;
+  }
+}
+
+int IIHEModuleTrigger::packedBit(const std::string& baseName){
+  auto it = packedPathBits_.find(baseName) ;
+  if(it!=packedPathBits_.end()) return it->second ;
+  int bit = packedPathNames_.size() ;
+  packedPathNames_.push_back(baseName) ;
+  packedPathBits_.insert(std::make_pair(baseName, bit)) ;
+  return bit ;
 }
 
 bool IIHEModuleTrigger::addHLTrigger(HLTrigger* hlt){
@@ -71,21 +115,7 @@ bool IIHEModuleTrigger::addHLTrigger(HLTrigger* hlt){
       return false ;
     }
   }
-  if( hlt->nSubstringInString(hlt->name(), "Ele27_eta2p1_WPTight_Gsf_v") 
-     || hlt->nSubstringInString(hlt->name(), "DoubleEle33_CaloIdL_MW_v") 
-     || hlt->nSubstringInString(hlt->name(), "DoubleEle33_CaloIdL_GsfTrkIdVL_v" ) 
-     || hlt->nSubstringInString(hlt->name(), "Ele23_Ele12_CaloIdL_TrackIdL_IsoVL_DZ_v" ) 
-     || hlt->nSubstringInString(hlt->name(), "Mu17_TrkIsoVVL_TkMu8_TrkIsoVVL_v") 
-     || hlt->nSubstringInString(hlt->name(), "Mu17_TrkIsoVVL_Mu8_TrkIsoVVL_v")  
-     || hlt->nSubstringInString(hlt->name(), "Mu17_TrkIsoVVL_Mu8_TrkIsoVVL_DZ_v")  
-     || hlt->nSubstringInString(hlt->name(), "Mu17_TrkIsoVVL_TkMu8_TrkIsoVVL_DZ_v")  
-     || hlt->nSubstringInString(hlt->name(), "Iso_TkMu24_v" ) 
-     || hlt->nSubstringInString(hlt->name(), "Iso_Mu24_v" )
-     || hlt->nSubstringInString(hlt->name(), "Mu23_TrkIsoVVL_Ele8_CaloIdL_TrackIdL_IsoVL_v" )
-     || hlt->nSubstringInString(hlt->name(), "Mu8_TrkIsoVVL_Ele23_CaloIdL_TrackIdL_IsoVL_v" )
-     || hlt->nSubstringInString(hlt->name(), "Mu23_TrkIsoVVL_Ele8_CaloIdL_TrackIdL_IsoVL_DZ_v" )
-     || hlt->nSubstringInString(hlt->name(), "Mu8_TrkIsoVVL_Ele23_CaloIdL_TrackIdL_IsoVL_DZ_v" )
-) {
+  if(saveFiltersMatcher_.matchesAny(hlt->name())) {
     hlt->saveFilters();
   }
   hlt->savePrescale();
@@ -103,7 +133,12 @@ int IIHEModuleTrigger::addBranches(){
   for(unsigned int i=0 ; i<HLTriggers_.size() ; i++){
     if (std::find(savedHLTriggers_.begin(), savedHLTriggers_.end(), HLTriggers_.at(i)->name().substr(0, HLTriggers_.at(i)->name().find("_v"))) != savedHLTriggers_.end()) continue;
     savedHLTriggers_.push_back(HLTriggers_.at(i)->name().substr(0, HLTriggers_.at(i)->name().find("_v"))); 
-    result += HLTriggers_.at(i)->createBranches(analysis) ;
+    if(packTriggerBits_){
+      result += HLTriggers_.at(i)->createFilterBranches(analysis) ;
+    }
+    else{
+      result += HLTriggers_.at(i)->createBranches(analysis) ;
+    }
   }
   return result ;
 }
@@ -125,19 +160,76 @@ void IIHEModuleTrigger::analyze(const edm::Event& iEvent, const edm::EventSetup&
 
   // Now fill the values
   IIHEAnalysis* analysis = parent_ ;
+  if(packTriggerBits_){
+    unsigned int nWords = (packedPathNames_.size()+31)/32 ;
+    packedAccept_   .assign(nWords, 0) ;
+    packedRun_      .assign(nWords, 0) ;
+    packedPrescaled_.assign(nWords, 0) ;
+  }
   for(unsigned int i=0 ; i<HLTriggersPAT_.size() ; i++){
     HLTrigger* hlt = HLTriggersPAT_.at(i) ;
     hlt->status(triggerResultsCollection_) ;
-    hlt->store(analysis) ;
+    if(packTriggerBits_){
+      PackedTriggerBits::set(packedRun_, hlt->bit()) ;
+      if(hlt->accept()==1) PackedTriggerBits::set(packedAccept_, hlt->bit()) ;
+    }
+    else{
+      hlt->store(analysis) ;
+    }
   } 
 
+  setFilterIndices(trigEvent) ;
   for(unsigned int i=0 ; i<HLTriggers_.size() ; i++){
     HLTrigger* hlt = HLTriggers_.at(i) ;
-    hlt->fullStatus(iEvent, iSetup, hltConfig_, parent_->getPreScaleIndex(), HLTR, trigEvent, triggerEventLabel_, analysis) ;
-//    hlt->fullStatus(iEvent, iSetup, hltConfig_, HLTR, trigEvent ,analysis) ;
-    hlt->store(analysis) ;
+    hlt->fullStatus(parent_->getPreScaleIndex(), HLTR, trigEvent, filterIndices_, analysis) ;
+    if(packTriggerBits_){
+      if(hlt->index()>=0    ) PackedTriggerBits::set(packedRun_      , hlt->bit()) ;
+      if(hlt->accept()==1   ) PackedTriggerBits::set(packedAccept_   , hlt->bit()) ;
+      if(hlt->prescale()!=1 ) PackedTriggerBits::set(packedPrescaled_, hlt->bit()) ;
+      hlt->storeFilters(analysis) ;
+    }
+    else{
+      hlt->store(analysis) ;
+    }
+  }
+  if(packTriggerBits_){
+    store(packedAcceptHandle_   , packedAccept_   ) ;
+    store(packedRunHandle_      , packedRun_      ) ;
+    store(packedPrescaledHandle_, packedPrescaled_) ;
   }
   nEvents_++ ;
+  nEventsTotal_++ ;
+}
+
+void IIHEModuleTrigger::buildFilterTable(){
+  filterSlots_.clear() ;
+  for(unsigned int i=0 ; i<HLTriggers_.size() ; ++i){
+    HLTrigger* hlt = HLTriggers_.at(i) ;
+    if(!hlt->saveFiltersEnabled()) continue ;
+    for(unsigned int j=0 ; j<hlt->filters_.size() ; ++j){
+      TriggerFilter* filter = hlt->filters_.at(j) ;
+      // Same tag as TriggerEvent::filterIndex compares against
+      std::string tag = edm::InputTag(filter->name(), "", triggerEventLabel_.process()).encode() ;
+      auto slot = filterSlots_.insert(std::make_pair(tag, (int) filterSlots_.size())) ;
+      filter->setSlot(slot.first->second) ;
+      nNameResolutionsRun_++ ;
+    }
+  }
+}
+
+void IIHEModuleTrigger::setFilterIndices(edm::Handle<trigger::TriggerEvent> const& trigEvent){
+  if(filterSlots_.empty()) return ;
+  
+  // One pass over the filters in this event; the first match wins, as in filterIndex
+  int nFilters = trigEvent->sizeFilters() ;
+  filterIndices_.assign(filterSlots_.size(), nFilters) ;
+  for(int i=0 ; i<nFilters ; ++i){
+    auto slot = filterSlots_.find(trigEvent->filterTag(i).encode()) ;
+    nNameResolutionsEvent_++ ;
+    if(slot!=filterSlots_.end() && filterIndices_.at(slot->second)==nFilters){
+      filterIndices_.at(slot->second) = i ;
+    }
+  }
 }
 
 void IIHEModuleTrigger::beginRun(edm::Run const& iRun, edm::EventSetup const& iSetup){
@@ -149,7 +241,12 @@ void IIHEModuleTrigger::beginRun(edm::Run const& iRun, edm::EventSetup const& iS
       std::string namePAT = HLTNamesFromConfigPAT_.at(i) ;
       HLTrigger* hltPAT = new HLTrigger(namePAT, hltConfigPAT_) ;
       HLTriggersPAT_.push_back(hltPAT) ;
-      hltPAT->createBranches(analysis) ;
+      if(packTriggerBits_){
+        hltPAT->setBit(packedBit(hltPAT->baseName())) ;
+      }
+      else{
+        hltPAT->createBranches(analysis) ;
+      }
     }
   parent_->configureBranches() ;
   changed_ = false ;
@@ -196,10 +293,16 @@ void IIHEModuleTrigger::beginRun(edm::Run const& iRun, edm::EventSetup const& iS
         addHLTrigger(hlt) ;
       }
       
-      // Now we need to re-map the indices to the names, given that some new triggers may have been inserted to the menu
+      // Now we need to re-map the indices to the names, given that some new triggers may
+      // have been inserted to the menu.  Prescales and filter tags are resolved here too,
+      // so that analyze only reads indices.
       for(unsigned int i=0 ; i<HLTriggers_.size() ; ++i){
         HLTriggers_.at(i)->beginRun(hltConfig_) ;
+        nNameResolutionsRun_ += 1 + hltConfig_.prescaleSize() ;
+        if(packTriggerBits_) HLTriggers_.at(i)->setBit(packedBit(HLTriggers_.at(i)->baseName())) ;
       }
+      buildFilterTable() ;
+      nMenus_++ ;
       
       // Attempt to add branches
       addBranches() ;
@@ -222,6 +325,13 @@ void IIHEModuleTrigger::endEvent(){}
 
 
 // ------------ method called once each job just after ending the event loop  ------------
-void IIHEModuleTrigger::endJob(){}
+void IIHEModuleTrigger::endJob(){
+  if(packTriggerBits_) parent_->addCVValueToMetaTree("trig_packedPathNames", packedPathNames_) ;
+  addValueToMetaTree("trig_nMenus"                , nMenus_               ) ;
+  addValueToMetaTree("trig_nNameResolutionsRun"   , nNameResolutionsRun_  ) ;
+  addValueToMetaTree("trig_nNameResolutionsEvent" , nNameResolutionsEvent_) ;
+  std::cout << "IIHEModuleTrigger: " << nNameResolutionsRun_ << " name lookups in " << nMenus_ << " menu(s), "
+            << nNameResolutionsEvent_ << " in " << nEventsTotal_ << " events" << std::endl ;
+}
 
 DEFINE_FWK_MODULE(IIHEModuleTrigger);
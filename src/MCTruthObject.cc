@@ -1,19 +1,23 @@
 #include "UserCode/IIHETree/interface/MCTruthObject.h"
 
 MCTruthObject::MCTruthObject(reco::Candidate* cand){
+  reset(cand) ;
+}
+MCTruthObject::~MCTruthObject(){}
+void MCTruthObject::reset(reco::Candidate* cand){
   candidate_ = cand ;
   DeltaRCut_ = 0.001 ;
+  mothers_.clear() ;
   pdgId_  = cand->pdgId() ;
   pt_     = cand->pt() ;
   eta_    = cand->eta() ;
   phi_    = cand->phi() ;
   energy_ = cand->energy() ;
 }
-MCTruthObject::~MCTruthObject(){}
 void MCTruthObject::addMother(const reco::Candidate* mother){
   mothers_.push_back(mother) ;
 }
-int MCTruthObject::matchMother(std::vector<MCTruthObject*> otherCands, unsigned int index){
+int MCTruthObject::matchMother(const std::vector<MCTruthObject*>& otherCands, unsigned int index){
   if(index>=mothers_.size()) return -2 ;
   const reco::Candidate* mother = mothers_.at(index) ;
   int pdgId = mother->pdgId() ;
@@ -35,3 +39,13 @@ const reco::Candidate* MCTruthObject::getMother(unsigned int index){
   return mothers_.at(index) ;
 }
 
+
+MCTruthObject* MCTruthObjectPool::create(reco::Candidate* cand){
+  if(nUsed_<objects_.size()){
+    objects_.at(nUsed_).reset(cand) ;
+  }
+  else{
+    objects_.push_back(MCTruthObject(cand)) ;
+  }
+  return &objects_.at(nUsed_++) ;
+}
@@ -12,6 +12,7 @@ MiniAODHelper::MiniAODHelper()
   vertexIsSet = false;
   rhoIsSet = false;
   factorizedjetcorrectorIsSet = false;
+  allcands_ = 0;
 
   // twiki.cern.ch/twiki/bin/view/CMSPublic/SWGuideBTagging#Preliminary_working_or_operating
   // Preliminary working (or operating) points for CSVv2+IVF
@@ -126,9 +127,45 @@ void MiniAODHelper::SetPackedCandidates(const std::vector<pat::PackedCandidate>
   std::sort(charged_.begin(), charged_.end(), ByEta());
   std::sort(neutral_.begin(), neutral_.end(), ByEta());
   std::sort(pileup_.begin(),  pileup_.end(),  ByEta());
+  FillCandidateSlices(charged_, chargedSlices_);
+  FillCandidateSlices(neutral_, neutralSlices_);
+  FillCandidateSlices(pileup_,  pileupSlices_);
   clearVetos();
 }
 
+int MiniAODHelper::GetPhiSlice(double phi)
+{
+  if (!(phi == phi)) return 0;
+  double x = std::fmod(phi + M_PI, 2*M_PI);
+  if (x < 0) x += 2*M_PI;
+  int slice = (int) (x/(2*M_PI/nPhiSlices_));
+  return std::min(std::max(slice, 0), nPhiSlices_-1);
+}
+
+void MiniAODHelper::FillCandidateSlices(const std::vector<const pat::PackedCandidate *> & cands, CandidateSlices & slices)
+{
+  // cands is sorted in eta, so every slice comes out sorted too
+  slices.etas.resize(nPhiSlices_);
+  slices.positions.resize(nPhiSlices_);
+  for (int s = 0; s < nPhiSlices_; ++s) {
+    slices.etas[s].clear();
+    slices.positions[s].clear();
+  }
+  for (unsigned int i = 0; i < cands.size(); ++i) {
+    int s = GetPhiSlice(cands[i]->phi());
+    slices.etas[s].push_back(cands[i]->eta());
+    slices.positions[s].push_back(i);
+  }
+}
+
+const MiniAODHelper::CandidateSlices * MiniAODHelper::GetCandidateSlices(const std::vector<const pat::PackedCandidate *> & cands) const
+{
+  if (&cands == &charged_) return &chargedSlices_;
+  if (&cands == &neutral_) return &neutralSlices_;
+  if (&cands == &pileup_)  return &pileupSlices_;
+  return 0;
+}
+
 // Return packed cands collection
 std::vector<pat::PackedCandidate> MiniAODHelper::GetPackedCandidates(void){
 
@@ -139,6 +176,18 @@ std::vector<pat::PackedCandidate> MiniAODHelper::GetPackedCandidates(void){
   return packed_cands_collection;
 }
 
+// Same as GetPackedCandidates, without copying the collection
+const std::vector<pat::PackedCandidate>& MiniAODHelper::GetPackedCandidatesRef(void) const{
+
+  static const std::vector<pat::PackedCandidate> empty;
+  if (!allcands_ || allcands_->size() == 0) {
+    std::cout << "MiniAODHelper WARNING: packedCandidates are NOT set!" << std::endl;
+    return allcands_ ? *allcands_ : empty;
+  }
+
+  return *allcands_;
+}
+
 
 std::vector<pat::Muon>
 MiniAODHelper::GetSelectedMuons(const std::vector<pat::Muon>& inputMuons, const float iMinPt, const muonID::muonID iMuonID, const coneSize::coneSize iconeSize, const corrType::corrType icorrType, const float iMaxEta){
@@ -183,6 +232,49 @@ MiniAODHelper::GetSelectedTaus(const std::vector<pat::Tau>& inputTaus, const flo
   return selectedTaus;
 }
 
+// === Same selections, returning pointers into the input collection instead of copies === //
+std::vector<const pat::Muon*>
+MiniAODHelper::GetSelectedMuonPtrs(const std::vector<pat::Muon>& inputMuons, const float iMinPt, const muonID::muonID iMuonID, const coneSize::coneSize iconeSize, const corrType::corrType icorrType, const float iMaxEta){
+
+  CheckSetUp();
+
+  std::vector<const pat::Muon*> selectedMuons;
+
+  for( std::vector<pat::Muon>::const_iterator it = inputMuons.begin(), ed = inputMuons.end(); it != ed; ++it ){
+    if( isGoodMuon(*it,iMinPt,iMaxEta,iMuonID,iconeSize,icorrType) ) selectedMuons.push_back(&*it);
+  }
+
+  return selectedMuons;
+}
+
+std::vector<const pat::Electron*>
+MiniAODHelper::GetSelectedElectronPtrs(const std::vector<pat::Electron>& inputElectrons, const float iMinPt, const electronID::electronID iElectronID, const float iMaxEta){
+
+  CheckSetUp();
+
+  std::vector<const pat::Electron*> selectedElectrons;
+
+  for( std::vector<pat::Electron>::const_iterator it = inputElectrons.begin(), ed = inputElectrons.end(); it != ed; ++it ){
+    if( isGoodElectron(*it,iMinPt,iMaxEta,iElectronID) ) selectedElectrons.push_back(&*it);
+  }
+
+  return selectedElectrons;
+}
+
+std::vector<const pat::Tau*>
+MiniAODHelper::GetSelectedTauPtrs(const std::vector<pat::Tau>& inputTaus, const float iMinPt, const tauu::ID id){
+
+  CheckSetUp();
+
+  std::vector<const pat::Tau*> selectedTaus;
+
+  for( std::vector<pat::Tau>::const_iterator it = inputTaus.begin(), ed = inputTaus.end(); it != ed; ++it ){
+    if( isGoodTau(*it,iMinPt,id) ) selectedTaus.push_back(&*it);
+  }
+
+  return selectedTaus;
+}
+
 
 
 
@@ -653,10 +745,38 @@ float MiniAODHelper::GetMuonRelIso(const pat::Muon& iMuon,const coneSize::coneSi
       break;
 
     case coneSize::miniIso:
-      double miniIsoR = 10.0/min(max(float(iMuon.pt()), float(50.)),float(200.));
-      pfIsoCharged = isoSumRaw(charged_, iMuon, miniIsoR, 0.0001, 0.0, SelfVetoPolicy::selfVetoAll);
-      pfIsoNeutral = isoSumRaw(neutral_, iMuon, miniIsoR, 0.01, 0.5, SelfVetoPolicy::selfVetoAll);
-      switch(icorrType)
+      {
+	double miniIsoR = 10.0/min(max(float(iMuon.pt()), float(50.)),float(200.));
+	pfIsoCharged = isoSumRaw(charged_, iMuon, miniIsoR, 0.0001, 0.0, SelfVetoPolicy::selfVetoAll);
+	pfIsoNeutral = isoSumRaw(neutral_, iMuon, miniIsoR, 0.01, 0.5, SelfVetoPolicy::selfVetoAll);
+	double miniAbsIsoPU = 0;
+	if (icorrType == corrType::deltaBeta) miniAbsIsoPU = isoSumRaw(pileup_, iMuon, miniIsoR, 0.01, 0.5, SelfVetoPolicy::selfVetoAll);
+	result = MuonMiniIsoFromSums(iMuon, icorrType, miniIsoR, pfIsoCharged, pfIsoNeutral, miniAbsIsoPU, miniIso_calculation_params);
+      }
+      break;
+    }
+  return result;
+}
+
+void MiniAODHelper::AddMuonRelIso(pat::Muon& iMuon,const coneSize::coneSize iconeSize, const corrType::corrType icorrType, std::string userFloatName) const{
+  float iso=GetMuonRelIso(iMuon,iconeSize,icorrType);
+  iMuon.addUserFloat(userFloatName,iso);
+}
+
+void MiniAODHelper::AddMuonRelIso(std::vector<pat::Muon>& muons,const coneSize::coneSize iconeSize, const corrType::corrType icorrType, std::string userFloatName) const{
+  for(auto mu=muons.begin(); mu!=muons.end(); mu++){
+    AddMuonRelIso(*mu,iconeSize,icorrType,userFloatName);
+  }
+}
+
+// The rest of the miniIso case of GetMuonRelIso, once the cone sums are known
+float MiniAODHelper::MuonMiniIsoFromSums(const pat::Muon& iMuon, const corrType::corrType icorrType, double miniIsoR, double pfIsoCharged, double pfIsoNeutral, double miniAbsIsoPU, std::map<std::string,double>* miniIso_calculation_params) const
+{
+  double correction = 9999.;
+  double EffArea = 9999.;
+  double Eta = abs(iMuon.eta());
+
+  switch(icorrType)
 	{
 	case corrType::rhoEA:
 	  //effective area based on R03 Phys14_25ns_v1
@@ -676,37 +796,23 @@ float MiniAODHelper::GetMuonRelIso(const pat::Muon& iMuon,const coneSize::coneSi
 	  correction = useRho*EffArea*(miniIsoR/0.3)*(miniIsoR/0.3);
 	  break;
 	case corrType::deltaBeta:
-	  double miniAbsIsoPU = isoSumRaw(pileup_, iMuon, miniIsoR, 0.01, 0.5, SelfVetoPolicy::selfVetoAll);
 	  correction = 0.5*miniAbsIsoPU;
 	  break;
 	}
 
-      pfIsoPUSubtracted = std::max( 0.0, pfIsoNeutral - correction);
-      result = (pfIsoCharged + pfIsoPUSubtracted)/iMuon.pt();
-
-      if (miniIso_calculation_params) {
-         miniIso_calculation_params->clear();
-         (*miniIso_calculation_params)["miniAbsIsoCharged"] = pfIsoCharged;
-         (*miniIso_calculation_params)["miniAbsIsoNeutral"] = pfIsoNeutral;
-         (*miniIso_calculation_params)["rho"] = useRho;
-         (*miniIso_calculation_params)["effArea"] = EffArea;
-         (*miniIso_calculation_params)["miniIsoR"] = miniIsoR;
-         (*miniIso_calculation_params)["miniAbsIsoNeutralcorr"] = pfIsoPUSubtracted;
-      }
-      break;
-    }
-  return result;
-}
-
-void MiniAODHelper::AddMuonRelIso(pat::Muon& iMuon,const coneSize::coneSize iconeSize, const corrType::corrType icorrType, std::string userFloatName) const{
-  float iso=GetMuonRelIso(iMuon,iconeSize,icorrType);
-  iMuon.addUserFloat(userFloatName,iso);
-}
-
-void MiniAODHelper::AddMuonRelIso(std::vector<pat::Muon>& muons,const coneSize::coneSize iconeSize, const corrType::corrType icorrType, std::string userFloatName) const{
-  for(auto mu=muons.begin(); mu!=muons.end(); mu++){
-    AddMuonRelIso(*mu,iconeSize,icorrType,userFloatName);
+  double pfIsoPUSubtracted = std::max( 0.0, pfIsoNeutral - correction);
+  float result = (pfIsoCharged + pfIsoPUSubtracted)/iMuon.pt();
+
+  if (miniIso_calculation_params) {
+     miniIso_calculation_params->clear();
+     (*miniIso_calculation_params)["miniAbsIsoCharged"] = pfIsoCharged;
+     (*miniIso_calculation_params)["miniAbsIsoNeutral"] = pfIsoNeutral;
+     (*miniIso_calculation_params)["rho"] = useRho;
+     (*miniIso_calculation_params)["effArea"] = EffArea;
+     (*miniIso_calculation_params)["miniIsoR"] = miniIsoR;
+     (*miniIso_calculation_params)["miniAbsIsoNeutralcorr"] = pfIsoPUSubtracted;
   }
+  return result;
 }
 
 
@@ -787,23 +893,40 @@ float MiniAODHelper::GetElectronRelIso(const pat::Electron& iElectron,const cone
       result = (pfIsoCharged + pfIsoPUSubtracted)/iElectron.pt();
       break;
     case coneSize::miniIso:
-      double innerR_ch;
-      double innerR_nu;
-      double miniIsoR = 10.0/min(max(float(iElectron.pt()), float(50.)),float(200.));
-      if (iElectron.isEB())
-	{
-	  innerR_ch = 0.0;
-	  innerR_nu = 0.0;
-	}
-      else
-	{
-	  innerR_ch = 0.015;
-	  innerR_nu = 0.08;
-	}
+      {
+	double miniIsoR = 10.0/min(max(float(iElectron.pt()), float(50.)),float(200.));
+	double innerR_ch = iElectron.isEB() ? 0.0 : 0.015;
+	double innerR_nu = iElectron.isEB() ? 0.0 : 0.08;
+	pfIsoCharged = isoSumRaw(charged_, iElectron, miniIsoR, innerR_ch, 0.0, SelfVetoPolicy::selfVetoNone);
+	pfIsoNeutral = isoSumRaw(neutral_, iElectron, miniIsoR, innerR_nu, 0.0, SelfVetoPolicy::selfVetoNone, 22)+isoSumRaw(neutral_, iElectron, miniIsoR, 0.0, 0.0, SelfVetoPolicy::selfVetoNone, 130);
+	double miniAbsIsoPU = 0;
+	if (icorrType == corrType::deltaBeta) miniAbsIsoPU = isoSumRaw(pileup_, iElectron, miniIsoR, innerR_ch, 0.0, SelfVetoPolicy::selfVetoNone);
+	result = ElectronMiniIsoFromSums(iElectron, icorrType, ieffAreaType, miniIsoR, pfIsoCharged, pfIsoNeutral, miniAbsIsoPU, miniIso_calculation_params);
+      }
+      break;
+    }
+  return result;
+}
 
-      pfIsoCharged = isoSumRaw(charged_, iElectron, miniIsoR, innerR_ch, 0.0, SelfVetoPolicy::selfVetoNone);
-      pfIsoNeutral = isoSumRaw(neutral_, iElectron, miniIsoR, innerR_nu, 0.0, SelfVetoPolicy::selfVetoNone, 22)+isoSumRaw(neutral_, iElectron, miniIsoR, 0.0, 0.0, SelfVetoPolicy::selfVetoNone, 130);
-      switch(icorrType)
+void MiniAODHelper::AddElectronRelIso(pat::Electron& iElectron,const coneSize::coneSize iconeSize, const corrType::corrType icorrType,const effAreaType::effAreaType ieffAreaType, std::string userFloatName) const{
+    float iso=GetElectronRelIso(iElectron,iconeSize,icorrType,ieffAreaType);
+    iElectron.addUserFloat(userFloatName,iso);
+}
+
+void MiniAODHelper::AddElectronRelIso(std::vector<pat::Electron>& electrons,const coneSize::coneSize iconeSize, const corrType::corrType icorrType,const effAreaType::effAreaType ieffAreaType, std::string userFloatName) const{
+    for(auto el=electrons.begin(); el!=electrons.end(); el++){
+	AddElectronRelIso(*el,iconeSize,icorrType,ieffAreaType,userFloatName);
+    }
+}
+
+// The rest of the miniIso case of GetElectronRelIso, once the cone sums are known
+float MiniAODHelper::ElectronMiniIsoFromSums(const pat::Electron& iElectron, const corrType::corrType icorrType, const effAreaType::effAreaType ieffAreaType, double miniIsoR, double pfIsoCharged, double pfIsoNeutral, double miniAbsIsoPU, std::map<std::string,double>* miniIso_calculation_params) const
+{
+  double correction = 9999.;
+  double EffArea = 9999.;
+  double Eta = abs(iElectron.eta());
+
+  switch(icorrType)
 	{
 	case corrType::rhoEA:
 	  //effective area based on R03
@@ -831,38 +954,24 @@ float MiniAODHelper::GetElectronRelIso(const pat::Electron& iElectron,const cone
 	  correction = useRho*EffArea*(miniIsoR/0.3)*(miniIsoR/0.3);
 	  break;
 	case corrType::deltaBeta:
-	  double miniAbsIsoPU = isoSumRaw(pileup_, iElectron, miniIsoR, innerR_ch, 0.0, SelfVetoPolicy::selfVetoNone);
 	  correction = 0.5*miniAbsIsoPU;
 	  break;
 	}
-      pfIsoPUSubtracted = std::max( 0.0, pfIsoNeutral - correction);
-      result = (pfIsoCharged + pfIsoPUSubtracted)/iElectron.pt();
-
-      if (miniIso_calculation_params) {
-         miniIso_calculation_params->clear();
-         (*miniIso_calculation_params)["miniAbsIsoCharged"] = pfIsoCharged;
-         (*miniIso_calculation_params)["miniAbsIsoNeutral"] = pfIsoNeutral;
-         (*miniIso_calculation_params)["rho"] = useRho;
-         (*miniIso_calculation_params)["effArea"] = EffArea;
-         (*miniIso_calculation_params)["miniIsoR"] = miniIsoR;
-         (*miniIso_calculation_params)["miniAbsIsoNeutralcorr"] = pfIsoPUSubtracted;
-      }
-      break;
-    }
+  double pfIsoPUSubtracted = std::max( 0.0, pfIsoNeutral - correction);
+  float result = (pfIsoCharged + pfIsoPUSubtracted)/iElectron.pt();
+
+  if (miniIso_calculation_params) {
+     miniIso_calculation_params->clear();
+     (*miniIso_calculation_params)["miniAbsIsoCharged"] = pfIsoCharged;
+     (*miniIso_calculation_params)["miniAbsIsoNeutral"] = pfIsoNeutral;
+     (*miniIso_calculation_params)["rho"] = useRho;
+     (*miniIso_calculation_params)["effArea"] = EffArea;
+     (*miniIso_calculation_params)["miniIsoR"] = miniIsoR;
+     (*miniIso_calculation_params)["miniAbsIsoNeutralcorr"] = pfIsoPUSubtracted;
+  }
   return result;
 }
 
-void MiniAODHelper::AddElectronRelIso(pat::Electron& iElectron,const coneSize::coneSize iconeSize, const corrType::corrType icorrType,const effAreaType::effAreaType ieffAreaType, std::string userFloatName) const{
-    float iso=GetElectronRelIso(iElectron,iconeSize,icorrType,ieffAreaType);
-    iElectron.addUserFloat(userFloatName,iso);
-}
-
-void MiniAODHelper::AddElectronRelIso(std::vector<pat::Electron>& electrons,const coneSize::coneSize iconeSize, const corrType::corrType icorrType,const effAreaType::effAreaType ieffAreaType, std::string userFloatName) const{
-    for(auto el=electrons.begin(); el!=electrons.end(); el++){
-	AddElectronRelIso(*el,iconeSize,icorrType,ieffAreaType,userFloatName);
-    }
-}
-
 
 
 
@@ -1388,6 +1497,7 @@ void MiniAODHelper::addVetos(const reco::Candidate &cand) {
     const reco::CandidatePtr &cp = cand.sourceCandidatePtr(i);
     if (cp.isNonnull() && cp.isAvailable()) vetos_.push_back(&*cp);
   }
+  std::sort(vetos_.begin(), vetos_.end());
 }
 
 void MiniAODHelper::clearVetos() {
@@ -1398,35 +1508,60 @@ float MiniAODHelper::isoSumRaw(const std::vector<const pat::PackedCandidate *> &
 {
   float dR2 = dR*dR, innerR2 = innerR*innerR;
 
-  std::vector<const reco::Candidate *> vetos(vetos_);
+  // The shared vetos are sorted; the few of this candidate are searched separately
+  selfVetos_.clear();
   for (unsigned int i = 0, n = cand.numberOfSourceCandidatePtrs(); i < n; ++i) {
     if (selfVeto == SelfVetoPolicy::selfVetoNone) break;
     const reco::CandidatePtr &cp = cand.sourceCandidatePtr(i);
     if (cp.isNonnull() && cp.isAvailable()) {
-      vetos.push_back(&*cp);
+      selfVetos_.push_back(&*cp);
       if (selfVeto == SelfVetoPolicy::selfVetoFirst) break;
     }
   }
 
-  typedef std::vector<const pat::PackedCandidate *>::const_iterator IT;
-  IT candsbegin = std::lower_bound(cands.begin(), cands.end(), cand.eta() - dR, ByEta());
-  IT candsend = std::upper_bound(candsbegin, cands.end(), cand.eta() + dR, ByEta());
+  // Positions in cands of the candidates in the eta window.  With the slices only those
+  // in the phi slices around the cone are taken; they are put back in eta order so that
+  // the sum comes out bit for bit the same as over the whole window.
+  float etaLow = cand.eta() - dR, etaHigh = cand.eta() + dR;
+  coneCands_.clear();
+  const CandidateSlices * slices = GetCandidateSlices(cands);
+  if (slices) {
+    int nSide = (int) std::ceil((dR + 1e-4)/(2*M_PI/nPhiSlices_));
+    int center = GetPhiSlice(cand.phi());
+    for (int d = -std::min(nSide, (nPhiSlices_-1)/2); d <= std::min(nSide, nPhiSlices_/2); ++d) {
+      int s = ((center + d) % nPhiSlices_ + nPhiSlices_) % nPhiSlices_;
+      const std::vector<double> & etas = slices->etas[s];
+      std::vector<double>::const_iterator first = std::lower_bound(etas.begin(), etas.end(), etaLow);
+      std::vector<double>::const_iterator last = std::upper_bound(first, etas.end(), etaHigh);
+      coneCands_.insert(coneCands_.end(), slices->positions[s].begin() + (first - etas.begin()),
+                                          slices->positions[s].begin() + (last - etas.begin()));
+    }
+    std::sort(coneCands_.begin(), coneCands_.end());
+  }
+  else {
+    typedef std::vector<const pat::PackedCandidate *>::const_iterator IT;
+    IT candsbegin = std::lower_bound(cands.begin(), cands.end(), etaLow, ByEta());
+    IT candsend = std::upper_bound(candsbegin, cands.end(), etaHigh, ByEta());
+    for (IT icharged = candsbegin; icharged < candsend; ++icharged) {
+      coneCands_.push_back(icharged - cands.begin());
+    }
+  }
 
   double isosum = 0;
-  for (IT icharged = candsbegin; icharged < candsend; ++icharged) {
+  for (unsigned int i = 0; i < coneCands_.size(); ++i) {
+    const pat::PackedCandidate * icharged = cands[coneCands_[i]];
     // pdgId
-    if (pdgId > 0 && abs((*icharged)->pdgId()) != pdgId) continue;
+    if (pdgId > 0 && abs(icharged->pdgId()) != pdgId) continue;
     // threshold
-    if (threshold > 0 && (*icharged)->pt() < threshold) continue;
+    if (threshold > 0 && icharged->pt() < threshold) continue;
     // cone
-    float mydr2 = reco::deltaR2(**icharged, cand);
+    float mydr2 = reco::deltaR2(*icharged, cand);
     if (mydr2 >= dR2 || mydr2 < innerR2) continue;
     // veto
-    if (std::find(vetos.begin(), vetos.end(), *icharged) != vetos.end()) {
-      continue;
-    }
+    if (std::binary_search(vetos_.begin(), vetos_.end(), (const reco::Candidate *) icharged)) continue;
+    if (std::find(selfVetos_.begin(), selfVetos_.end(), (const reco::Candidate *) icharged) != selfVetos_.end()) continue;
     // add to sum
-    isosum += (*icharged)->pt();
+    isosum += icharged->pt();
   }
   return isosum;
 }
@@ -3,17 +3,57 @@
 
 #include <fstream>
 #include <sstream>
+#include <cstring>
 #include "TSystem.h"
 #include "TMath.h"
 #include "UserCode/IIHETree/interface/RoccoR.h"
 using namespace std ;
 
+namespace{
+    template<typename T> void putBytes(std::string& buf, const T* x, size_t n){
+	buf.append(reinterpret_cast<const char*>(x), n*sizeof(T));
+    }
+    template<typename T> bool getBytes(const char*& p, const char* end, T* x, size_t n){
+	if(size_t(end-p)<n*sizeof(T)) return false;
+	memcpy(x, p, n*sizeof(T));
+	p+=n*sizeof(T);
+	return true;
+    }
+
+    // 64 bit FNV-1a
+    const uint64_t CHECKSUMSTART=14695981039346656037ULL;
+    uint64_t addChecksum(uint64_t sum, const char* p, size_t n){
+	for(size_t i=0; i<n; ++i){
+	    sum^=(unsigned char)p[i];
+	    sum*=1099511628211ULL;
+	}
+	return sum;
+    }
+    uint64_t addChecksum(uint64_t sum, const std::string& s){
+	return addChecksum(sum, s.data(), s.size());
+    }
+
+    const char CACHEMAGIC[8]={'R','o','c','c','o','R','b','2'};
+}
+
 int RocRes::getBin(double x, const int NN, const double *b) const{
+    // the first i with x<b[i+1], or NN-1
+    if(sortedEdges) return std::upper_bound(b+1, b+NN, x) - (b+1);
     for(int i=0; i<NN; ++i) if(x<b[i+1]) return i;
     return NN-1;
 }
 
+void RocRes::checkEdges(){
+    sortedEdges = std::is_sorted(BETA, BETA+NETA+1);
+    for(int H=0; H<NETA; ++H){
+	sortedEdges = sortedEdges && std::is_sorted(ntrk[H], ntrk[H]+NTRK+1) && std::is_sorted(dtrk[H], dtrk[H]+NTRK+1);
+    }
+}
+
+const double RocRes::DEFAULT_INVCDF_TOL=0;
+
 RocRes::RocRes(){
+    invcdfTol=DEFAULT_INVCDF_TOL;
     reset();
 }
 
@@ -37,6 +77,7 @@ void RocRes::reset(){
 	}
     }
     BETA[NMAXETA]=0;
+    checkEdges();
 }
 
 int RocRes::getEtaBin(double feta) const{
@@ -72,6 +113,7 @@ void RocRes::dumpParams(){
     for(int H=0; H<NETA; ++H){
 	for(int F=0; F<NTRK; ++F){
 	    cb[H][F].init(0.0, width[H][F], alpha[H][F], power[H][F]);
+	    cb[H][F].requestTable(invcdfTol);
 	    cout << Form("%8.4f %8.4f %8.4f | ", rmsA[H][F], rmsB[H][F], rmsC[H][F]);
 	}
 	cout << endl;
@@ -82,7 +124,7 @@ void RocRes::dumpParams(){
 	
 void RocRes::init(std::string filename){
     std::ifstream in(filename.c_str());
-    char tag[4];
+    std::string tag;
     int type, sys, mem, isdt, var, bin;	
     std::string s;
     while(std::getline(in, s)){
@@ -122,11 +164,117 @@ void RocRes::init(std::string filename){
     for(int H=0; H<NETA; ++H){
 	for(int F=0; F<NTRK; ++F){
 	    cb[H][F].init(0.0, width[H][F], alpha[H][F], power[H][F]);
+	    cb[H][F].requestTable(invcdfTol);
 	}
     }
+    checkEdges();
     in.close();
 }
 
+void RocRes::setInvcdfTolerance(double tol){
+    invcdfTol=tol;
+    for(int H=0; H<NETA; ++H){
+	for(int F=0; F<NTRK; ++F){
+	    cb[H][F].requestTable(invcdfTol);
+	}
+    }
+}
+
+double RocRes::validateInvcdf(int nSample) const{
+    double dev=0;
+    for(int H=0; H<NETA; ++H){
+	for(int F=0; F<NTRK; ++F){
+	    double e=cb[H][F].maxInvcdfDeviation(nSample);
+	    if(e>dev || e!=e) dev=e;
+	}
+    }
+    return dev;
+}
+
+void RocRes::write(std::string& buf) const{
+    putBytes(buf, &NETA, 1);
+    putBytes(buf, &NTRK, 1);
+    putBytes(buf, &NMIN, 1);
+    putBytes(buf, BETA, NMAXETA+1);
+    putBytes(buf, &ntrk[0][0], NMAXETA*(NMAXTRK+1));
+    putBytes(buf, &dtrk[0][0], NMAXETA*(NMAXTRK+1));
+    putBytes(buf, &width[0][0], NMAXETA*NMAXTRK);
+    putBytes(buf, &alpha[0][0], NMAXETA*NMAXTRK);
+    putBytes(buf, &power[0][0], NMAXETA*NMAXTRK);
+    putBytes(buf, &rmsA[0][0], NMAXETA*NMAXTRK);
+    putBytes(buf, &rmsB[0][0], NMAXETA*NMAXTRK);
+    putBytes(buf, &rmsC[0][0], NMAXETA*NMAXTRK);
+    putBytes(buf, kDat, NMAXETA);
+    putBytes(buf, kRes, NMAXETA);
+
+    // the inverse cdf tables built so far too, which take longer to build than the rest to read
+    putBytes(buf, &invcdfTol, 1);
+    for(int H=0; H<NETA; ++H){
+	for(int F=0; F<NTRK; ++F){
+	    const CrystalBalll& c=cb[H][F];
+	    uint32_t n=c.tabU.size();
+	    putBytes(buf, &n, 1);
+	    if(n==0) continue;
+	    putBytes(buf, &c.tabTol, 1);
+	    putBytes(buf, &c.tabGuideScale, 1);
+	    putBytes(buf, &c.tabU[0], n);
+	    putBytes(buf, &c.tabX[0], n);
+	    putBytes(buf, &c.tabM0[0], n-1);
+	    putBytes(buf, &c.tabM1[0], n-1);
+	    putBytes(buf, &c.tabGuide[0], n-1);
+	}
+    }
+}
+
+bool RocRes::read(const char*& p, const char* end){
+    bool ok = getBytes(p, end, &NETA, 1)
+	&& getBytes(p, end, &NTRK, 1)
+	&& getBytes(p, end, &NMIN, 1)
+	&& getBytes(p, end, BETA, NMAXETA+1)
+	&& getBytes(p, end, &ntrk[0][0], NMAXETA*(NMAXTRK+1))
+	&& getBytes(p, end, &dtrk[0][0], NMAXETA*(NMAXTRK+1))
+	&& getBytes(p, end, &width[0][0], NMAXETA*NMAXTRK)
+	&& getBytes(p, end, &alpha[0][0], NMAXETA*NMAXTRK)
+	&& getBytes(p, end, &power[0][0], NMAXETA*NMAXTRK)
+	&& getBytes(p, end, &rmsA[0][0], NMAXETA*NMAXTRK)
+	&& getBytes(p, end, &rmsB[0][0], NMAXETA*NMAXTRK)
+	&& getBytes(p, end, &rmsC[0][0], NMAXETA*NMAXTRK)
+	&& getBytes(p, end, kDat, NMAXETA)
+	&& getBytes(p, end, kRes, NMAXETA);
+    if(!ok || NETA<1 || NETA>NMAXETA || NTRK<1 || NTRK>NMAXTRK) return false;
+
+    // as at the end of init, with the tolerance the cache was written with and the tables
+    // built by then; the others are built on first use as usual
+    if(!getBytes(p, end, &invcdfTol, 1) || !(invcdfTol>=0)) return false;
+    for(int H=0; H<NETA; ++H){
+	for(int F=0; F<NTRK; ++F){
+	    CrystalBalll& c=cb[H][F];
+	    c.init(0.0, width[H][F], alpha[H][F], power[H][F]);
+	    uint32_t n;
+	    if(!getBytes(p, end, &n, 1)) return false;
+	    if(n==1 || size_t(end-p)/sizeof(double)<n) return false;
+	    if(n>0){
+		c.tabU.resize(n);
+		c.tabX.resize(n);
+		c.tabM0.resize(n-1);
+		c.tabM1.resize(n-1);
+		c.tabGuide.resize(n-1);
+		ok = getBytes(p, end, &c.tabTol, 1)
+		    && getBytes(p, end, &c.tabGuideScale, 1)
+		    && getBytes(p, end, &c.tabU[0], n)
+		    && getBytes(p, end, &c.tabX[0], n)
+		    && getBytes(p, end, &c.tabM0[0], n-1)
+		    && getBytes(p, end, &c.tabM1[0], n-1)
+		    && getBytes(p, end, &c.tabGuide[0], n-1);
+		if(!ok || c.tabTol!=invcdfTol || !c.checkTable()) return false;
+	    }
+	    if(n==0) c.requestTable(invcdfTol);
+	}
+    }
+    checkEdges();
+    return true;
+}
+
 double RocRes::Sigma(double pt, int H, int F) const{
     double dpt=pt-45;
     return rmsA[H][F] + rmsB[H][F]*dpt + rmsC[H][F]*dpt*dpt;
@@ -137,7 +285,10 @@ double RocRes::getUrnd(int H, int F, double w) const{
 }
 
 double RocRes::kSpread(double gpt, double rpt, double eta, int n, double w) const{
-    int     H = getBin(fabs(eta), NETA, BETA);
+    return kSpreadBin(gpt, rpt, getBin(fabs(eta), NETA, BETA), n, w);
+}
+
+double RocRes::kSpreadBin(double gpt, double rpt, int H, int n, double w) const{
     int     F = n>NMIN ? n-NMIN : 0;
     double  v = getUrnd(H, F, w);
     int     D = getBin(v, NTRK, dtrk[H]);
@@ -166,7 +317,10 @@ double RocRes::kSmear(double pt, double eta, TYPE type, double w, double u, int
 }
 
 double RocRes::kExtra(double pt, double eta, int n, double u, double w) const{
-    int H = getBin(fabs(eta), NETA, BETA);
+    return kExtraBin(pt, getBin(fabs(eta), NETA, BETA), n, u, w);
+}
+
+double RocRes::kExtraBin(double pt, int H, int n, double u, double w) const{
     int F = n>NMIN ? n-NMIN : 0;
     double  v = ntrk[H][F]+(ntrk[H][F+1]-ntrk[H][F])*w;
     int     D = getBin(v, NTRK, dtrk[H]);
@@ -186,6 +340,8 @@ double RocRes::kExtra(double pt, double eta, int n, double u, double w) const{
 const double RocOne::MPHI=-TMath::Pi();
 
 int RocOne::getBin(double x, const int NN, const double *b) const{
+    // the first i with x<b[i+1], or NN-1
+    if(sortedEdges) return std::upper_bound(b+1, b+NN, x) - (b+1);
     for(int i=0; i<NN; ++i) if(x<b[i+1]) return i;
     return NN-1;
 }
@@ -237,6 +393,7 @@ void RocOne::reset(){
 	}
     }
     BETA[NMAXETA]=0;
+    sortedEdges=true;
 }
 
 void RocOne::init(std::string filename, int iTYPE, int iSYS, int iMEM){
@@ -246,7 +403,7 @@ void RocOne::init(std::string filename, int iTYPE, int iSYS, int iMEM){
     RR.init(filename);
 
     std::ifstream in(filename.c_str());
-    char tag[4];
+    std::string tag;
     int type, sys, mem, isdt, var, bin;	
 
     bool initialized=false;
@@ -282,28 +439,53 @@ void RocOne::init(std::string filename, int iTYPE, int iSYS, int iMEM){
 	}
     }
     if(!initialized) cout << "Problem with input file: " << filename << std::endl;
+    sortedEdges = std::is_sorted(BETA, BETA+NETA+1);
     in.close();
 }
 
+void RocOne::write(std::string& buf) const{
+    putBytes(buf, &NETA, 1);
+    putBytes(buf, &NPHI, 1);
+    putBytes(buf, BETA, NMAXETA+1);
+    putBytes(buf, &DPHI, 1);
+    putBytes(buf, &M[0][0][0], 2*NMAXETA*NMAXPHI);
+    putBytes(buf, &A[0][0][0], 2*NMAXETA*NMAXPHI);
+    putBytes(buf, &D[0][0], 2*NMAXETA);
+    RR.write(buf);
+}
+
+bool RocOne::read(const char*& p, const char* end){
+    bool ok = getBytes(p, end, &NETA, 1)
+	&& getBytes(p, end, &NPHI, 1)
+	&& getBytes(p, end, BETA, NMAXETA+1)
+	&& getBytes(p, end, &DPHI, 1)
+	&& getBytes(p, end, &M[0][0][0], 2*NMAXETA*NMAXPHI)
+	&& getBytes(p, end, &A[0][0][0], 2*NMAXETA*NMAXPHI)
+	&& getBytes(p, end, &D[0][0], 2*NMAXETA);
+    if(!ok || NETA<1 || NETA>NMAXETA || NPHI<1 || NPHI>NMAXPHI) return false;
+    sortedEdges = std::is_sorted(BETA, BETA+NETA+1);
+    return RR.read(p, end);
+}
+
+double RocOne::kScale(int T, int Q, double pt, int H, int F) const{
+    double m=M[T][H][F];
+    double a=A[T][H][F];
+    double d=D[T][H];
+    double k=d/(m+Q*a*pt);
+    return k;
+}
+
 double RocOne::kScaleDT(int Q, double pt, double eta, double phi) const{
     int H=getBin(eta, NETA, BETA);
     int F=getBin(phi, NPHI, MPHI, DPHI);
-    double m=M[DT][H][F];
-    double a=A[DT][H][F];
-    double d=D[DT][H];
-
-    double k=d/(m+Q*a*pt);
-    return k;
+    return kScale(DT, Q, pt, H, F);
 }
 
 
 double RocOne::kScaleMC(int Q, double pt, double eta, double phi, double kSMR) const{
     int H=getBin(eta, NETA, BETA);
     int F=getBin(phi, NPHI, MPHI, DPHI);
-    double m=M[MC][H][F];
-    double a=A[MC][H][F];
-    double d=D[MC][H];
-    double k=d/(m+Q*a*pt);
+    double k=kScale(MC, Q, pt, H, F);
     return k*kSMR;
 }
 
@@ -323,6 +505,48 @@ double RocOne::kGenSmear(double pt, double eta, double v, double u, RocRes::TYPE
     return RR.kSmear(pt, eta, TT, v, u);
 }
 
+// H and F of the scale, R of the resolution, for every muon
+void RocOne::getBins(const std::vector<RocMuon>& muons, std::vector<int>& H, std::vector<int>& F, std::vector<int>& R) const{
+    H.resize(muons.size());
+    F.resize(muons.size());
+    R.resize(muons.size());
+    for(unsigned int i=0; i<muons.size(); ++i){
+	H[i]=getBin(muons[i].eta, NETA, BETA);
+	F[i]=getBin(muons[i].phi, NPHI, MPHI, DPHI);
+	R[i]=RR.getEtaBin(fabs(muons[i].eta));
+    }
+}
+
+void RocOne::kScaleDT(const std::vector<RocMuon>& muons, std::vector<double>& k) const{
+    std::vector<int> H, F, R;
+    getBins(muons, H, F, R);
+    k.resize(muons.size());
+    for(unsigned int i=0; i<muons.size(); ++i) k[i]=kScale(DT, muons[i].Q, muons[i].pt, H[i], F[i]);
+}
+
+void RocOne::kScaleAndSmearMC(const std::vector<RocMuon>& muons, std::vector<double>& k, TRandom* rnd) const{
+    std::vector<int> H, F, R;
+    getBins(muons, H, F, R);
+    k.resize(muons.size());
+    for(unsigned int i=0; i<muons.size(); ++i){
+	double u = rnd ? rnd->Rndm() : muons[i].u;
+	double w = rnd ? rnd->Rndm() : muons[i].w;
+	double kS=kScale(MC, muons[i].Q, muons[i].pt, H[i], F[i]);
+	k[i]=kS*RR.kExtraBin(kS*muons[i].pt, R[i], muons[i].n, u, w);
+    }
+}
+
+void RocOne::kScaleFromGenMC(const std::vector<RocMuon>& muons, std::vector<double>& k, TRandom* rnd) const{
+    std::vector<int> H, F, R;
+    getBins(muons, H, F, R);
+    k.resize(muons.size());
+    for(unsigned int i=0; i<muons.size(); ++i){
+	double w = rnd ? rnd->Rndm() : muons[i].w;
+	double kS=kScale(MC, muons[i].Q, muons[i].pt, H[i], F[i]);
+	k[i]=kS*RR.kSpreadBin(muons[i].gt, kS*muons[i].pt, R[i], muons[i].n, w);
+    }
+}
+
 
 //-------------------------------------
 
@@ -366,6 +590,102 @@ RoccoR::init(std::string dirname){
 
 RoccoR::~RoccoR(){}
 
+RoccoR::RoccoR(std::string dirname, std::string cachename){
+    init(dirname, cachename);
+}
+
+void RoccoR::init(std::string dirname, std::string cachename){
+    uint64_t checksum=textChecksum(dirname);
+    if(readCache(cachename, checksum)) return;
+    init(dirname);
+    if(!writeCache(cachename, checksum)) cout << "RoccoR: could not write the cache " << cachename << std::endl;
+}
+
+// Checksum of config.txt and of the files init reads for it, in the same order
+uint64_t RoccoR::textChecksum(std::string dirname){
+    uint64_t sum=CHECKSUMSTART;
+    std::string filename=Form("%s/config.txt", dirname.c_str());
+    std::ifstream in(filename.c_str());
+    std::string s;
+    std::string tag;
+    int si;
+    int sn;
+    while(std::getline(in, s)){
+	sum=addChecksum(sum, s+"\n");
+	std::stringstream ss(s); 
+	ss >> tag >> si >> sn; 
+	for(int m=0; m<sn; ++m){
+	    std::string inputfile=Form("%s/%d.%d.txt", dirname.c_str(), si, m);
+	    if(gSystem->AccessPathName(inputfile.c_str())) inputfile=Form("%s/%d.%d.txt", dirname.c_str(),0,0);
+	    std::ifstream input(inputfile.c_str());
+	    std::stringstream content;
+	    content << input.rdbuf();
+	    sum=addChecksum(sum, inputfile.substr(dirname.size())+"\n");
+	    sum=addChecksum(sum, content.str());
+	}
+    }
+    return sum;
+}
+
+// The magic, the checksum of the text files, the checksum of the payload, and the payload:
+// the number of sets, and for each the number of members and their parameters
+bool RoccoR::writeCache(std::string cachename, uint64_t checksum) const{
+    std::string payload;
+    uint32_t nset=RC.size();
+    putBytes(payload, &nset, 1);
+    for(unsigned int s=0; s<RC.size(); ++s){
+	uint32_t nmem=RC[s].size();
+	putBytes(payload, &nmem, 1);
+	for(unsigned int m=0; m<RC[s].size(); ++m) RC[s][m].write(payload);
+    }
+
+    std::string buf(CACHEMAGIC, sizeof(CACHEMAGIC));
+    uint64_t payloadsum=addChecksum(CHECKSUMSTART, payload);
+    putBytes(buf, &checksum, 1);
+    putBytes(buf, &payloadsum, 1);
+    std::ofstream out(cachename.c_str(), std::ios::binary);
+    out.write(buf.data(), buf.size());
+    out.write(payload.data(), payload.size());
+    return out.good();
+}
+
+// The whole file in one read, then the parameters copied out of it
+bool RoccoR::readCache(std::string cachename, uint64_t checksum){
+    std::ifstream in(cachename.c_str(), std::ios::binary | std::ios::ate);
+    if(!in) return false;
+    std::string buf(in.tellg(), '\0');
+    in.seekg(0);
+    if(!in.read(&buf[0], buf.size())) return false;
+
+    const char* p=buf.data();
+    const char* end=p+buf.size();
+    char magic[sizeof(CACHEMAGIC)];
+    uint64_t sum;
+    uint64_t payloadsum;
+    uint32_t nset;
+    if(!getBytes(p, end, magic, sizeof(CACHEMAGIC)) || memcmp(magic, CACHEMAGIC, sizeof(CACHEMAGIC))) return false;
+    if(!getBytes(p, end, &sum, 1) || (checksum!=0 && sum!=checksum)) return false;
+    if(!getBytes(p, end, &payloadsum, 1) || addChecksum(CHECKSUMSTART, p, end-p)!=payloadsum) return false;
+    if(!getBytes(p, end, &nset, 1)) return false;
+
+    // no more sets and members than the bytes left can hold, before anything is allocated
+    std::string smallest;
+    RocOne().write(smallest);
+    if(nset>size_t(end-p)/sizeof(uint32_t)) return false;
+
+    std::vector<std::vector<RocOne> > rc;
+    for(unsigned int s=0; s<nset; ++s){
+	uint32_t nmem;
+	if(!getBytes(p, end, &nmem, 1) || nmem>size_t(end-p)/smallest.size()) return false;
+	std::vector<RocOne> v(nmem);
+	for(unsigned int m=0; m<nmem; ++m) if(!v[m].read(p, end)) return false;
+	rc.push_back(v);
+    }
+    if(p!=end) return false;
+    RC.swap(rc);
+    return true;
+}
+
 
 
 double RoccoR::kGenSmear(double pt, double eta, double v, double u, RocRes::TYPE TT, int s, int m) const{
@@ -384,6 +704,38 @@ double RoccoR::kScaleFromGenMC(int Q, double pt, double eta, double phi, int n,
     return RC[s][m].kScaleFromGenMC(Q, pt, eta, phi, n, gt, w);
 }
 
+void RoccoR::kScaleDT(const std::vector<RocMuon>& muons, std::vector<double>& k, int s, int m) const{
+    RC[s][m].kScaleDT(muons, k);
+}
+
+void RoccoR::kScaleAndSmearMC(const std::vector<RocMuon>& muons, std::vector<double>& k, int s, int m, TRandom* rnd) const{
+    RC[s][m].kScaleAndSmearMC(muons, k, rnd);
+}
+
+void RoccoR::kScaleFromGenMC(const std::vector<RocMuon>& muons, std::vector<double>& k, int s, int m, TRandom* rnd) const{
+    RC[s][m].kScaleFromGenMC(muons, k, rnd);
+}
+
+void RoccoR::setInvcdfTolerance(double tol){
+    for(unsigned int s=0; s<RC.size(); ++s){
+	for(unsigned int m=0; m<RC[s].size(); ++m) RC[s][m].getR().setInvcdfTolerance(tol);
+    }
+}
+
+double RoccoR::validateInvcdf(int nSample) const{
+    double dev=0;
+    for(unsigned int s=0; s<RC.size(); ++s){
+	double devSet=0;
+	for(unsigned int m=0; m<RC[s].size(); ++m){
+	    double e=RC[s][m].getR().validateInvcdf(nSample);
+	    if(e>devSet || e!=e) devSet=e;
+	}
+	cout << Form("RoccoR: set %d, largest |invcdf - exact| %g", s, devSet) << std::endl;
+	if(devSet>dev || devSet!=devSet) dev=devSet;
+    }
+    return dev;
+}
+
 
 #endif
 
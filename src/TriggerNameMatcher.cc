@@ -0,0 +1,111 @@
+#include "UserCode/IIHETree/interface/TriggerNameMatcher.h"
+
+#include <queue>
+
+TriggerNameMatcher::TriggerNameMatcher(const std::vector<std::string>& patterns){
+  patterns_ = patterns ;
+  newNode() ;
+
+  // Build the trie.  Empty patterns and characters outside ASCII never match, as in
+  // nSubstringInString (the latter because trigger names are plain ASCII).
+  for(unsigned int p=0 ; p<patterns_.size() ; ++p){
+    const std::string& pattern = patterns_.at(p) ;
+    indices_.insert(std::make_pair(pattern, (int) p)) ;
+    if(pattern.empty()) continue ;
+    int node = 0 ;
+    bool ascii = true ;
+    for(unsigned int i=0 ; i<pattern.size() ; ++i){
+      unsigned char c = pattern.at(i) ;
+      if(c>=128){ ascii = false ; break ; }
+      if(nodes_.at(node).next[c]<0){
+        int child = newNode() ;
+        nodes_.at(node).next[c] = child ;
+      }
+      node = nodes_.at(node).next[c] ;
+    }
+    if(ascii) nodes_.at(node).outputs.push_back(p) ;
+  }
+
+  // Breadth first: fill in the missing transitions from the failure links, and add the
+  // outputs of each node's longest proper suffix to its own
+  std::vector<int> fail(nodes_.size(), 0) ;
+  std::queue<int> queue ;
+  for(int c=0 ; c<128 ; ++c){
+    int child = nodes_.at(0).next[c] ;
+    if(child<0){
+      nodes_.at(0).next[c] = 0 ;
+    }
+    else{
+      fail.at(child) = 0 ;
+      queue.push(child) ;
+    }
+  }
+  while(!queue.empty()){
+    int node = queue.front() ;
+    queue.pop() ;
+    const std::vector<int>& inherited = nodes_.at(fail.at(node)).outputs ;
+    nodes_.at(node).outputs.insert(nodes_.at(node).outputs.end(), inherited.begin(), inherited.end()) ;
+    for(int c=0 ; c<128 ; ++c){
+      int child = nodes_.at(node).next[c] ;
+      if(child<0){
+        nodes_.at(node).next[c] = nodes_.at(fail.at(node)).next[c] ;
+      }
+      else{
+        fail.at(child) = nodes_.at(fail.at(node)).next[c] ;
+        queue.push(child) ;
+      }
+    }
+  }
+}
+
+int TriggerNameMatcher::newNode(){
+  Node node ;
+  for(int c=0 ; c<128 ; ++c) node.next[c] = -1 ;
+  nodes_.push_back(node) ;
+  return nodes_.size()-1 ;
+}
+
+void TriggerNameMatcher::count(const std::string& name, std::vector<int>& counts) const {
+  counts.assign(patterns_.size(), 0) ;
+  if(nodes_.empty()) return ;
+  // Occurrences of one pattern are reported in order, so keeping the end of the last one
+  // counted is enough to skip those that overlap it
+  std::vector<unsigned int> nextStart(patterns_.size(), 0) ;
+  int node = 0 ;
+  for(unsigned int i=0 ; i<name.size() ; ++i){
+    unsigned char c = name.at(i) ;
+    if(c>=128){
+      node = 0 ;
+      continue ;
+    }
+    node = nodes_.at(node).next[c] ;
+    const std::vector<int>& outputs = nodes_.at(node).outputs ;
+    for(unsigned int j=0 ; j<outputs.size() ; ++j){
+      int p = outputs.at(j) ;
+      unsigned int start = i+1-patterns_.at(p).size() ;
+      if(start<nextStart.at(p)) continue ;
+      counts.at(p)++ ;
+      nextStart.at(p) = i+1 ;
+    }
+  }
+}
+
+bool TriggerNameMatcher::matchesAny(const std::string& name) const {
+  if(nodes_.empty()) return false ;
+  int node = 0 ;
+  for(unsigned int i=0 ; i<name.size() ; ++i){
+    unsigned char c = name.at(i) ;
+    if(c>=128){
+      node = 0 ;
+      continue ;
+    }
+    node = nodes_.at(node).next[c] ;
+    if(!nodes_.at(node).outputs.empty()) return true ;
+  }
+  return false ;
+}
+
+int TriggerNameMatcher::index(const std::string& pattern) const {
+  std::unordered_map<std::string, int>::const_iterator it = indices_.find(pattern) ;
+  return (it==indices_.end()) ? -1 : it->second ;
+}
@@ -1,8 +1,11 @@
 #include "UserCode/IIHETree/interface/TriggerObject.h"
+#include "UserCode/IIHETree/interface/TriggerNameMatcher.h"
 
 TriggerFilter::TriggerFilter(std::string name, std::string triggerName){
     name_ = name ;
     triggerName_ = triggerName ;
+    index_ = -1 ;
+    slot_ = -1 ;
     etaBranchName_ = "trig_" + triggerName_.substr(0, triggerName_.find("_v")) + "_" + name_ + "_eta" ;
     phiBranchName_ = "trig_" + triggerName_.substr(0, triggerName_.find("_v")) + "_" + name_ + "_phi" ;
 }
@@ -99,15 +102,30 @@ bool L1Trigger::matchObject(edm::Handle<trigger::TriggerEvent> trigEvent, float
   return false ;
 }
 
-HLTrigger::HLTrigger(std::string name, HLTConfigProvider hltConfig){
+// Every substring the classification of HLT paths looks for.  They are all counted in
+// one pass over the name when the trigger is made, instead of one search per substring.
+static const TriggerNameMatcher& nameClassifier(){
+  static const TriggerNameMatcher matcher(std::vector<std::string>{
+    "_SC", "Photon", "DoublePhoton", "TriplePhoton", "Ele", "DoubleEle", "DiEle",
+    "TripleEle", "Mu", "muon", "Multi", "DoubleMu", "DiMu", "Dimuon", "DoubleIsoMu",
+    "TripleMu", "Tau", "NoJetId", "Jet", "DiJet", "DiPFJet", "DoubleJet", "DiCentralJet",
+    "DiCentralPFJet", "TriCentralPFJet", "QuadJet", "QuadPFJet", "SixJet", "SixPFJet",
+    "EightJet", "EightPFJet", "BJet", "DiBJet", "DiCentral", "TriiBJet", "TriCentral",
+    "MET", "HT", "ALCa"
+  }) ;
+  return matcher ;
+}
+HLTrigger::HLTrigger(std::string name, HLTConfigProvider const& hltConfig){
   name_ = name ;
   index_ = -1 ;
+  bit_ = -1 ;
   savePrescale_= 0;
   saveFilters_ = 0;
   searchStatus_ = notSearchedFor ;
   reset() ;
-  acceptBranchName_   = "trig_" + name.substr(0, name.find("_v")) + "_accept"   ;
-  prescaleBranchName_ = "trig_" + name.substr(0, name.find("_v")) + "_prescale" ;
+  acceptBranchName_   = "trig_" + baseName() + "_accept"   ;
+  prescaleBranchName_ = "trig_" + baseName() + "_prescale" ;
+  nameClassifier().count(name_, patternCounts_) ;
   nSC_     = nSuperclustersInTriggerName() ;
   nPh_     = nPhotonsInTriggerName() ;
   nEl_     = nElectronsInTriggerName() ;
@@ -152,64 +170,70 @@ void HLTrigger::reset(){
   prescale_ = -999 ;
 }
 
+int HLTrigger::nPatternInName(const std::string& pattern){
+  int index = nameClassifier().index(pattern) ;
+  if(index<0) return nSubstringInString(name_, pattern) ;
+  return patternCounts_.at(index) ;
+}
+
 int HLTrigger::nSuperclustersInTriggerName(){
-  int scCount = nSubstringInString(name_, "_SC") ;
+  int scCount = nPatternInName("_SC") ;
   return scCount ;
 }
 int HLTrigger::nPhotonsInTriggerName(){
-  int singlePhotonCount = nSubstringInString(name_, "Photon"      ) ;
-  int doublePhotonCount = nSubstringInString(name_, "DoublePhoton") ;
-  int triplePhotonCount = nSubstringInString(name_, "TriplePhoton") ;
+  int singlePhotonCount = nPatternInName("Photon"      ) ;
+  int doublePhotonCount = nPatternInName("DoublePhoton") ;
+  int triplePhotonCount = nPatternInName("TriplePhoton") ;
   int totalPhotonCount = 2*triplePhotonCount + 1*doublePhotonCount + singlePhotonCount ;
   return totalPhotonCount ;
 }
 int HLTrigger::nElectronsInTriggerName(){
-  int singleElectronCount = nSubstringInString(name_, "Ele"      ) ;
-  int doubleElectronCount = nSubstringInString(name_, "DoubleEle") + nSubstringInString(name_, "DiEle") ;
-  int tripleElectronCount = nSubstringInString(name_, "TripleEle") ;
+  int singleElectronCount = nPatternInName("Ele"      ) ;
+  int doubleElectronCount = nPatternInName("DoubleEle") + nPatternInName("DiEle") ;
+  int tripleElectronCount = nPatternInName("TripleEle") ;
   int totalElectronCount = 2*tripleElectronCount + 1*doubleElectronCount + singleElectronCount ;
   return totalElectronCount ;
 }
 
 int HLTrigger::nMuonsInTriggerName(){
-  int singleMuonCount = nSubstringInString(name_, "Mu"      ) + nSubstringInString(name_, "muon") - nSubstringInString(name_, "Multi");
-  int doubleMuonCount = nSubstringInString(name_, "DoubleMu") + nSubstringInString(name_, "DiMu") + nSubstringInString(name_, "Dimuon")+ nSubstringInString(name_, "DoubleIsoMu") ;
-  int tripleMuonCount = nSubstringInString(name_, "TripleMu") ;
+  int singleMuonCount = nPatternInName("Mu"      ) + nPatternInName("muon") - nPatternInName("Multi");
+  int doubleMuonCount = nPatternInName("DoubleMu") + nPatternInName("DiMu") + nPatternInName("Dimuon")+ nPatternInName("DoubleIsoMu") ;
+  int tripleMuonCount = nPatternInName("TripleMu") ;
   int totalMuonCount = 2*tripleMuonCount + 1*doubleMuonCount + singleMuonCount ;
   return totalMuonCount ;
 }
 int HLTrigger::nTausInTriggerName(){
-  int tauCount = nSubstringInString(name_, "Tau") ;
+  int tauCount = nPatternInName("Tau") ;
   return tauCount ;
 }
 int HLTrigger::nJetsInTriggerName(){
-  int ignoreJetCount = nSubstringInString(name_, "NoJetId"  ) ;
-  int singleJetCount = nSubstringInString(name_, "Jet"  ) ;
-  int doubleJetCount = nSubstringInString(name_, "DiJet") + nSubstringInString(name_, "DiPFJet") + nSubstringInString(name_, "DoubleJet") + nSubstringInString(name_, "DiCentralJet") + nSubstringInString(name_, "DiCentralPFJet") ;
-  int tripleJetCount = nSubstringInString(name_, "TriCentralPFJet" ) ;
-  int quadJetCount  = nSubstringInString(name_, "QuadJet" ) + nSubstringInString(name_, "QuadPFJet" ) ;
-  int sixJetCount   = nSubstringInString(name_, "SixJet"  ) + nSubstringInString(name_, "SixPFJet"  ) ;
-  int eightJetCount = nSubstringInString(name_, "EightJet") + nSubstringInString(name_, "EightPFJet") ;
+  int ignoreJetCount = nPatternInName("NoJetId"  ) ;
+  int singleJetCount = nPatternInName("Jet"  ) ;
+  int doubleJetCount = nPatternInName("DiJet") + nPatternInName("DiPFJet") + nPatternInName("DoubleJet") + nPatternInName("DiCentralJet") + nPatternInName("DiCentralPFJet") ;
+  int tripleJetCount = nPatternInName("TriCentralPFJet" ) ;
+  int quadJetCount  = nPatternInName("QuadJet" ) + nPatternInName("QuadPFJet" ) ;
+  int sixJetCount   = nPatternInName("SixJet"  ) + nPatternInName("SixPFJet"  ) ;
+  int eightJetCount = nPatternInName("EightJet") + nPatternInName("EightPFJet") ;
   int totalJetCount = 7*eightJetCount + 5*sixJetCount + 3*quadJetCount + 2*tripleJetCount + 1*doubleJetCount + singleJetCount - 1*ignoreJetCount ;
   return totalJetCount ;
 }
 int HLTrigger::nBJetsInTriggerName(){
-  int singleBJetCount = nSubstringInString(name_, "BJet"  ) ;
-  int doubleBJetCount = nSubstringInString(name_, "DiBJet"  ) + nSubstringInString(name_,  "DiCentral") ;
-  int tripleBJetCount = nSubstringInString(name_, "TriiBJet") + nSubstringInString(name_, "TriCentral") ;
+  int singleBJetCount = nPatternInName("BJet"  ) ;
+  int doubleBJetCount = nPatternInName("DiBJet"  ) + nPatternInName(  "DiCentral") ;
+  int tripleBJetCount = nPatternInName("TriiBJet") + nPatternInName("TriCentral") ;
   int totalBJetCount = 2*tripleBJetCount + 1*doubleBJetCount + singleBJetCount ;
   return totalBJetCount ;
 }
 int HLTrigger::METInTriggerName(){
-  int METCount = nSubstringInString(name_, "MET") ;
+  int METCount = nPatternInName("MET") ;
   return METCount ;
 }
 int HLTrigger::HTInTriggerName(){
-  int HTCount = nSubstringInString(name_, "HT") ;
+  int HTCount = nPatternInName("HT") ;
   return HTCount ;
 }
 int HLTrigger::ALCaInTriggerName(){
-  int ALCaCount = nSubstringInString(name_, "ALCa") ;
+  int ALCaCount = nPatternInName("ALCa") ;
   return ALCaCount ;
 }
 int HLTrigger::nSubstringInString(const std::string& str, const std::string& sub){
@@ -221,15 +245,18 @@ int HLTrigger::nSubstringInString(const std::string& str, const std::string& sub
   return count;
 }
 
-int HLTrigger::fullStatus(const edm::Event& iEvent, const edm::EventSetup & iSetup, const HLTConfigProvider & hltConfig,int  Prescale, const Handle<TriggerResults> & triggerResults, edm::Handle<trigger::TriggerEvent> trigEvent, edm::InputTag trigEventTag, IIHEAnalysis* analysis){  
+int HLTrigger::fullStatus(int Prescale, const Handle<TriggerResults> & triggerResults, edm::Handle<trigger::TriggerEvent> trigEvent, std::vector<int> const& filterIndices, IIHEAnalysis* analysis){
+  // Everything here is looked up by index: the path index and prescales are resolved in
+  // beginRun, and filterIndices maps each filter slot to its index in this event.
   if(searchStatus_==searchedForAndFound && index_>=0){
     touched_  = true ;
     accept_   = triggerResults->accept(index_) ;
-    prescale_ = hltConfig.prescaleValue(Prescale, name_);
+    // Same as HLTConfigProvider::prescaleValue, which gives 1 for an unknown set
+    prescale_ = (Prescale>=0 && Prescale<(int)prescales_.size()) ? prescales_.at(Prescale) : 1 ;
     if (saveFilters_){
       for(unsigned i=0 ; i<filters_.size() ; ++i){
         TriggerFilter* filter = filters_.at(i) ;
-        filter->setIndex(trigEvent, trigEventTag) ;
+        filter->setIndex(filterIndices.at(filter->slot())) ;
         filter->setValues(trigEvent, analysis) ;
       }
     }
@@ -250,6 +277,9 @@ void HLTrigger::store(IIHEAnalysis* analysis){
   if (savePrescale_){
   analysis->store(prescaleBranchName_, prescale_) ;
   }
+  storeFilters(analysis) ;
+}
+void HLTrigger::storeFilters(IIHEAnalysis* analysis){
   if  (saveFilters_){
     for(unsigned i=0 ; i<filters_.size() ; ++i){
       filters_.at(i)->store(analysis);
@@ -263,6 +293,11 @@ int HLTrigger::createBranches(IIHEAnalysis* analysis){
   if (savePrescale_){
     result += analysis->addBranch(prescaleBranchName_, kInt) ;
   }
+  result += createFilterBranches(analysis) ;
+  return result ;
+}
+int HLTrigger::createFilterBranches(IIHEAnalysis* analysis){
+  int result = 0 ;
   if (saveFilters_){ 
     for(unsigned i=0 ; i<filters_.size() ; ++i){
       result += filters_.at(i)->createBranches(analysis) ;
@@ -273,17 +308,19 @@ int HLTrigger::createBranches(IIHEAnalysis* analysis){
 
 bool HLTrigger::beginRun(HLTConfigProvider const& hltConfig){
   bool success = findIndex(hltConfig) ;
+  prescales_.clear() ;
+  for(unsigned int set=0 ; set<hltConfig.prescaleSize() ; ++set){
+    prescales_.push_back(hltConfig.prescaleValue(set, name_)) ;
+  }
   return success ;
 }
 int HLTrigger::findIndex(HLTConfigProvider const& hltConfig){
   searchStatus_ = notSearchedFor ;
-  std::vector<std::string> names = hltConfig.triggerNames() ;
-  for(unsigned int i=0 ; i<names.size() ; ++i){
-    if(names.at(i)==name_){
-      index_ = i ;
-      searchStatus_ = searchedForAndFound ;
-      return 0 ;
-    }
+  unsigned int index = hltConfig.triggerIndex(name_) ;
+  if(index<hltConfig.size()){
+    index_ = index ;
+    searchStatus_ = searchedForAndFound ;
+    return 0 ;
   }
   index_ = -1 ;
   searchStatus_ = searchedForAndNotFound ;
@@ -1,5 +1,6 @@
 #include "UserCode/IIHETree/interface/btag_weighter.h"
 
+#include <algorithm>
 #include <cmath>
 #include<fstream>
 #include<sstream>
@@ -17,16 +18,43 @@ namespace{
     std::unique_ptr<T> MakeUnique(Args&&... args){
     return std::unique_ptr<T>(new T(std::forward<Args>(args)...));
   }
+
+  // Inputs of the weighter, also what a BTagCache is made from
+  struct CalibrationSource{
+    const char *tagger;
+    const char *file;
+  };
+  const CalibrationSource calib_full_src{"csvv2", "data/CSVv2_Moriond17_B_H.csv"};
+  const CalibrationSource calib_full_bf_src{"csvv2", "data/CSVv2_Moriond17_B_F.csv"};
+  const CalibrationSource calib_full_gh_src{"csvv2", "data/CSVv2_Moriond17_G_H.csv"};
+  const CalibrationSource calib_full_b_src{"csvv2", "data/RunB.csv"};
+  const CalibrationSource calib_full_cd_src{"csvv2", "data/RunCD.csv"};
+  const CalibrationSource calib_full_ef_src{"csvv2", "data/RunEF.csv"};
+  const CalibrationSource calib_fast_src{"csvv2_deep", "data/fastsim_csvv2_ttbar_26_1_2017.csv"};
+  const CalibrationSource calib_deep_full_src{"csvv2_deep", "data/DeepCSV_Moriond17_B_H.csv"};
+  const CalibrationSource calib_deep_full_bf_src{"csvv2_deep", "data/DeepCSV_Moriond17_B_F.csv"};
+  const CalibrationSource calib_deep_full_gh_src{"csvv2_deep", "data/DeepCSV_Moriond17_G_H.csv"};
+  const CalibrationSource calib_deep_fast_src{"csvv2_deep", "data/fastsim_deepcsv_ttbar_26_1_2017.csv"};
+  const vector<CalibrationSource> calibration_sources{calib_full_src, calib_full_bf_src, calib_full_gh_src,
+      calib_full_b_src, calib_full_cd_src, calib_full_ef_src, calib_fast_src, calib_deep_full_src,
+      calib_deep_full_bf_src, calib_deep_full_gh_src, calib_deep_fast_src};
+
+  const string eff_file = "data/btagEfficiency.root";
+  const string eff_deep_file = "data/btagEfficiency_deep.root";
+  string EffProcFile(const string &proc){ return "data/btagEfficiency_"+proc+".root"; }
+  string EffDeepProcFile(const string &proc){ return "data/btagEfficiency_deep_"+proc+".root"; }
 }
 
-BTagWeighter::BTagWeighter(string proc, bool is_fast_sim, bool is_cmssw_7):
-  calib_full_(new BTagCalibration("csvv2", "data/CSVv2_Moriond17_B_H.csv")),
-  calib_full_bf_(new BTagCalibration("csvv2", "data/CSVv2_Moriond17_B_F.csv")),
-  calib_full_gh_(new BTagCalibration("csvv2", "data/CSVv2_Moriond17_G_H.csv")),
-  calib_full_b_(new BTagCalibration("csvv2", "data/RunB.csv")),
-  calib_full_cd_(new BTagCalibration("csvv2", "data/RunCD.csv")),
-  calib_full_ef_(new BTagCalibration("csvv2", "data/RunEF.csv")),
-  calib_fast_(new BTagCalibration("csvv2_deep", "data/fastsim_csvv2_ttbar_26_1_2017.csv")),
+BTagWeighter::BTagWeighter(string proc, bool is_fast_sim, bool is_cmssw_7, double table_tolerance,
+			   const string &cache_file):
+  cache_(OpenCache(proc, cache_file)),
+  calib_full_(LoadCalibration(calib_full_src.tagger, calib_full_src.file)),
+  calib_full_bf_(LoadCalibration(calib_full_bf_src.tagger, calib_full_bf_src.file)),
+  calib_full_gh_(LoadCalibration(calib_full_gh_src.tagger, calib_full_gh_src.file)),
+  calib_full_b_(LoadCalibration(calib_full_b_src.tagger, calib_full_b_src.file)),
+  calib_full_cd_(LoadCalibration(calib_full_cd_src.tagger, calib_full_cd_src.file)),
+  calib_full_ef_(LoadCalibration(calib_full_ef_src.tagger, calib_full_ef_src.file)),
+  calib_fast_(LoadCalibration(calib_fast_src.tagger, calib_fast_src.file)),
   readers_full_(),
   readers_full_bf_(),
   readers_full_gh_(),
@@ -34,18 +62,14 @@ BTagWeighter::BTagWeighter(string proc, bool is_fast_sim, bool is_cmssw_7):
   readers_full_cd_(),
   readers_full_ef_(),
   readers_fast_(),
-  btag_efficiencies_(op_pts_.size()),
-  btag_efficiencies_proc_(op_pts_.size()),
-  calib_deep_full_(new BTagCalibration("csvv2_deep", "data/DeepCSV_Moriond17_B_H.csv")),
-  calib_deep_full_bf_(new BTagCalibration("csvv2_deep", "data/DeepCSV_Moriond17_B_F.csv")),
-  calib_deep_full_gh_(new BTagCalibration("csvv2_deep", "data/DeepCSV_Moriond17_G_H.csv")),
-  calib_deep_fast_(new BTagCalibration("csvv2_deep", "data/fastsim_deepcsv_ttbar_26_1_2017.csv")),
+  calib_deep_full_(LoadCalibration(calib_deep_full_src.tagger, calib_deep_full_src.file)),
+  calib_deep_full_bf_(LoadCalibration(calib_deep_full_bf_src.tagger, calib_deep_full_bf_src.file)),
+  calib_deep_full_gh_(LoadCalibration(calib_deep_full_gh_src.tagger, calib_deep_full_gh_src.file)),
+  calib_deep_fast_(LoadCalibration(calib_deep_fast_src.tagger, calib_deep_fast_src.file)),
   readers_deep_full_(),
   readers_deep_full_bf_(),
   readers_deep_full_gh_(),
   readers_deep_fast_(),
-  btag_efficiencies_deep_(op_pts_.size()),
-  btag_efficiencies_deep_proc_(op_pts_.size()),
   csv_loose_(is_cmssw_7 ? 0.605 : 0.5426),
   csv_medium_(is_cmssw_7 ? 0.890 : 0.8484),
   csv_tight_(is_cmssw_7 ? 0.970 : 0.9535),
@@ -56,100 +80,190 @@ BTagWeighter::BTagWeighter(string proc, bool is_fast_sim, bool is_cmssw_7):
   if(proc != "tt" && proc != "qcd" && proc != "wjets"){
     ERROR("Process "+proc+" not found. Valid processes are tt, qcd, and wjets.");
   }
-  TFile file_eff("data/btagEfficiency.root", "read");
-  TFile file_deep("data/btagEfficiency_deep.root", "read");
-  TFile file_proc(("data/btagEfficiency_"+proc+".root").c_str(), "read");
-  TFile file_deep_proc(("data/btagEfficiency_deep_"+proc+".root").c_str(), "read");
+  if(!(table_tolerance >= 0.)){
+    ERROR("BTagWeighter: the scale factor table tolerance must not be negative.");
+  }
+  auto make_reader = [table_tolerance](BTagEntry::OperatingPoint op){
+    auto reader = MakeUnique<BTagCalibrationReader>(op, "central", vector<string>{"up", "down"});
+    reader->set_table_tolerance(table_tolerance);
+    return reader;
+  };
+
+  // The efficiency files are only opened when there is no valid cache
+  unique_ptr<TFile> file_eff, file_deep, file_proc, file_deep_proc;
+  vector<TH3D> btag_efficiencies(op_pts_.size()), btag_efficiencies_proc(op_pts_.size());
+  vector<TH3D> btag_efficiencies_deep(op_pts_.size()), btag_efficiencies_deep_proc(op_pts_.size());
+  if(!cache_){
+    file_eff.reset(new TFile(eff_file.c_str(), "read"));
+    file_deep.reset(new TFile(eff_deep_file.c_str(), "read"));
+    file_proc.reset(new TFile(EffProcFile(proc).c_str(), "read"));
+    file_deep_proc.reset(new TFile(EffDeepProcFile(proc).c_str(), "read"));
+  }
 
   for(size_t i = 0; i < op_pts_.size(); ++i){
     const auto op = op_pts_.at(i);
     
-    readers_full_[op] = MakeUnique<BTagCalibrationReader>(op, "central", vector<string>{"up", "down"});
+    readers_full_[op] = make_reader(op);
     readers_full_.at(op)->load(*calib_full_, BTagEntry::FLAV_UDSG, "incl");
     readers_full_.at(op)->load(*calib_full_, BTagEntry::FLAV_C, "comb");
     readers_full_.at(op)->load(*calib_full_, BTagEntry::FLAV_B, "comb");
 
-    readers_full_bf_[op] = MakeUnique<BTagCalibrationReader>(op, "central", vector<string>{"up", "down"});
+    readers_full_bf_[op] = make_reader(op);
     readers_full_bf_.at(op)->load(*calib_full_bf_, BTagEntry::FLAV_UDSG, "incl");
     readers_full_bf_.at(op)->load(*calib_full_bf_, BTagEntry::FLAV_C, "comb");
     readers_full_bf_.at(op)->load(*calib_full_bf_, BTagEntry::FLAV_B, "comb");
 
-    readers_full_gh_[op] = MakeUnique<BTagCalibrationReader>(op, "central", vector<string>{"up", "down"});
+    readers_full_gh_[op] = make_reader(op);
     readers_full_gh_.at(op)->load(*calib_full_gh_, BTagEntry::FLAV_UDSG, "incl");
     readers_full_gh_.at(op)->load(*calib_full_gh_, BTagEntry::FLAV_C, "comb");
     readers_full_gh_.at(op)->load(*calib_full_gh_, BTagEntry::FLAV_B, "comb");
 
-    readers_full_b_[op] = MakeUnique<BTagCalibrationReader>(op, "central", vector<string>{"up", "down"});
+    readers_full_b_[op] = make_reader(op);
     readers_full_b_.at(op)->load(*calib_full_b_, BTagEntry::FLAV_UDSG, "incl");
     readers_full_b_.at(op)->load(*calib_full_b_, BTagEntry::FLAV_C, "comb");
     readers_full_b_.at(op)->load(*calib_full_b_, BTagEntry::FLAV_B, "comb");
 
-    readers_full_cd_[op] = MakeUnique<BTagCalibrationReader>(op, "central", vector<string>{"up", "down"});
+    readers_full_cd_[op] = make_reader(op);
     readers_full_cd_.at(op)->load(*calib_full_cd_, BTagEntry::FLAV_UDSG, "incl");
     readers_full_cd_.at(op)->load(*calib_full_cd_, BTagEntry::FLAV_C, "comb");
     readers_full_cd_.at(op)->load(*calib_full_cd_, BTagEntry::FLAV_B, "comb");
 
-    readers_full_ef_[op] = MakeUnique<BTagCalibrationReader>(op, "central", vector<string>{"up", "down"});
+    readers_full_ef_[op] = make_reader(op);
     readers_full_ef_.at(op)->load(*calib_full_ef_, BTagEntry::FLAV_UDSG, "incl");
     readers_full_ef_.at(op)->load(*calib_full_ef_, BTagEntry::FLAV_C, "comb");
     readers_full_ef_.at(op)->load(*calib_full_ef_, BTagEntry::FLAV_B, "comb");
 
-    readers_deep_full_[op] = MakeUnique<BTagCalibrationReader>(op, "central", vector<string>{"up", "down"});
+    readers_deep_full_[op] = make_reader(op);
     readers_deep_full_.at(op)->load(*calib_deep_full_, BTagEntry::FLAV_UDSG, "incl");
     readers_deep_full_.at(op)->load(*calib_deep_full_, BTagEntry::FLAV_C, "comb");
     readers_deep_full_.at(op)->load(*calib_deep_full_, BTagEntry::FLAV_B, "comb");
 
-    readers_deep_full_bf_[op] = MakeUnique<BTagCalibrationReader>(op, "central", vector<string>{"up", "down"});
+    readers_deep_full_bf_[op] = make_reader(op);
     readers_deep_full_bf_.at(op)->load(*calib_deep_full_bf_, BTagEntry::FLAV_UDSG, "incl");
     readers_deep_full_bf_.at(op)->load(*calib_deep_full_bf_, BTagEntry::FLAV_C, "comb");
     readers_deep_full_bf_.at(op)->load(*calib_deep_full_bf_, BTagEntry::FLAV_B, "comb");
 
-    readers_deep_full_gh_[op] = MakeUnique<BTagCalibrationReader>(op, "central", vector<string>{"up", "down"});
+    readers_deep_full_gh_[op] = make_reader(op);
     readers_deep_full_gh_.at(op)->load(*calib_deep_full_gh_, BTagEntry::FLAV_UDSG, "incl");
     readers_deep_full_gh_.at(op)->load(*calib_deep_full_gh_, BTagEntry::FLAV_C, "comb");
     readers_deep_full_gh_.at(op)->load(*calib_deep_full_gh_, BTagEntry::FLAV_B, "comb");
 
-    readers_fast_[op] = MakeUnique<BTagCalibrationReader>(op, "central", vector<string>{"up", "down"});
+    readers_fast_[op] = make_reader(op);
     readers_fast_.at(op)->load(*calib_fast_, BTagEntry::FLAV_UDSG, "fastsim");
     readers_fast_.at(op)->load(*calib_fast_, BTagEntry::FLAV_C, "fastsim");
     readers_fast_.at(op)->load(*calib_fast_, BTagEntry::FLAV_B, "fastsim");
 
-    readers_deep_fast_[op] = MakeUnique<BTagCalibrationReader>(op, "central", vector<string>{"up", "down"});
+    readers_deep_fast_[op] = make_reader(op);
     readers_deep_fast_.at(op)->load(*calib_deep_fast_, BTagEntry::FLAV_UDSG, "fastsim");
     readers_deep_fast_.at(op)->load(*calib_deep_fast_, BTagEntry::FLAV_C, "fastsim");
     readers_deep_fast_.at(op)->load(*calib_deep_fast_, BTagEntry::FLAV_B, "fastsim");
 
-    string hist_eff, hist_deep;
-    switch(op){
-    case BTagEntry::OP_LOOSE:
-      hist_eff = "btagEfficiency_loose";
-      hist_deep = "btagEfficiency_deep_loose";
-      break;
-    case BTagEntry::OP_MEDIUM:
-      hist_eff = "btagEfficiency_medium";
-      hist_deep = "btagEfficiency_deep_medium";
-      break;
-    case BTagEntry::OP_TIGHT:
-      hist_eff = "btagEfficiency_tight";
-      hist_deep = "btagEfficiency_deep_tight";
-      break;
-    case BTagEntry::OP_RESHAPING:
-      hist_eff = "btagEfficiency_reshaping";
-      hist_deep = "btagEfficiency_deep_reshaping";
-      break;
-    default:
-      hist_eff = "btagEfficiency";
-      hist_deep = "btagEfficiency";
-      break;
-    }
+    string hist_eff = EfficiencyHistName(op, false);
+    string hist_deep = EfficiencyHistName(op, true);
     
-    btag_efficiencies_.at(i) = *static_cast<const TH3D*>(file_eff.Get(hist_eff.c_str()));
-    btag_efficiencies_proc_.at(i) = *static_cast<const TH3D*>(file_proc.Get(hist_eff.c_str()));
-    btag_efficiencies_deep_.at(i) = *static_cast<const TH3D*>(file_deep.Get(hist_deep.c_str()));
-    btag_efficiencies_deep_proc_.at(i) = *static_cast<const TH3D*>(file_deep_proc.Get(hist_deep.c_str()));
+    btag_efficiencies.at(i) = LoadEfficiency(file_eff.get(), eff_file, hist_eff);
+    btag_efficiencies_proc.at(i) = LoadEfficiency(file_proc.get(), EffProcFile(proc), hist_eff);
+    btag_efficiencies_deep.at(i) = LoadEfficiency(file_deep.get(), eff_deep_file, hist_deep);
+    btag_efficiencies_deep_proc.at(i) = LoadEfficiency(file_deep_proc.get(), EffDeepProcFile(proc), hist_deep);
+  }
+  cache_.reset();
+
+  eff_table_ = BTagEfficiencyTable(btag_efficiencies);
+  eff_table_proc_ = BTagEfficiencyTable(btag_efficiencies_proc);
+  eff_table_deep_ = BTagEfficiencyTable(btag_efficiencies_deep);
+  eff_table_deep_proc_ = BTagEfficiencyTable(btag_efficiencies_deep_proc);
+
+  if(table_tolerance > 0.){
+    cout << "BTagWeighter: scale factors tabulated on first use with tolerance " << table_tolerance << endl;
   }
 }
 
+vector<string> BTagWeighter::SourceFiles(const string &proc){
+  vector<string> files;
+  for(const auto &src: calibration_sources) files.push_back(src.file);
+  files.push_back(eff_file);
+  files.push_back(eff_deep_file);
+  files.push_back(EffProcFile(proc));
+  files.push_back(EffDeepProcFile(proc));
+  return files;
+}
+
+void BTagWeighter::CompileCache(const string &proc, const string &cache_file){
+  BTagCache cache;
+  for(const auto &src: calibration_sources) cache.addCalibration(src.tagger, src.file);
+  for(const auto op: op_pts_){
+    cache.addEfficiency(eff_file, EfficiencyHistName(op, false));
+    cache.addEfficiency(EffProcFile(proc), EfficiencyHistName(op, false));
+    cache.addEfficiency(eff_deep_file, EfficiencyHistName(op, true));
+    cache.addEfficiency(EffDeepProcFile(proc), EfficiencyHistName(op, true));
+  }
+  cache.write(cache_file);
+  cout << "BTagWeighter: wrote cache " << cache_file << endl;
+}
+
+BTagCache* BTagWeighter::OpenCache(const string &proc, const string &cache_file){
+  if(cache_file.empty()) return nullptr;
+  unique_ptr<BTagCache> cache(new BTagCache());
+  if(!cache->read(cache_file)){
+    cout << "BTagWeighter: cannot read cache " << cache_file << ", reading the CSV and ROOT files" << endl;
+    return nullptr;
+  }
+  if(!cache->matches(SourceFiles(proc))){
+    cout << "BTagWeighter: cache " << cache_file << " does not match the input files, reading the CSV and ROOT files" << endl;
+    return nullptr;
+  }
+  return cache.release();
+}
+
+BTagCalibration* BTagWeighter::LoadCalibration(const string &tagger, const string &file) const{
+  if(cache_) return new BTagCalibration(cache_->calibration(file));
+  return new BTagCalibration(tagger, file);
+}
+
+TH3D BTagWeighter::LoadEfficiency(TFile *file, const string &file_name, const string &hist_name) const{
+  if(cache_) return cache_->efficiency(file_name, hist_name);
+  return *static_cast<const TH3D*>(file->Get(hist_name.c_str()));
+}
+
+string BTagWeighter::EfficiencyHistName(BTagEntry::OperatingPoint op, bool do_deep_csv){
+  string hist_eff, hist_deep;
+  switch(op){
+  case BTagEntry::OP_LOOSE:
+    hist_eff = "btagEfficiency_loose";
+    hist_deep = "btagEfficiency_deep_loose";
+    break;
+  case BTagEntry::OP_MEDIUM:
+    hist_eff = "btagEfficiency_medium";
+    hist_deep = "btagEfficiency_deep_medium";
+    break;
+  case BTagEntry::OP_TIGHT:
+    hist_eff = "btagEfficiency_tight";
+    hist_deep = "btagEfficiency_deep_tight";
+    break;
+  case BTagEntry::OP_RESHAPING:
+    hist_eff = "btagEfficiency_reshaping";
+    hist_deep = "btagEfficiency_deep_reshaping";
+    break;
+  default:
+    hist_eff = "btagEfficiency";
+    hist_deep = "btagEfficiency";
+    break;
+  }
+  return do_deep_csv ? hist_deep : hist_eff;
+}
+
+double BTagWeighter::MaxTableDeviation() const{
+  double deviation = 0.;
+  for(const auto *readers: {&readers_full_, &readers_full_bf_, &readers_full_gh_, &readers_full_b_,
+                            &readers_full_cd_, &readers_full_ef_, &readers_fast_, &readers_deep_full_,
+                            &readers_deep_full_bf_, &readers_deep_full_gh_, &readers_deep_fast_}){
+    for(const auto &reader: *readers){
+      deviation = max(deviation, reader.second->max_table_deviation());
+    }
+  }
+  return deviation;
+}
+
 double BTagWeighter::EventWeight(edm::View<pat::Jet> &b, BTagEntry::OperatingPoint op,
 				 const string &bc_full_syst, const string &udsg_full_syst,
 				 const string &bc_fast_syst, const string &udsg_fast_syst,
@@ -206,7 +320,7 @@ double BTagWeighter::EventWeight(edm::View<pat::Jet> &b, const vector<BTagEntry:
   return product;
 }
 
-double BTagWeighter::JetBTagWeight(pat::Jet b, BTagEntry::OperatingPoint op,
+double BTagWeighter::JetBTagWeight(const pat::Jet &b, BTagEntry::OperatingPoint op,
 				   const string &bc_full_syst, const string &udsg_full_syst,
 				   const string &bc_fast_syst, const string &udsg_fast_syst,
 				   bool do_deep_csv, bool do_by_proc, Runs runs) const{
@@ -216,7 +330,7 @@ double BTagWeighter::JetBTagWeight(pat::Jet b, BTagEntry::OperatingPoint op,
 		       do_deep_csv, do_by_proc, runs);
 }
 
-double BTagWeighter::JetBTagWeight(pat::Jet  b, BTagEntry::OperatingPoint op,
+double BTagWeighter::JetBTagWeight(const pat::Jet &b, BTagEntry::OperatingPoint op,
 				   const string &bc_full_syst, const string &udsg_full_syst,
 				   bool do_deep_csv, bool do_by_proc, Runs runs) const{
   return JetBTagWeight(b, vector<BTagEntry::OperatingPoint>{op},
@@ -225,7 +339,7 @@ double BTagWeighter::JetBTagWeight(pat::Jet  b, BTagEntry::OperatingPoint op,
 		       do_deep_csv, do_by_proc, runs);
 }
 
-double BTagWeighter::JetBTagWeight(pat::Jet b,const vector<BTagEntry::OperatingPoint> &ops,
+double BTagWeighter::JetBTagWeight(const pat::Jet &b, const vector<BTagEntry::OperatingPoint> &ops,
 				   const string &bc_full_syst, const string &udsg_full_syst,
 				   bool do_deep_csv, bool do_by_proc, Runs runs) const{
   return JetBTagWeight(b, ops,
@@ -234,7 +348,7 @@ double BTagWeighter::JetBTagWeight(pat::Jet b,const vector<BTagEntry::OperatingP
 		       do_deep_csv, do_by_proc, runs);
 }
 
-double BTagWeighter::JetBTagWeight(pat::Jet b, const vector<BTagEntry::OperatingPoint> &ops,
+double BTagWeighter::JetBTagWeight(const pat::Jet &b, const vector<BTagEntry::OperatingPoint> &ops,
 				   const string &bc_full_syst, const string &udsg_full_syst,
 				   const string &bc_fast_syst, const string &udsg_fast_syst,
 				   bool do_deep_csv, bool do_by_proc, Runs runs) const{
@@ -273,7 +387,133 @@ double BTagWeighter::JetBTagWeight(pat::Jet b, const vector<BTagEntry::Operating
   for (unsigned iop(0); iop<opcuts.size(); iop++) 
     if (csv>opcuts[iop]) tag = iop;
 
-  const map<BTagEntry::OperatingPoint, unique_ptr<BTagCalibrationReader> > *ireaders_full = nullptr;
+  const ReaderMap *ireaders_full = FullReaders(runs, do_deep_csv);
+  const ReaderMap *ireaders_fast = &readers_fast_;
+  if (do_deep_csv) ireaders_fast = &readers_deep_fast_;
+
+  double jet_pt = b.pt();
+  double jet_eta = b.eta();
+  double eff1(1), eff2(0), sf1(1), sf2(1), sf1_fs(1), sf2_fs(1);
+  if (tag >= 0){
+    BTagEntry::OperatingPoint iop = ops[tag];
+    eff1 = GetMCTagEfficiency(hadronFlavour, jet_pt, jet_eta, iop, do_deep_csv, do_by_proc);
+    sf1 = ireaders_full->at(iop)->eval_auto_bounds(full_syst, flav, jet_eta, jet_pt);
+    if (is_fast_sim_) sf1_fs = ireaders_fast->at(iop)->eval_auto_bounds(fast_syst, flav, jet_eta, jet_pt);
+  }
+  if (tag < int(ops.size())-1) {
+    BTagEntry::OperatingPoint iop = ops[tag+1];
+    eff2 = GetMCTagEfficiency(hadronFlavour, jet_pt, jet_eta, iop, do_deep_csv, do_by_proc);
+    sf2 = ireaders_full->at(iop)->eval_auto_bounds(full_syst, flav, jet_eta, jet_pt);
+    if (is_fast_sim_) sf2_fs = ireaders_fast->at(iop)->eval_auto_bounds(fast_syst, flav, jet_eta, jet_pt);
+  }
+
+  double eff1_fs(eff1/sf1_fs), eff2_fs(eff2/sf2_fs);
+  double result = (sf1*sf1_fs*eff1_fs-sf2*sf2_fs*eff2_fs)/(eff1_fs-eff2_fs);
+  if(std::isnan(result) || std::isinf(result)){
+    result = 1.;
+//    DBG("SF is NaN or inf. Setting to 1.!");
+  }
+  return result;
+}
+
+void BTagWeighter::JetBTagWeights(const pat::Jet &b, const vector<WeightRequest> &requests,
+				  bool do_deep_csv, bool do_by_proc, vector<double> &weights) const{
+  // Same procedure as JetBTagWeight with a single operating point, but the jet is
+  // read once, each efficiency is looked up once per operating point and each
+  // reader is queried once for all the systematics asked of it.
+  int hadronFlavour = abs(b.partonFlavour());
+  BTagEntry::JetFlavor flav;
+  switch(hadronFlavour){
+    case 5: flav = BTagEntry::FLAV_B; break;
+    case 4: flav = BTagEntry::FLAV_C; break;
+    default: flav = BTagEntry::FLAV_UDSG; break;
+  }
+  bool is_bc = (flav != BTagEntry::FLAV_UDSG);
+
+  float csv = b.bDiscriminator("pfCombinedInclusiveSecondaryVertexV2BJetTags");
+  double jet_pt = b.pt();
+  double jet_eta = b.eta();
+
+  const ReaderMap *ireaders_fast = do_deep_csv ? &readers_deep_fast_ : &readers_fast_;
+
+  // One group per (readers, operating point): which systematics it is asked for
+  struct SFGroup{
+    const ReaderMap *readers;
+    BTagEntry::OperatingPoint op;
+    vector<string> systs;
+    vector<double> sfs;
+  };
+  vector<SFGroup> groups;
+  auto request_sf = [&groups](const ReaderMap *readers, BTagEntry::OperatingPoint op, const string &syst){
+    size_t g = 0;
+    while(g < groups.size() && !(groups[g].readers == readers && groups[g].op == op)) ++g;
+    if(g == groups.size()) groups.push_back(SFGroup{readers, op, {}, {}});
+    auto &systs = groups[g].systs;
+    size_t s = distance(systs.begin(), find(systs.begin(), systs.end(), syst));
+    if(s == systs.size()) systs.push_back(syst);
+    return make_pair(g, s);
+  };
+
+  // First pass: work out which scale factors are needed
+  vector<pair<size_t, size_t> > full_sf(requests.size()), fast_sf(requests.size());
+  for(size_t i = 0; i < requests.size(); ++i){
+    const auto &req = requests[i];
+    if(OpCut(req.op, do_deep_csv) < 0) continue;
+    full_sf[i] = request_sf(FullReaders(req.runs, do_deep_csv), req.op,
+			    is_bc ? req.bc_full_syst : req.udsg_full_syst);
+    if(is_fast_sim_) fast_sf[i] = request_sf(ireaders_fast, req.op,
+					     is_bc ? req.bc_fast_syst : req.udsg_fast_syst);
+  }
+  for(auto &group: groups){
+    group.readers->at(group.op)->eval_auto_bounds(group.systs, flav, jet_eta, jet_pt, 0., group.sfs);
+  }
+
+  // Efficiencies only depend on the operating point
+  map<BTagEntry::OperatingPoint, double> effs;
+
+  // Second pass: combine them as JetBTagWeight does
+  weights.assign(requests.size(), 1.);
+  for(size_t i = 0; i < requests.size(); ++i){
+    const auto &req = requests[i];
+    float opcut = OpCut(req.op, do_deep_csv);
+    if(opcut < 0) continue;
+
+    if(!effs.count(req.op)) effs[req.op] = GetMCTagEfficiency(hadronFlavour, jet_pt, jet_eta, req.op, do_deep_csv, do_by_proc);
+    double eff = effs.at(req.op);
+    double sf = groups[full_sf[i].first].sfs[full_sf[i].second];
+    double sf_fs = is_fast_sim_ ? groups[fast_sf[i].first].sfs[fast_sf[i].second] : 1.;
+
+    double eff1(1), eff2(0), sf1(1), sf2(1), sf1_fs(1), sf2_fs(1);
+    if(csv > opcut){
+      eff1 = eff;
+      sf1 = sf;
+      sf1_fs = sf_fs;
+    }else{
+      eff2 = eff;
+      sf2 = sf;
+      sf2_fs = sf_fs;
+    }
+
+    double eff1_fs(eff1/sf1_fs), eff2_fs(eff2/sf2_fs);
+    double result = (sf1*sf1_fs*eff1_fs-sf2*sf2_fs*eff2_fs)/(eff1_fs-eff2_fs);
+    if(std::isnan(result) || std::isinf(result)){
+      result = 1.;
+    }
+    weights[i] = result;
+  }
+}
+
+float BTagWeighter::OpCut(BTagEntry::OperatingPoint op, bool do_deep_csv) const{
+  switch(op){
+  case BTagEntry::OP_LOOSE: return do_deep_csv ? deep_csv_loose_ : csv_loose_;
+  case BTagEntry::OP_MEDIUM: return do_deep_csv ? deep_csv_medium_ : csv_medium_;
+  case BTagEntry::OP_TIGHT: return do_deep_csv ? deep_csv_tight_ : csv_tight_;
+  default: return -1.;
+  }
+}
+
+const BTagWeighter::ReaderMap* BTagWeighter::FullReaders(Runs runs, bool do_deep_csv) const{
+  const ReaderMap *ireaders_full = nullptr;
   switch(runs){
   case Runs::all:
     ireaders_full = do_deep_csv ? &readers_deep_full_ : &readers_full_;
@@ -300,33 +540,7 @@ double BTagWeighter::JetBTagWeight(pat::Jet b, const vector<BTagEntry::Operating
     ERROR(("Invalid run list: "+to_string(static_cast<unsigned>(runs))));
     break;
   }
-
-  const map<BTagEntry::OperatingPoint, unique_ptr<BTagCalibrationReader> > *ireaders_fast = &readers_fast_;
-  if (do_deep_csv) ireaders_fast = &readers_deep_fast_;
-
-  double jet_pt = b.pt();
-  double jet_eta = b.eta();
-  double eff1(1), eff2(0), sf1(1), sf2(1), sf1_fs(1), sf2_fs(1);
-  if (tag >= 0){
-    BTagEntry::OperatingPoint iop = ops[tag];
-    eff1 = GetMCTagEfficiency(hadronFlavour, jet_pt, jet_eta, iop, do_deep_csv, do_by_proc);
-    sf1 = ireaders_full->at(iop)->eval_auto_bounds(full_syst, flav, jet_eta, jet_pt);
-    if (is_fast_sim_) sf1_fs = ireaders_fast->at(iop)->eval_auto_bounds(fast_syst, flav, jet_eta, jet_pt);
-  }
-  if (tag < int(ops.size())-1) {
-    BTagEntry::OperatingPoint iop = ops[tag+1];
-    eff2 = GetMCTagEfficiency(hadronFlavour, jet_pt, jet_eta, iop, do_deep_csv, do_by_proc);
-    sf2 = ireaders_full->at(iop)->eval_auto_bounds(full_syst, flav, jet_eta, jet_pt);
-    if (is_fast_sim_) sf2_fs = ireaders_fast->at(iop)->eval_auto_bounds(fast_syst, flav, jet_eta, jet_pt);
-  }
-
-  double eff1_fs(eff1/sf1_fs), eff2_fs(eff2/sf2_fs);
-  double result = (sf1*sf1_fs*eff1_fs-sf2*sf2_fs*eff2_fs)/(eff1_fs-eff2_fs);
-  if(std::isnan(result) || std::isinf(result)){
-    result = 1.;
-//    DBG("SF is NaN or inf. Setting to 1.!");
-  }
-  return result;
+  return ireaders_full;
 }
 
 double BTagWeighter::GetMCTagEfficiency(int pdgId, float pT, float eta,
@@ -338,25 +552,13 @@ double BTagWeighter::GetMCTagEfficiency(int pdgId, float pT, float eta,
     pdgId = 0;
   }
 
-  int bin;
-  float eff;
+  const BTagEfficiencyTable *table;
   if(!do_deep_csv){
-    if(!do_by_proc){
-      bin = btag_efficiencies_.at(rdr_idx).FindFixBin(fabs(eta), pT, pdgId);
-      eff = btag_efficiencies_.at(rdr_idx).GetBinContent(bin);
-    }else{
-      bin = btag_efficiencies_proc_.at(rdr_idx).FindFixBin(fabs(eta), pT, pdgId);
-      eff = btag_efficiencies_proc_.at(rdr_idx).GetBinContent(bin);
-    }
+    table = do_by_proc ? &eff_table_proc_ : &eff_table_;
   }else{
-    if(!do_by_proc){
-      bin = btag_efficiencies_deep_.at(rdr_idx).FindFixBin(fabs(eta), pT, pdgId);
-      eff = btag_efficiencies_deep_.at(rdr_idx).GetBinContent(bin);
-    }else{
-      bin = btag_efficiencies_deep_proc_.at(rdr_idx).FindFixBin(fabs(eta), pT, pdgId);
-      eff = btag_efficiencies_deep_proc_.at(rdr_idx).GetBinContent(bin);
-    }
+    table = do_by_proc ? &eff_table_deep_proc_ : &eff_table_deep_;
   }
+  float eff = table->value(rdr_idx, fabs(eta), pT, pdgId);
   
   return eff;
 }
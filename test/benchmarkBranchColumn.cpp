@@ -0,0 +1,257 @@
+// Per event cost of the data tree storage: BranchColumn against the per-type wrapper
+// classes it replaced, copied below as they were before (one heap object per branch,
+// virtual beginEvent).  The old classes are run twice, with every store finding its
+// branch by name the way IIHEAnalysis::store did, and through pointers held by the caller,
+// so the two parts of the change can be told apart.  Each layout is configured on its own
+// in-memory TTree and the time per event covers beginEvent, the stores and the Fill.  The
+// program also checks that the three give the same values and the same number of entries,
+// and that string branches keep their value from one event to the next as they did before.
+//
+//   benchmarkBranchColumn [nEvents]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <TTree.h>
+
+#include "UserCode/IIHETree/interface/BranchWrapper.h"
+
+namespace baseline{
+  // BranchWrapperBase, BranchWrapperF and BranchWrapperFV as they were, with an accessor
+  // added for the comparison
+  class BranchWrapperBase{
+    public:
+      BranchWrapperBase(std::string name){
+        name_       = name ;
+        is_filled_  = false ;
+        is_touched_ = false ;
+      }
+      virtual ~BranchWrapperBase(){}
+      virtual void beginEvent(){ is_filled_ = false ; }
+      virtual void endEvent(){}
+      std::string name(){ return name_; } ;
+      bool  is_filled(){ return is_filled_ ; } ;
+      bool is_touched(){ return is_touched_; } ;
+      void touch(){ is_touched_ = true ; } ;
+      void fill(){ is_filled_ = true ; touch() ; } ;
+      void unfill(){ is_filled_ = false ; } ;
+      virtual int config(TTree*){return -1; } ;
+    private:
+      std::string name_ ;
+      bool is_filled_ ;
+      bool is_touched_ ;
+  };
+
+  class BranchWrapperF  : public BranchWrapperBase{
+    private:
+      float value_ ;
+    public:
+      BranchWrapperF(std::string name): BranchWrapperBase(name){
+        value_ = -999 ;
+      }
+      ~BranchWrapperF(){} ;
+      void set(float value){
+        value_ = value ;
+        fill() ;
+      }
+      int config(TTree* tree){
+        if(!tree) return 1 ;
+        if(tree->GetBranch(name().c_str())) return 2 ;
+        tree->Branch(name().c_str(), &value_, Form("%s/F", name().c_str())) ;
+        return 0 ;
+      }
+      void beginEvent(){
+        value_ = -999 ;
+        unfill() ;
+      }
+      void endEvent(){}
+      float value() const { return value_ ; }
+  };
+
+  class BranchWrapperFV : public BranchWrapperBase{
+    private:
+      std::vector<float> values_;
+    public:
+      BranchWrapperFV(std::string name): BranchWrapperBase(name){}
+      ~BranchWrapperFV(){}
+      void push(float value){
+        values_.push_back(value) ;
+        fill() ;
+      }
+      int config(TTree* tree){
+        if(!tree) return 1 ;
+        if(tree->GetBranch(name().c_str())) return 2 ;
+        tree->Branch(name().c_str(), &values_) ;
+        return 0 ;
+      }
+      void beginEvent(){
+        unfill() ;
+        values_.clear() ;
+      }
+      void endEvent(){}
+      const std::vector<float>& values() const { return values_ ; }
+  };
+
+  // The old storage in IIHEAnalysis: a wrapper per branch, kept in a list per type and in
+  // the list of all the wrappers
+  class Layout{
+    public:
+      Layout(const std::vector<std::string>& scalarNames, const std::vector<std::string>& vectorNames): tree_("old", "old"){
+        tree_.SetDirectory(0) ;
+        for(unsigned int i=0 ; i<scalarNames.size() ; ++i){
+          BranchWrapperF*  bw = new BranchWrapperF (scalarNames[i]) ;
+          vars_F_ .push_back(bw) ;
+          allVars_.push_back((BranchWrapperBase*)bw) ;
+        }
+        for(unsigned int i=0 ; i<vectorNames.size() ; ++i){
+          BranchWrapperFV* bw = new BranchWrapperFV(vectorNames[i]) ;
+          vars_FV_.push_back(bw) ;
+          allVars_.push_back((BranchWrapperBase*)bw) ;
+        }
+        for(unsigned int i=0 ; i<allVars_.size() ; ++i){ allVars_.at(i)->config(&tree_) ; }
+      }
+      ~Layout(){
+        for(unsigned int i=0 ; i<allVars_.size() ; ++i) delete allVars_[i] ;
+      }
+      void beginEvent(){
+        for(unsigned int i=0 ; i<allVars_.size() ; ++i){ allVars_.at(i)->beginEvent() ; }
+      }
+      // As IIHEAnalysis::store(std::string, float), reduced to the types used here
+      bool store(std::string name, float value){
+        for(unsigned int i=0 ; i<vars_F_.size() ; ++i){
+          if(vars_F_.at(i)->name()==name){
+            vars_F_ .at(i)->set(value) ;
+            return true ;
+          }
+        }
+        for(unsigned int i=0 ; i<vars_FV_.size() ; ++i){
+          if(vars_FV_.at(i)->name()==name){
+            vars_FV_ .at(i)->push(value) ;
+            return true ;
+          }
+        }
+        return false ;
+      }
+      void fill(){ tree_.Fill() ; }
+      BranchWrapperF*  scalarWrapper(unsigned int i){ return vars_F_ [i] ; }
+      BranchWrapperFV* vectorWrapper(unsigned int i){ return vars_FV_[i] ; }
+      Long64_t entries(){ return tree_.GetEntries() ; }
+    private:
+      TTree tree_ ;
+      std::vector<BranchWrapperBase*> allVars_ ;
+      std::vector<BranchWrapperF*   > vars_F_  ;
+      std::vector<BranchWrapperFV*  > vars_FV_ ;
+  };
+}
+
+namespace{
+  // Half of the branches are written, as in a typical event, the vectors a few times each
+  const unsigned int nPerEvent = 4 ;
+  float scalarValue(int event, unsigned int i){ return event+i ; }
+  float vectorValue(int event, unsigned int i, unsigned int j){ return event+i+j ; }
+
+  double seconds(std::chrono::steady_clock::time_point start){
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start ;
+    return elapsed.count() ;
+  }
+}
+
+int main(int argc, char** argv){
+  int nEvents = (argc>1) ? atoi(argv[1]) : 2000 ;
+  const unsigned int nScalars = 600 ;
+  const unsigned int nVectors = 400 ;
+  int nFailures = 0 ;
+
+  std::vector<std::string> scalarNames, vectorNames ;
+  for(unsigned int i=0 ; i<nScalars ; ++i) scalarNames.push_back("scalar_"+std::to_string(i)) ;
+  for(unsigned int i=0 ; i<nVectors ; ++i) vectorNames.push_back("vector_"+std::to_string(i)) ;
+
+  // Old classes, every store finds its branch by name
+  baseline::Layout byName(scalarNames, vectorNames) ;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now() ;
+  for(int event=0 ; event<nEvents ; ++event){
+    byName.beginEvent() ;
+    for(unsigned int i=event%2 ; i<nScalars ; i+=2) byName.store(scalarNames[i], scalarValue(event, i)) ;
+    for(unsigned int i=event%2 ; i<nVectors ; i+=2){
+      for(unsigned int j=0 ; j<nPerEvent ; ++j) byName.store(vectorNames[i], vectorValue(event, i, j)) ;
+    }
+    byName.fill() ;
+  }
+  double timeByName = seconds(start) ;
+
+  // Old classes, stores through pointers to the wrappers
+  baseline::Layout byPointer(scalarNames, vectorNames) ;
+  std::vector<baseline::BranchWrapperF* > scalars ;
+  std::vector<baseline::BranchWrapperFV*> vectors ;
+  for(unsigned int i=0 ; i<nScalars ; ++i) scalars.push_back(byPointer.scalarWrapper(i)) ;
+  for(unsigned int i=0 ; i<nVectors ; ++i) vectors.push_back(byPointer.vectorWrapper(i)) ;
+  start = std::chrono::steady_clock::now() ;
+  for(int event=0 ; event<nEvents ; ++event){
+    byPointer.beginEvent() ;
+    for(unsigned int i=event%2 ; i<nScalars ; i+=2) scalars[i]->set(scalarValue(event, i)) ;
+    for(unsigned int i=event%2 ; i<nVectors ; i+=2){
+      for(unsigned int j=0 ; j<nPerEvent ; ++j) vectors[i]->push(vectorValue(event, i, j)) ;
+    }
+    byPointer.fill() ;
+  }
+  double timeByPointer = seconds(start) ;
+
+  // New: one column per type, stores through the index held by a handle
+  TTree tree("new", "new") ;
+  tree.SetDirectory(0) ;
+  BranchColumn<float> newScalars(-999) ;
+  BranchColumn<std::vector<float> > newVectors ;
+  for(unsigned int i=0 ; i<nScalars ; ++i) newScalars.add(scalarNames[i]) ;
+  for(unsigned int i=0 ; i<nVectors ; ++i) newVectors.add(vectorNames[i]) ;
+  newScalars.config(&tree) ;
+  newVectors.config(&tree) ;
+  start = std::chrono::steady_clock::now() ;
+  for(int event=0 ; event<nEvents ; ++event){
+    newScalars.beginEvent() ;
+    newVectors.beginEvent() ;
+    for(unsigned int i=event%2 ; i<nScalars ; i+=2) newScalars.set(i, scalarValue(event, i)) ;
+    for(unsigned int i=event%2 ; i<nVectors ; i+=2){
+      for(unsigned int j=0 ; j<nPerEvent ; ++j) newVectors.push(i, vectorValue(event, i, j)) ;
+    }
+    tree.Fill() ;
+  }
+  double timeNew = seconds(start) ;
+
+  // Same contents after the last event, and one entry per event in every tree
+  for(unsigned int i=0 ; i<nScalars ; ++i){
+    float expected = byName.scalarWrapper(i)->value() ;
+    if(scalars[i]->value()!=expected || newScalars.get(i)!=expected){
+      if(nFailures<20) printf("%s: %g by name, %g by pointer, %g in the column\n", scalarNames[i].c_str(), expected, scalars[i]->value(), newScalars.get(i)) ;
+      nFailures++ ;
+    }
+  }
+  for(unsigned int i=0 ; i<nVectors ; ++i){
+    const std::vector<float>& expected = byName.vectorWrapper(i)->values() ;
+    if(vectors[i]->values()!=expected || newVectors.get(i)!=expected){
+      if(nFailures<20) printf("%s: %zu values by name, %zu by pointer, %zu in the column\n", vectorNames[i].c_str(), expected.size(), vectors[i]->values().size(), newVectors.get(i).size()) ;
+      nFailures++ ;
+    }
+  }
+  if(byName.entries()!=nEvents || byPointer.entries()!=nEvents || tree.GetEntries()!=nEvents){
+    printf("entries: %lld by name, %lld by pointer, %lld in the column, %d events\n",
+           (long long) byName.entries(), (long long) byPointer.entries(), (long long) tree.GetEntries(), nEvents) ;
+    nFailures++ ;
+  }
+
+  // Strings are not reset by beginEvent
+  BranchColumn<std::string> strings(std::string(), false) ;
+  strings.add("string_0") ;
+  strings.set(0, "kept") ;
+  strings.beginEvent() ;
+  if(strings.get(0)!="kept" || strings.is_filled(0)) nFailures++ ;
+
+  printf("%d events, %u float and %u vector<float> branches, beginEvent+store+Fill\n", nEvents, nScalars, nVectors) ;
+  printf("  wrappers, by name    : %10.3f us/event\n", 1e6*timeByName   /nEvents) ;
+  printf("  wrappers, by pointer : %10.3f us/event\n", 1e6*timeByPointer/nEvents) ;
+  printf("  BranchColumn         : %10.3f us/event\n", 1e6*timeNew      /nEvents) ;
+  printf("%d failures\n", nFailures) ;
+  return (nFailures==0) ? 0 : 1 ;
+}
@@ -0,0 +1,202 @@
+// Per event cost of the EBHits_* and EEHits_* columns: EcalRecHitScanner against the
+// loop it replaced in the electron module (a checkFlag per hit for the saturation, and
+// for every hit above the threshold about ten stores found by branch name).  Only the
+// event loop part is timed, on rechit collections filled by hand with barrel and endcap
+// hits of random energies and flags from a fixed seed.  The program also checks that both
+// give the same columns and saturation, with the endcap hits read as EEDetId (iy, ix) and
+// numbered among the endcap hits, as the scanner does.
+//
+//   benchmarkEcalRecHitScanner [nEvents] [seed]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DataFormats/EcalDetId/interface/EBDetId.h"
+#include "DataFormats/EcalDetId/interface/EEDetId.h"
+#include "DataFormats/EcalRecHit/interface/EcalRecHit.h"
+#include "DataFormats/EcalRecHit/interface/EcalRecHitCollections.h"
+#include "UserCode/IIHETree/interface/EcalRecHitScanner.h"
+
+namespace{
+  const float threshold = 200 ;
+  const char* flagNames[] = {"kSaturated", "kLeadingEdgeRecovered", "kNeighboursRecovered", "kWeird"} ;
+  const int flags[] = {EcalRecHit::kSaturated, EcalRecHit::kLeadingEdgeRecovered, EcalRecHit::kNeighboursRecovered, EcalRecHit::kWeird} ;
+  const unsigned int nFlags = sizeof(flags)/sizeof(flags[0]) ;
+
+  // Energies falling steeply, with one hit in a few hundred above the threshold, and each
+  // flag set on a small share of the hits
+  void fillHit(std::mt19937& rng, const DetId& id, EcalRecHitCollection& hits){
+    std::uniform_real_distribution<double> flat(0, 1) ;
+    float energy = -40*std::log(flat(rng)+1e-12) ;
+    EcalRecHit hit(id, energy, 0) ;
+    if(flat(rng)<0.7) hit.setFlag(EcalRecHit::kGood) ;
+    for(unsigned int f=0 ; f<nFlags ; ++f){
+      if(flat(rng)<0.002) hit.setFlag(flags[f]) ;
+    }
+    if(flat(rng)<0.01) hit.setFlag(EcalRecHit::kPoorCalib) ;
+    hits.push_back(hit) ;
+  }
+
+  void fillEvent(std::mt19937& rng, unsigned int nBarrel, unsigned int nEndcap, EcalRecHitCollection& barrel, EcalRecHitCollection& endcap){
+    barrel = EcalRecHitCollection() ;
+    endcap = EcalRecHitCollection() ;
+    for(unsigned int i=0 ; i<nBarrel ; ++i){
+      int ieta = 1+rng()%85 ;
+      if(rng()%2) ieta = -ieta ;
+      fillHit(rng, EBDetId(ieta, 1+rng()%360), barrel) ;
+    }
+    while(endcap.size()<nEndcap){
+      int ix = 1+rng()%100 ;
+      int iy = 1+rng()%100 ;
+      int iz = (rng()%2) ? 1 : -1 ;
+      if(EEDetId::validDetId(ix, iy, iz)) fillHit(rng, EEDetId(ix, iy, iz), endcap) ;
+    }
+    barrel.sort() ;
+    endcap.sort() ;
+  }
+
+  // The old layout: every store finds its branch by name and appends to it
+  typedef std::map<std::string, std::vector<double> > OldBranches ;
+  void oldStore(OldBranches& branches, const std::string& name, double value){
+    branches[name].push_back(value) ;
+  }
+
+  // The old loop, with the endcap ids read as EEDetId and numbered among the endcap hits
+  bool oldLoop(const EcalRecHitCollection& hits, bool isEndcap, const std::string& prefix, OldBranches& branches){
+    bool isSaturated = false ;
+    int nRecHits = 0 ;
+    for(EcalRecHitCollection::const_iterator it=hits.begin() ; it!=hits.end() ; ++it){
+      if((*it).checkFlag(EcalRecHit::kSaturated)) isSaturated = true ;
+      if((*it).energy()<threshold) continue ;
+      nRecHits++ ;
+      int ieta = 0 ;
+      int iphi = 0 ;
+      if(isEndcap){
+        EEDetId elementId = (*it).id() ;
+        ieta = elementId.iy() ;
+        iphi = elementId.ix() ;
+      }
+      else{
+        EBDetId elementId = (*it).id() ;
+        ieta = elementId.ieta() ;
+        iphi = elementId.iphi() ;
+      }
+      oldStore(branches, prefix+"_rawId"   , (*it).id().rawId()) ;
+      oldStore(branches, prefix+"_iRechit" , nRecHits) ;
+      oldStore(branches, prefix+"_energy"  , (*it).energy()) ;
+      oldStore(branches, prefix+"_ieta"    , ieta) ;
+      oldStore(branches, prefix+"_iphi"    , iphi) ;
+      oldStore(branches, prefix+"_RecoFlag", (*it).recoFlag()) ;
+      for(unsigned int f=0 ; f<nFlags ; ++f) oldStore(branches, prefix+"_"+flagNames[f], (*it).checkFlag(flags[f])) ;
+    }
+    return isSaturated ;
+  }
+
+  template<typename T> bool sameColumn(const std::vector<double>& expected, const std::vector<T>& found){
+    if(expected.size()!=found.size()) return false ;
+    for(unsigned int i=0 ; i<found.size() ; ++i){
+      if(expected[i]!=(double)found[i]) return false ;
+    }
+    return true ;
+  }
+
+  int compare(const EcalRecHitScanner& scanner, OldBranches& branches, bool oldSaturated, int event){
+    int nFailures = 0 ;
+    const std::string& prefix = scanner.prefix() ;
+    std::vector<std::string> failed ;
+    if(!sameColumn(branches[prefix+"_rawId"   ], scanner.rawId()   )) failed.push_back("rawId"   ) ;
+    if(!sameColumn(branches[prefix+"_iRechit" ], scanner.iRechit() )) failed.push_back("iRechit" ) ;
+    if(!sameColumn(branches[prefix+"_energy"  ], scanner.energy()  )) failed.push_back("energy"  ) ;
+    if(!sameColumn(branches[prefix+"_ieta"    ], scanner.ieta()    )) failed.push_back("ieta"    ) ;
+    if(!sameColumn(branches[prefix+"_iphi"    ], scanner.iphi()    )) failed.push_back("iphi"    ) ;
+    if(!sameColumn(branches[prefix+"_RecoFlag"], scanner.recoFlag())) failed.push_back("RecoFlag") ;
+    for(unsigned int f=0 ; f<nFlags ; ++f){
+      if(!sameColumn(branches[prefix+"_"+flagNames[f]], scanner.flag(f))) failed.push_back(flagNames[f]) ;
+    }
+    if(scanner.isSaturated()!=oldSaturated) failed.push_back("isSaturated") ;
+    for(unsigned int i=0 ; i<failed.size() ; ++i){
+      if(nFailures<20) printf("event %d: %s_%s differs from the old loop\n", event, prefix.c_str(), failed[i].c_str()) ;
+      nFailures++ ;
+    }
+    return nFailures ;
+  }
+
+  double seconds(std::chrono::steady_clock::time_point start){
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start ;
+    return elapsed.count() ;
+  }
+}
+
+int main(int argc, char** argv){
+  int nEvents = (argc>1) ? atoi(argv[1]) : 2000 ;
+  unsigned int seed = (argc>2) ? atoi(argv[2]) : 12345 ;
+  std::mt19937 rng(seed) ;
+  const std::vector<std::string> saturationFlags(1, "kSaturated") ;
+  const std::vector<std::string> storedFlags(flagNames, flagNames+nFlags) ;
+  int nStored = 0 ;
+  int nFailures = 0 ;
+
+  EcalRecHitScanner barrelScanner("EBHits", false, threshold, saturationFlags, storedFlags) ;
+  EcalRecHitScanner endcapScanner("EEHits", true , threshold, saturationFlags, storedFlags) ;
+
+  // Same columns and saturation, on events of random size
+  EcalRecHitCollection barrel, endcap ;
+  for(int event=0 ; event<nEvents ; ++event){
+    fillEvent(rng, rng()%3000, rng()%2000, barrel, endcap) ;
+    OldBranches branches ;
+    bool oldSaturated = oldLoop(barrel, false, "EBHits", branches) ;
+    bool oldEESaturated = oldLoop(endcap, true, "EEHits", branches) ;
+    barrelScanner.scan(barrel) ;
+    endcapScanner.scan(endcap) ;
+    nFailures += compare(barrelScanner, branches, oldSaturated  , event) ;
+    nFailures += compare(endcapScanner, branches, oldEESaturated, event) ;
+    nStored += barrelScanner.nStoredHits()+endcapScanner.nStoredHits() ;
+  }
+
+  // Timing, on the same events for both, from the reduced collections of a quiet event to
+  // those of a busy one
+  const unsigned int sizes[] = {100, 500, 2000, 8000} ;
+  const int nTimedEvents = 20 ;
+  const int nRepeats = 50 ;
+  printf("barrel+endcap hits, time per event of the old loop / scanner (us)\n") ;
+  for(unsigned int s=0 ; s<sizeof(sizes)/sizeof(sizes[0]) ; ++s){
+    std::mt19937 timingRng(seed+s) ;
+    std::vector<EcalRecHitCollection> barrels(nTimedEvents), endcaps(nTimedEvents) ;
+    for(int event=0 ; event<nTimedEvents ; ++event) fillEvent(timingRng, sizes[s], sizes[s]/2, barrels[event], endcaps[event]) ;
+
+    double timeOld = 0, timeNew = 0 ;
+    unsigned int sumOld = 0, sumNew = 0 ;
+    for(int repeat=0 ; repeat<nRepeats ; ++repeat){
+      for(int event=0 ; event<nTimedEvents ; ++event){
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now() ;
+        OldBranches branches ;
+        bool saturated = oldLoop(barrels[event], false, "EBHits", branches) ;
+        saturated = oldLoop(endcaps[event], true, "EEHits", branches) || saturated ;
+        sumOld += branches["EBHits_energy"].size()+branches["EEHits_energy"].size()+saturated ;
+        timeOld += seconds(start) ;
+
+        start = std::chrono::steady_clock::now() ;
+        barrelScanner.scan(barrels[event]) ;
+        endcapScanner.scan(endcaps[event]) ;
+        saturated = barrelScanner.isSaturated() || endcapScanner.isSaturated() ;
+        sumNew += barrelScanner.nStoredHits()+endcapScanner.nStoredHits()+saturated ;
+        timeNew += seconds(start) ;
+      }
+    }
+    if(sumOld!=sumNew){
+      printf("%u barrel hits: %u stored hits in the old loop, %u in the scanner\n", sizes[s], sumOld, sumNew) ;
+      nFailures++ ;
+    }
+    int n = nTimedEvents*nRepeats ;
+    printf("  %5u+%-5u: %8.3f / %8.3f\n", sizes[s], sizes[s]/2, 1e6*timeOld/n, 1e6*timeNew/n) ;
+  }
+
+  printf("%d events, %d stored hits, %d failures\n", nEvents, nStored, nFailures) ;
+  return (nFailures==0) ? 0 : 1 ;
+}
@@ -0,0 +1,36 @@
+# Write the binary cache of the b-tag calibrations and efficiency maps read by the jet
+# module, so that jobs can skip parsing the CSV files:
+#[cmsRun compileBTagCache.py cacheFile="data/btagCache_tt.bin"]
+# Run it from the directory holding data/, then set btagCacheFile to the same path.
+# The cache is checked against the input files at startup and ignored if they changed.
+
+import FWCore.ParameterSet.Config as cms
+import FWCore.ParameterSet.VarParsing as opts
+
+options = opts.VarParsing ("analysis")
+options.register("cacheFile",
+                 "data/btagCache_tt.bin",
+                 opts.VarParsing.multiplicity.singleton,
+                 opts.VarParsing.varType.string,
+                 "Cache file to write")
+options.parseArguments()
+
+process = cms.Process("BTagCache")
+process.source = cms.Source("EmptySource")
+process.maxEvents = cms.untracked.PSet( input = cms.untracked.int32(0) )
+process.TFileService = cms.Service("TFileService", fileName = cms.string("compileBTagCache.root") )
+
+# Only the jet module is needed: the cache is written when it is constructed
+process.load("UserCode.IIHETree.IIHETree_cfi")
+process.IIHEAnalysis.globalTag                       = cms.string("")
+process.IIHEAnalysis.isMC                            = cms.untracked.bool(True)
+process.IIHEAnalysis.includeJetModule                = cms.untracked.bool(True)
+process.IIHEAnalysis.JetCollectionSmeared            = cms.InputTag("slimmedJets")
+process.IIHEAnalysis.JetCollectionEnUp               = cms.InputTag("slimmedJets")
+process.IIHEAnalysis.JetCollectionEnDown             = cms.InputTag("slimmedJets")
+process.IIHEAnalysis.JetCollectionSmearedJetResUp    = cms.InputTag("slimmedJets")
+process.IIHEAnalysis.JetCollectionSmearedJetResDown  = cms.InputTag("slimmedJets")
+process.IIHEAnalysis.btagCacheFile                   = cms.untracked.string(options.cacheFile)
+process.IIHEAnalysis.btagCompileCache                = cms.untracked.bool(True)
+
+process.p1 = cms.Path(process.IIHEAnalysis)
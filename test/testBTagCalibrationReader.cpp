@@ -0,0 +1,133 @@
+// BTagCalibrationReader::eval and min_max_pt look up the cell index built in load; they
+// must return exactly what eval_linear and min_max_pt_linear find by scanning the entries
+// in file order.  The calibrations are random: for every operating point, reshaping
+// included, and jet flavour, a grid of eta, pt and discr bins with gaps, some in signed
+// and some in absolute eta, plus entries overlapping the grid at random.  The points are
+// random (flavour, eta, pt, discr), with a share of them exactly on bin edges and outside
+// every bin.  Every other reader tabulates its functions, which it does on the first
+// evaluation of each entry.
+//
+//   testBTagCalibrationReader [seed]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "UserCode/IIHETree/interface/BTagCalibration.h"
+#include "UserCode/IIHETree/interface/BTagCalibrationReader.h"
+
+namespace{
+  const char* opNames[] = {"loose", "medium", "tight", "reshaping"} ;
+
+  // Sorted bin edges from lo to hi
+  std::vector<float> randomEdges(std::mt19937& rng, float lo, float hi, unsigned int n){
+    std::uniform_real_distribution<float> flat(lo, hi) ;
+    std::vector<float> edges(1, lo) ;
+    for(unsigned int i=1 ; i<n ; ++i) edges.push_back(flat(rng)) ;
+    edges.push_back(hi) ;
+    std::sort(edges.begin(), edges.end()) ;
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end()) ;
+    return edges ;
+  }
+
+  // A random range within [lo, hi]
+  std::pair<float, float> randomRange(std::mt19937& rng, float lo, float hi){
+    std::uniform_real_distribution<float> flat(lo, hi) ;
+    float a = flat(rng) ;
+    float b = flat(rng) ;
+    return std::make_pair(std::min(a, b), std::max(a, b)) ;
+  }
+
+  std::string randomFormula(std::mt19937& rng){
+    std::uniform_real_distribution<double> flat(0, 1) ;
+    char formula[100] ;
+    snprintf(formula, sizeof(formula), "%.4f+%.6f*x", 0.8+0.4*flat(rng), 0.001*(flat(rng)-0.5)) ;
+    return formula ;
+  }
+
+  void addEntries(std::mt19937& rng, BTagEntry::OperatingPoint op, const std::string& sysType, BTagCalibration& calibration,
+                  std::vector<float> (&allEdges)[3]){
+    std::uniform_real_distribution<float> flat(0, 1) ;
+    bool reshaping = (op==BTagEntry::OP_RESHAPING) ;
+    for(int jf=0 ; jf<3 ; ++jf){
+      bool absEta = (rng()%2) ;
+      std::vector<float> etaEdges = randomEdges(rng, absEta ? 0 : -2.5, 2.5, 2+rng()%4) ;
+      std::vector<float> ptEdges = randomEdges(rng, 20, 1000, 2+rng()%8) ;
+      std::vector<float> discrEdges = reshaping ? randomEdges(rng, -1, 1.1, 2+rng()%6) : std::vector<float>{0, 1} ;
+      for(unsigned int ie=0 ; ie+1<etaEdges.size() ; ++ie){
+        for(unsigned int ip=0 ; ip+1<ptEdges.size() ; ++ip){
+          for(unsigned int id=0 ; id+1<discrEdges.size() ; ++id){
+            if(flat(rng)<0.1) continue ;
+            BTagEntry::Parameters params(op, "comb", sysType, (BTagEntry::JetFlavor) jf,
+                                         etaEdges[ie], etaEdges[ie+1], ptEdges[ip], ptEdges[ip+1], discrEdges[id], discrEdges[id+1]) ;
+            calibration.addEntry(BTagEntry(randomFormula(rng), params)) ;
+          }
+        }
+      }
+      // Entries across the grid, found first or last depending on where they are in the file
+      for(int k=rng()%4 ; k>0 ; --k){
+        std::pair<float, float> eta = randomRange(rng, absEta ? 0 : -2.5, 2.5) ;
+        std::pair<float, float> pt = randomRange(rng, 0, 1500) ;
+        std::pair<float, float> discr = reshaping ? randomRange(rng, -1.5, 1.5) : std::make_pair(0.f, 1.f) ;
+        BTagEntry::Parameters params(op, "comb", sysType, (BTagEntry::JetFlavor) jf,
+                                     eta.first, eta.second, pt.first, pt.second, discr.first, discr.second) ;
+        calibration.addEntry(BTagEntry(randomFormula(rng), params)) ;
+      }
+      allEdges[0].insert(allEdges[0].end(), etaEdges.begin(), etaEdges.end()) ;
+      allEdges[1].insert(allEdges[1].end(), ptEdges.begin(), ptEdges.end()) ;
+      allEdges[2].insert(allEdges[2].end(), discrEdges.begin(), discrEdges.end()) ;
+    }
+  }
+
+  // Random in [lo, hi), or one of the edges
+  float randomPoint(std::mt19937& rng, const std::vector<float>& edges, float lo, float hi){
+    std::uniform_real_distribution<float> flat(lo, hi) ;
+    if(rng()%4==0 && !edges.empty()) return edges[rng()%edges.size()] ;
+    return flat(rng) ;
+  }
+}
+
+int main(int argc, char** argv){
+  unsigned int seed = (argc>1) ? atoi(argv[1]) : 12345 ;
+  std::mt19937 rng(seed) ;
+  const int nCalibrations = 20 ;
+  const int nPoints = 20000 ;
+  int nChecks = 0 ;
+  int nFailures = 0 ;
+
+  for(int op=0 ; op<4 ; ++op){
+    for(int c=0 ; c<nCalibrations ; ++c){
+      BTagCalibration calibration("test") ;
+      std::vector<float> edges[3] ;
+      addEntries(rng, (BTagEntry::OperatingPoint) op, "central", calibration, edges) ;
+      BTagCalibrationReader reader((BTagEntry::OperatingPoint) op, "central") ;
+      if(c%2) reader.set_table_tolerance(1e-4) ;
+      for(int jf=0 ; jf<3 ; ++jf) reader.load(calibration, (BTagEntry::JetFlavor) jf, "comb") ;
+
+      for(int i=0 ; i<nPoints ; ++i){
+        BTagEntry::JetFlavor jf = (BTagEntry::JetFlavor) (rng()%3) ;
+        float eta = randomPoint(rng, edges[0], -3, 3) ;
+        if(rng()%2) eta = -eta ;
+        float pt = randomPoint(rng, edges[1], 0, 1600) ;
+        float discr = randomPoint(rng, edges[2], -1.5, 1.5) ;
+        nChecks++ ;
+        double found = reader.eval(jf, eta, pt, discr) ;
+        double expected = reader.eval_linear(jf, eta, pt, discr) ;
+        std::pair<float, float> bounds = reader.min_max_pt(jf, eta, discr) ;
+        std::pair<float, float> expectedBounds = reader.min_max_pt_linear(jf, eta, discr) ;
+        if(found!=expected || bounds!=expectedBounds){
+          if(nFailures<20) printf("%s calibration %d flavour %d (eta %.9g, pt %.9g, discr %.9g): eval %.17g, linear %.17g, bounds (%g, %g), linear (%g, %g)\n",
+                                  opNames[op], c, jf, eta, pt, discr, found, expected, bounds.first, bounds.second, expectedBounds.first, expectedBounds.second) ;
+          nFailures++ ;
+        }
+      }
+    }
+  }
+
+  printf("%d points, %d failures\n", nChecks, nFailures) ;
+  return (nFailures==0) ? 0 : 1 ;
+}
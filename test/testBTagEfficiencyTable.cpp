@@ -0,0 +1,90 @@
+// BTagEfficiencyTable::value must return what the source TH3D's give through
+// GetBinContent(FindFixBin(x, y, z)).  Every bin of every map is probed, under- and
+// overflow included: at the centre, exactly on the low edge, and just below the high
+// edge.  The maps mix fixed and variable binnings, some shared and some not, as the
+// efficiency files do.
+//
+//   testBTagEfficiencyTable [seed]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <TH3D.h>
+
+#include "UserCode/IIHETree/interface/BTagEfficiencyTable.h"
+
+namespace{
+  // Points to probe along one axis, for all bins from underflow to overflow
+  std::vector<double> probes(const TAxis& axis){
+    std::vector<double> points ;
+    int n = axis.GetNbins() ;
+    points.push_back(axis.GetXmin()-1) ;
+    points.push_back(std::nextafter(axis.GetXmin(), -1e30)) ;
+    for(int i=1 ; i<=n ; ++i){
+      points.push_back(axis.GetBinLowEdge(i)) ;
+      points.push_back(axis.GetBinCenter(i)) ;
+      points.push_back(std::nextafter(axis.GetBinUpEdge(i), -1e30)) ;
+    }
+    points.push_back(axis.GetXmax()) ;
+    points.push_back(axis.GetXmax()+1000) ;
+    return points ;
+  }
+}
+
+int main(int argc, char** argv){
+  unsigned int seed = (argc>1) ? atoi(argv[1]) : 12345 ;
+  std::mt19937 rng(seed) ;
+  std::uniform_real_distribution<double> flat(0, 1) ;
+  int nChecks = 0 ;
+  int nFailures = 0 ;
+
+  // eta, pt and flavour binnings like those of data/btagEfficiency*.root
+  const double etaBins[] = {0, 0.6, 1.2, 2.1, 2.4} ;
+  const double ptBins[]  = {20, 30, 50, 70, 100, 140, 200, 300, 600, 1000} ;
+  const double flavBins[] = {-0.5, 3.5, 4.5, 5.5} ;
+  std::vector<TH3D> hists ;
+  for(int i=0 ; i<3 ; ++i){
+    std::string name = "variable_"+std::to_string(i) ;
+    hists.push_back(TH3D(name.c_str(), "", 4, etaBins, 9, ptBins, 3, flavBins)) ;
+  }
+  hists.push_back(TH3D("fixed_0", "", 6, 0, 2.4, 20, 20, 1020, 3, -0.5, 5.5)) ;
+  hists.push_back(TH3D("fixed_1", "", 6, 0, 2.4, 20, 20, 1020, 3, -0.5, 5.5)) ;
+  hists.push_back(TH3D("fixed_2", "", 1, 0, 2.5, 1, 0, 7000, 6, 0, 6)) ;
+  for(unsigned int h=0 ; h<hists.size() ; ++h){
+    hists[h].SetDirectory(0) ;
+    for(int i=0 ; i<hists[h].GetNcells() ; ++i) hists[h].SetBinContent(i, flat(rng)) ;
+  }
+
+  BTagEfficiencyTable table(hists) ;
+  if(table.size()!=hists.size()){
+    printf("table holds %u maps, expected %lu\n", table.size(), hists.size()) ;
+    nFailures++ ;
+  }
+
+  for(unsigned int h=0 ; h<hists.size() ; ++h){
+    const TH3D& hist = hists[h] ;
+    std::vector<double> xs = probes(*hist.GetXaxis()) ;
+    std::vector<double> ys = probes(*hist.GetYaxis()) ;
+    std::vector<double> zs = probes(*hist.GetZaxis()) ;
+    for(unsigned int ix=0 ; ix<xs.size() ; ++ix){
+      for(unsigned int iy=0 ; iy<ys.size() ; ++iy){
+        for(unsigned int iz=0 ; iz<zs.size() ; ++iz){
+          nChecks++ ;
+          double expected = hist.GetBinContent(hist.FindFixBin(xs[ix], ys[iy], zs[iz])) ;
+          double found    = table.value(h, xs[ix], ys[iy], zs[iz]) ;
+          if(found!=expected){
+            if(nFailures<20) printf("%s (%g, %g, %g): table %g, TH3D %g\n", hist.GetName(), xs[ix], ys[iy], zs[iz], found, expected) ;
+            nFailures++ ;
+          }
+        }
+      }
+    }
+  }
+
+  printf("%d lookups, %d failures\n", nChecks, nFailures) ;
+  return (nFailures==0) ? 0 : 1 ;
+}
@@ -0,0 +1,226 @@
+// BTagWeighter::JetBTagWeights must give, for every request, what JetBTagWeight gives
+// for the same single operating point, systematics and run period.  The weighter is
+// built from random calibrations and efficiency maps written to a temporary data/
+// directory under the names it reads.  The requests are the 15 the jet module stores as
+// jet_BtagSF*, and a random list mixing run periods and fast sim systematics.  The jets
+// are b, c and udsg, with discriminators on either side of each cut, and pts on the
+// calibration bounds and outside them.  Both are checked with and without fast sim
+// scale factors, tabulated or not, for CSVv2 and DeepCSV, inclusive and by process.
+//
+//   testBTagWeights [nJets] [seed]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <TFile.h>
+#include <TH3D.h>
+
+#include "DataFormats/PatCandidates/interface/Jet.h"
+#include "UserCode/IIHETree/interface/btag_weighter.h"
+
+namespace{
+  const char* discriminatorName = "pfCombinedInclusiveSecondaryVertexV2BJetTags" ;
+  const std::vector<float> etaEdges = {0, 0.8, 1.6, 2.4} ;
+  const std::vector<float> ptEdges = {20, 30, 50, 70, 100, 160, 300, 670} ;
+  const std::vector<float> cuts = {0.5426, 0.8484, 0.9535, 0.2219, 0.6324, 0.8958} ;
+
+  bool endsWith(const std::string& s, const std::string& end){
+    return s.size()>=end.size() && s.compare(s.size()-end.size(), end.size(), end)==0 ;
+  }
+
+  std::string formula(double a, double b){
+    char text[100] ;
+    snprintf(text, sizeof(text), "%.4f+%.7f*x", a, b) ;
+    return text ;
+  }
+
+  // Every operating point, measurement type and flavour, with up and down shifted from
+  // the central formula by a random amount
+  void writeCalibration(std::mt19937& rng, const std::string& path){
+    std::uniform_real_distribution<double> flat(0, 1) ;
+    BTagCalibration calibration("csvv2") ;
+    const char* measurementTypes[] = {"comb", "incl", "fastsim"} ;
+    for(int op=0 ; op<3 ; ++op){
+      for(const char* measurementType : measurementTypes){
+        for(int jf=0 ; jf<3 ; ++jf){
+          for(unsigned int ie=0 ; ie+1<etaEdges.size() ; ++ie){
+            for(unsigned int ip=0 ; ip+1<ptEdges.size() ; ++ip){
+              double a = 0.8+0.4*flat(rng) ;
+              double b = 0.0004*(flat(rng)-0.5) ;
+              double shift = 0.01+0.1*flat(rng) ;
+              const char* sysTypes[] = {"central", "up", "down"} ;
+              for(int s=0 ; s<3 ; ++s){
+                BTagEntry::Parameters params((BTagEntry::OperatingPoint) op, measurementType, sysTypes[s], (BTagEntry::JetFlavor) jf,
+                                             etaEdges[ie], etaEdges[ie+1], ptEdges[ip], ptEdges[ip+1], 0, 1) ;
+                double offset = (s==1) ? shift : (s==2) ? -shift : 0 ;
+                calibration.addEntry(BTagEntry(formula(a+offset, b), params)) ;
+              }
+            }
+          }
+        }
+      }
+    }
+    std::ofstream out(path.c_str()) ;
+    calibration.makeCSV(out) ;
+  }
+
+  // The maps of all operating points, in |eta|, pt and flavour, under- and overflow
+  // included, with a few empty cells
+  void writeEfficiencies(std::mt19937& rng, const std::string& path){
+    std::uniform_real_distribution<double> flat(0, 1) ;
+    const double x[] = {0, 0.6, 1.2, 1.8, 2.5} ;
+    const double y[] = {20, 40, 60, 100, 200, 400, 1000} ;
+    const double z[] = {-0.5, 0.5, 4.5, 5.5} ;
+    const char* names[] = {"btagEfficiency_loose", "btagEfficiency_medium", "btagEfficiency_tight",
+                           "btagEfficiency_deep_loose", "btagEfficiency_deep_medium", "btagEfficiency_deep_tight"} ;
+    TFile file(path.c_str(), "recreate") ;
+    for(const char* name : names){
+      TH3D hist(name, name, 4, x, 6, y, 3, z) ;
+      for(int bin=0 ; bin<hist.GetNcells() ; ++bin){
+        hist.SetBinContent(bin, (flat(rng)<0.02) ? 0 : 0.02+0.96*flat(rng)) ;
+      }
+      hist.Write() ;
+    }
+    file.Close() ;
+  }
+
+  template<typename T> T pick(std::mt19937& rng, const std::vector<T>& values){
+    return values[rng()%values.size()] ;
+  }
+
+  pat::Jet randomJet(std::mt19937& rng){
+    std::uniform_real_distribution<float> flat(0, 1) ;
+    const std::vector<int> flavours = {5, -5, 4, -4, 0, 1, -2, 3, 21} ;
+
+    float pt = 20+650*flat(rng) ;
+    switch(rng()%4){
+      case 0: pt = pick(rng, ptEdges) ; break ;
+      case 1: pt = (rng()%2) ? 5+15*flat(rng) : 670+2000*flat(rng) ; break ;
+    }
+    float eta = 2.6*(2*flat(rng)-1) ;
+    if(rng()%4==0) eta = pick(rng, etaEdges)*((rng()%2) ? 1 : -1) ;
+
+    float discriminator = flat(rng) ;
+    switch(rng()%4){
+      case 0: discriminator = pick(rng, cuts) ; break ;
+      case 1: discriminator = std::nextafter(pick(rng, cuts), 2.f) ; break ;
+      case 2: discriminator = std::nextafter(pick(rng, cuts), -2.f) ; break ;
+    }
+    if(rng()%50==0) discriminator = -10 ;
+
+    pat::Jet jet ;
+    jet.setP4(reco::Particle::PolarLorentzVector(pt, eta, 2*M_PI*flat(rng), 5)) ;
+    jet.setPartonFlavour(pick(rng, flavours)) ;
+    jet.addBDiscriminatorPair(std::make_pair(std::string(discriminatorName), discriminator)) ;
+    return jet ;
+  }
+
+  // As IIHEModuleJet builds them for the jet_BtagSF* branches
+  std::vector<BTagWeighter::WeightRequest> moduleRequests(){
+    const std::string ctr = "central" ;
+    const std::string vup = "up" ;
+    const std::string vdown = "down" ;
+    std::vector<BTagWeighter::WeightRequest> requests ;
+    for(BTagEntry::OperatingPoint op : {BTagEntry::OP_LOOSE, BTagEntry::OP_MEDIUM, BTagEntry::OP_TIGHT}){
+      requests.push_back(BTagWeighter::WeightRequest(op, ctr  , ctr  )) ;
+      requests.push_back(BTagWeighter::WeightRequest(op, vup  , ctr  )) ;
+      requests.push_back(BTagWeighter::WeightRequest(op, vdown, ctr  )) ;
+      requests.push_back(BTagWeighter::WeightRequest(op, ctr  , vup  )) ;
+      requests.push_back(BTagWeighter::WeightRequest(op, ctr  , vdown)) ;
+    }
+    return requests ;
+  }
+
+  // Random operating points, systematics and run periods, some of them repeated.  The
+  // periods without DeepCSV scale factors are left out of the DeepCSV list.
+  std::vector<BTagWeighter::WeightRequest> randomRequests(std::mt19937& rng, bool do_deep_csv){
+    const std::vector<BTagEntry::OperatingPoint> ops = {BTagEntry::OP_LOOSE, BTagEntry::OP_MEDIUM, BTagEntry::OP_TIGHT} ;
+    const std::vector<std::string> systs = {"central", "up", "down"} ;
+    std::vector<BTagWeighter::Runs> runs = {BTagWeighter::Runs::all, BTagWeighter::Runs::BtoF, BTagWeighter::Runs::GtoH} ;
+    if(!do_deep_csv){
+      runs.push_back(BTagWeighter::Runs::B) ;
+      runs.push_back(BTagWeighter::Runs::CtoD) ;
+      runs.push_back(BTagWeighter::Runs::EtoF) ;
+    }
+    std::vector<BTagWeighter::WeightRequest> requests ;
+    for(int n=1+rng()%20 ; n>0 ; --n){
+      requests.push_back(BTagWeighter::WeightRequest(pick(rng, ops), pick(rng, systs), pick(rng, systs),
+                                                     pick(rng, systs), pick(rng, systs), pick(rng, runs))) ;
+    }
+    return requests ;
+  }
+
+  int compare(const BTagWeighter& weighter, const pat::Jet& jet, const std::vector<BTagWeighter::WeightRequest>& requests,
+              bool do_deep_csv, bool do_by_proc, const char* label, int nFailures){
+    std::vector<double> weights ;
+    weighter.JetBTagWeights(jet, requests, do_deep_csv, do_by_proc, weights) ;
+    int n = 0 ;
+    for(unsigned int i=0 ; i<requests.size() ; ++i){
+      const BTagWeighter::WeightRequest& req = requests[i] ;
+      double expected = weighter.JetBTagWeight(jet, req.op, req.bc_full_syst, req.udsg_full_syst, req.bc_fast_syst, req.udsg_fast_syst,
+                                               do_deep_csv, do_by_proc, req.runs) ;
+      if(weights.size()!=requests.size() || weights[i]!=expected){
+        if(nFailures+n<20) printf("%s, deep %d, by proc %d, request %u (op %d, %s/%s, %s/%s, runs %d), jet (flavour %d, pt %.9g, eta %.9g, discr %.9g): %.17g, single %.17g\n",
+                                  label, do_deep_csv, do_by_proc, i, (int) req.op, req.bc_full_syst.c_str(), req.udsg_full_syst.c_str(),
+                                  req.bc_fast_syst.c_str(), req.udsg_fast_syst.c_str(), (int) req.runs,
+                                  jet.partonFlavour(), jet.pt(), jet.eta(), jet.bDiscriminator(discriminatorName),
+                                  (i<weights.size()) ? weights[i] : NAN, expected) ;
+        n++ ;
+      }
+    }
+    return n ;
+  }
+}
+
+int main(int argc, char** argv){
+  int nJets = (argc>1) ? atoi(argv[1]) : 5000 ;
+  unsigned int seed = (argc>2) ? atoi(argv[2]) : 12345 ;
+  std::mt19937 rng(seed) ;
+  int nChecks = 0 ;
+  int nFailures = 0 ;
+
+  // The weighter reads its inputs from data/ in the working directory
+  char dir[] = "/tmp/testBTagWeightsXXXXXX" ;
+  if(!mkdtemp(dir) || chdir(dir)!=0 || mkdir("data", 0755)!=0){
+    printf("cannot make a temporary data directory\n") ;
+    return 1 ;
+  }
+  const std::vector<std::string> files = BTagWeighter::SourceFiles("tt") ;
+  for(const std::string& file : files){
+    if(endsWith(file, ".csv")) writeCalibration(rng, file) ;
+    else writeEfficiencies(rng, file) ;
+  }
+
+  const BTagWeighter fullSim("tt", false, false, 0) ;
+  const BTagWeighter fastSim("tt", true , false, 1e-4) ;
+  const std::vector<BTagWeighter::WeightRequest> requests = moduleRequests() ;
+
+  for(int j=0 ; j<nJets ; ++j){
+    pat::Jet jet = randomJet(rng) ;
+    for(int deep=0 ; deep<2 ; ++deep){
+      for(int byProc=0 ; byProc<2 ; ++byProc){
+        std::vector<BTagWeighter::WeightRequest> mixed = randomRequests(rng, deep) ;
+        nFailures += compare(fullSim, jet, requests, deep, byProc, "full sim, module requests", nFailures) ;
+        nFailures += compare(fullSim, jet, mixed   , deep, byProc, "full sim, random requests", nFailures) ;
+        nFailures += compare(fastSim, jet, requests, deep, byProc, "fast sim, module requests", nFailures) ;
+        nFailures += compare(fastSim, jet, mixed   , deep, byProc, "fast sim, random requests", nFailures) ;
+        nChecks += 2*(requests.size()+mixed.size()) ;
+      }
+    }
+  }
+
+  for(const std::string& file : files) unlink(file.c_str()) ;
+  rmdir("data") ;
+  if(chdir("/")==0) rmdir(dir) ;
+
+  printf("%d weights, %d failures\n", nChecks, nFailures) ;
+  return (nFailures==0) ? 0 : 1 ;
+}
@@ -0,0 +1,102 @@
+// Long run of CaloGeometryCache the way IIHEModuleGedGsfElectron and IIHEModulePreshower
+// use it: one update() per event, with IOVs of random length, each with one of two
+// geometries with a preshower or one without.  The objects must be rebuilt once per IOV
+// and only then, and since the modules used to allocate a preshower topology on every
+// event, the number of objects alive on the heap has to be exactly the same at the start
+// of every IOV with a preshower as at the start of the first one, and at the end.
+//
+//   testCaloGeometryCache [nEvents]
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+
+#include "DataFormats/DetId/interface/DetId.h"
+#include "DataFormats/EcalDetId/interface/EcalSubdetector.h"
+#include "Geometry/CaloGeometry/interface/CaloGeometry.h"
+#include "Geometry/EcalAlgo/interface/EcalPreshowerGeometry.h"
+#include "UserCode/IIHETree/interface/CaloGeometryCache.h"
+
+// Objects made with new and not deleted yet.  Counted rather than taken from mallinfo,
+// which sees the chunks malloc keeps for reuse as in use.
+static long nAlive = 0 ;
+void* operator new(std::size_t n){
+  void* p = malloc(n ? n : 1) ;
+  if(!p) throw std::bad_alloc() ;
+  nAlive++ ;
+  return p ;
+}
+void operator delete(void* p) noexcept {
+  if(p) nAlive-- ;
+  free(p) ;
+}
+void operator delete(void* p, std::size_t) noexcept {
+  operator delete(p) ;
+}
+
+int main(int argc, char** argv){
+  int nEvents = (argc>1) ? atoi(argv[1]) : 200000 ;
+  std::mt19937 rng(4242) ;
+  std::uniform_int_distribution<int> iovLength(1, 5000) ;
+  int nFailures = 0 ;
+
+  // Two geometries with a preshower and one without, as different IOVs would give
+  EcalPreshowerGeometry preshower[2] ;
+  CaloGeometry geometries[3] ;
+  geometries[0].setSubdetGeometry(DetId::Ecal, EcalPreshower, &preshower[0]) ;
+  geometries[1].setSubdetGeometry(DetId::Ecal, EcalPreshower, &preshower[1]) ;
+
+  CaloGeometryCache cache ;
+  unsigned long long cacheId = 0 ;
+  int iov = 0 ;
+  int eventsLeftInIOV = 0 ;
+  int nIOVs = 0 ;
+  const EcalPreshowerTopology* topology = 0 ;
+  long aliveAtFirstIOV = -1 ;
+  for(int event=0 ; event<nEvents ; ++event){
+    bool newIOV = (eventsLeftInIOV==0) ;
+    if(newIOV){
+      cacheId++ ;
+      iov = (event==0) ? 0 : rng()%3 ;
+      eventsLeftInIOV = iovLength(rng) ;
+      nIOVs++ ;
+    }
+    eventsLeftInIOV-- ;
+
+    cache.update(cacheId, &geometries[iov]) ;
+    if(newIOV) topology = cache.topologyPreshower() ;
+
+    const CaloSubdetectorGeometry* expectedPreshower = (iov<2) ? &preshower[iov] : 0 ;
+    if(cache.geometry()!=&geometries[iov] || cache.geometryPreshower()!=expectedPreshower ||
+       (cache.topologyPreshower()!=0)!=(iov<2) || cache.topologyPreshower()!=topology){
+      if(nFailures<10) printf("event %d: cache does not hold the objects of IOV %llu\n", event, cacheId) ;
+      nFailures++ ;
+    }
+    if(cache.nBuilds()!=nIOVs){
+      if(nFailures<10) printf("event %d: %d builds for %d IOVs\n", event, cache.nBuilds(), nIOVs) ;
+      nFailures++ ;
+    }
+
+    // One topology alive, whichever preshower IOV it is
+    if(newIOV && iov<2){
+      if(aliveAtFirstIOV<0) aliveAtFirstIOV = nAlive ;
+      if(nAlive!=aliveAtFirstIOV){
+        if(nFailures<10) printf("event %d: %ld more objects on the heap than at the first IOV\n", event, nAlive-aliveAtFirstIOV) ;
+        nFailures++ ;
+      }
+    }
+  }
+
+  // Back to a geometry with a preshower for the final count
+  cache.update(cacheId+1, &geometries[0]) ;
+  long growth = nAlive-aliveAtFirstIOV ;
+  if(growth!=0){
+    printf("%ld more objects on the heap at the end than at the first IOV\n", growth) ;
+    nFailures++ ;
+  }
+
+  printf("%d events, %d IOVs, %d builds, heap growth %ld objects\n", nEvents, nIOVs, cache.nBuilds()-1, growth) ;
+  printf("%d failures\n", nFailures) ;
+  return (nFailures==0) ? 0 : 1 ;
+}
@@ -0,0 +1,109 @@
+// EtaPhiGrid::nearest must return exactly what the linear scan of
+// IIHEModuleMCTruth::matchEtaPhi_getIndexLinear returns (EtaPhiGrid::nearestLinear).
+// Objects and queries are random, with extra ones across phi = +/-pi, beyond the
+// |eta|<5 range of the regular cells, and on exact ties.  neighbours() is checked to
+// contain every object within the radius.
+//
+//   testEtaPhiGrid [seed]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#include "DataFormats/Math/interface/deltaR.h"
+#include "UserCode/IIHETree/interface/EtaPhiGrid.h"
+
+namespace{
+  struct Sample{
+    std::vector<float> etas ;
+    std::vector<float> phis ;
+    void add(float eta, float phi){ etas.push_back(eta) ; phis.push_back(phi) ; }
+  } ;
+
+  // Eta over a wider range than the grid's regular cells, phi anywhere, and a share of
+  // the values on the awkward spots
+  void randomPoint(std::mt19937& rng, float& eta, float& phi){
+    std::uniform_real_distribution<float> flat(0, 1) ;
+    float u = flat(rng) ;
+    eta = -8 + 16*flat(rng) ;
+    phi = -M_PI + 2*M_PI*flat(rng) ;
+    if(u<0.10) phi = (flat(rng)<0.5) ? M_PI-1e-3*flat(rng) : -M_PI+1e-3*flat(rng) ;
+    else if(u<0.15) phi = (flat(rng)<0.5) ? (float) M_PI : (float) -M_PI ;
+    else if(u<0.25) eta = (flat(rng)<0.5) ? 5+3*flat(rng) : -5-3*flat(rng) ;
+    else if(u<0.30) eta = (flat(rng)<0.5) ? 5.0f : -5.0f ;
+  }
+}
+
+int main(int argc, char** argv){
+  unsigned int seed = (argc>1) ? atoi(argv[1]) : 12345 ;
+  std::mt19937 rng(seed) ;
+  std::uniform_real_distribution<float> flat(0, 1) ;
+  const unsigned int sizes[] = {0, 1, 2, 15, 16, 17, 40, 200, 1000} ;
+  const float radius = 0.1 ;
+  int nChecks = 0 ;
+  int nFailures = 0 ;
+
+  // Same cells as IIHEModuleMCTruth
+  EtaPhiGrid grid(5.0, 0.2) ;
+  for(unsigned int s=0 ; s<sizeof(sizes)/sizeof(sizes[0]) ; ++s){
+    for(int trial=0 ; trial<20 ; ++trial){
+      Sample sample ;
+      for(unsigned int i=0 ; i<sizes[s] ; ++i){
+        float eta, phi ;
+        randomPoint(rng, eta, phi) ;
+        sample.add(eta, phi) ;
+        // Exact duplicates: equal DeltaR to anything, the first one has to win
+        if(flat(rng)<0.1 && sample.etas.size()<sizes[s]){
+          sample.add(eta, phi) ;
+          ++i ;
+        }
+      }
+      grid.clear() ;
+      for(unsigned int i=0 ; i<sample.etas.size() ; ++i) grid.insert(sample.etas[i], sample.phis[i], i) ;
+
+      std::vector<float> queryEtas, queryPhis ;
+      for(int q=0 ; q<200 ; ++q){
+        float eta, phi ;
+        randomPoint(rng, eta, phi) ;
+        queryEtas.push_back(eta) ;
+        queryPhis.push_back(phi) ;
+      }
+      // Queries on top of objects, and halfway between two of them in eta (a tie)
+      for(unsigned int i=0 ; i<sample.etas.size() && i<20 ; ++i){
+        queryEtas.push_back(sample.etas[i]) ;
+        queryPhis.push_back(sample.phis[i]) ;
+        float d = 0.05*flat(rng) ;
+        grid.insert(sample.etas[i]+2*d, sample.phis[i], sample.etas.size()) ;
+        sample.add(sample.etas[i]+2*d, sample.phis[i]) ;
+        queryEtas.push_back(sample.etas[i]+d) ;
+        queryPhis.push_back(sample.phis[i]) ;
+      }
+
+      for(unsigned int q=0 ; q<queryEtas.size() ; ++q){
+        nChecks++ ;
+        int expected = EtaPhiGrid::nearestLinear(sample.etas, sample.phis, queryEtas[q], queryPhis[q]) ;
+        int found    = grid.nearest(queryEtas[q], queryPhis[q]) ;
+        if(found!=expected){
+          if(nFailures<20) printf("nearest: n=%lu query (%g, %g): grid %d, linear %d\n", sample.etas.size(), queryEtas[q], queryPhis[q], found, expected) ;
+          nFailures++ ;
+        }
+
+        std::vector<int> candidates ;
+        grid.neighbours(queryEtas[q], queryPhis[q], radius, candidates) ;
+        for(unsigned int i=0 ; i<sample.etas.size() ; ++i){
+          if(deltaR(sample.etas[i], sample.phis[i], queryEtas[q], queryPhis[q])>=radius) continue ;
+          if(std::find(candidates.begin(), candidates.end(), (int) i)==candidates.end()){
+            if(nFailures<20) printf("neighbours: n=%lu query (%g, %g) misses %u\n", sample.etas.size(), queryEtas[q], queryPhis[q], i) ;
+            nFailures++ ;
+          }
+        }
+      }
+    }
+  }
+
+  printf("%d queries, %d failures\n", nChecks, nFailures) ;
+  return (nFailures==0) ? 0 : 1 ;
+}
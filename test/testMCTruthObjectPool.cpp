@@ -0,0 +1,86 @@
+// Long run of the MC truth record pool: events of random size are created the way
+// IIHEModuleMCTruth does (reset at the start of the event, one create() and a few
+// addMother() per record).  Once the largest event has been seen the pool must not
+// allocate any more, so the heap in use has to stay exactly flat for the rest of the run.
+// Also checks that recycled records carry the values of their new candidate only.
+//
+//   testMCTruthObjectPool [nEvents]
+
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+#include <random>
+#include <vector>
+
+#include "DataFormats/Candidate/interface/LeafCandidate.h"
+#include "UserCode/IIHETree/interface/MCTruthObject.h"
+
+#if defined(__GLIBC__) && (__GLIBC__>2 || (__GLIBC__==2 && __GLIBC_MINOR__>=33))
+static double heapBytesInUse(){
+  struct mallinfo2 info = mallinfo2() ;
+  return (double)info.uordblks + (double)info.hblkhd ;
+}
+#else
+static double heapBytesInUse(){
+  struct mallinfo info = mallinfo() ;
+  return (double)(unsigned int)info.uordblks + (double)(unsigned int)info.hblkhd ;
+}
+#endif
+
+int main(int argc, char** argv){
+  int nEvents = (argc>1) ? atoi(argv[1]) : 200000 ;
+  const unsigned int maxRecords = 300 ;
+  const unsigned int maxMothers = 3 ;
+  std::mt19937 rng(4242) ;
+  std::uniform_int_distribution<unsigned int> eventSize(0, maxRecords) ;
+  std::uniform_int_distribution<unsigned int> nMothers(0, maxMothers) ;
+  std::uniform_real_distribution<double> flat(0, 1) ;
+  int nFailures = 0 ;
+
+  // The candidates of one event.  Sized once so that they do not move the heap either.
+  std::vector<reco::LeafCandidate> candidates(maxRecords) ;
+  std::vector<MCTruthObject*> records ;
+  records.reserve(maxRecords) ;
+  MCTruthObjectPool pool ;
+
+  double heapAfterWarmUp = 0 ;
+  for(int event=0 ; event<nEvents ; ++event){
+    // The first event is the largest one, with the most mothers per record
+    unsigned int n = (event==0) ? maxRecords : eventSize(rng) ;
+    for(unsigned int i=0 ; i<n ; ++i){
+      reco::LeafCandidate::PolarLorentzVector p4(10+100*flat(rng), -5+10*flat(rng), -3.14+6.28*flat(rng), 0) ;
+      candidates[i] = reco::LeafCandidate(0, p4, reco::LeafCandidate::Point(0, 0, 0), (int)(50*flat(rng))-25) ;
+    }
+
+    pool.reset() ;
+    records.clear() ;
+    for(unsigned int i=0 ; i<n ; ++i){
+      MCTruthObject* record = pool.create(&candidates[i]) ;
+      unsigned int m = (event==0) ? maxMothers : nMothers(rng) ;
+      for(unsigned int j=0 ; j<m ; ++j) record->addMother(&candidates[(i+j+1)%n]) ;
+      records.push_back(record) ;
+
+      if(record->pt()!=(float)candidates[i].pt() || record->eta()!=(float)candidates[i].eta() ||
+         record->nMothers()!=m || record->getCandidate()!=&candidates[i]){
+        if(nFailures<10) printf("event %d record %u does not match its candidate\n", event, i) ;
+        nFailures++ ;
+      }
+    }
+
+    if(event==0) heapAfterWarmUp = heapBytesInUse() ;
+  }
+  double heapAtEnd = heapBytesInUse() ;
+
+  if(pool.capacity()!=maxRecords){
+    printf("pool holds %u records, expected %u\n", pool.capacity(), maxRecords) ;
+    nFailures++ ;
+  }
+  if(heapAtEnd!=heapAfterWarmUp){
+    printf("heap grew by %.0f bytes after the first event\n", heapAtEnd-heapAfterWarmUp) ;
+    nFailures++ ;
+  }
+
+  printf("%d events, pool capacity %u, heap growth after the first event %.0f bytes\n", nEvents, pool.capacity(), heapAtEnd-heapAfterWarmUp) ;
+  printf("%d failures\n", nFailures) ;
+  return (nFailures==0) ? 0 : 1 ;
+}
@@ -0,0 +1,115 @@
+// MiniAODHelper::isoSumRaw on the candidate lists of SetPackedCandidates reads only the
+// phi slices around the cone.  On any other list it still scans the whole eta window, as
+// it always did, so the same cone summed over a copy of the list is the reference: the
+// sums have to agree bit for bit.  Candidates and cones are random, with a share of them
+// on and across phi = +/-pi, with shared and self vetos, inner cones, thresholds and
+// pdgId selections.
+//
+//   testMiniAODIsolation [nEvents] [seed]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "DataFormats/Candidate/interface/CompositePtrCandidate.h"
+#include "DataFormats/PatCandidates/interface/PackedCandidate.h"
+#include "UserCode/IIHETree/interface/MiniAODHelper.h"
+
+namespace{
+  // Access to the lists filled by SetPackedCandidates
+  class IsolationProbe : public MiniAODHelper{
+  public:
+    const std::vector<const pat::PackedCandidate *> & neutral() const { return neutral_; }
+  } ;
+
+  // Phi anywhere, a share of it close to or on the boundary
+  double randomPhi(std::mt19937& rng){
+    std::uniform_real_distribution<double> flat(0, 1) ;
+    double u = flat(rng) ;
+    if(u<0.15) return (flat(rng)<0.5) ? M_PI-0.3*flat(rng) : -M_PI+0.3*flat(rng) ;
+    if(u<0.20) return (flat(rng)<0.5) ? M_PI : -M_PI ;
+    return -M_PI + 2*M_PI*flat(rng) ;
+  }
+
+  // Neutral candidates only: SetPackedCandidates sorts them without looking at vertices
+  void fillCandidates(std::mt19937& rng, unsigned int n, std::vector<pat::PackedCandidate>& all){
+    std::uniform_real_distribution<double> flat(0, 1) ;
+    all.clear() ;
+    all.reserve(n) ;
+    for(unsigned int i=0 ; i<n ; ++i){
+      double pt  = 0.1 - 3*std::log(flat(rng)+1e-12) ;
+      double eta = -3 + 6*flat(rng) ;
+      int pdgId  = (flat(rng)<0.7) ? 22 : 130 ;
+      reco::Particle::PolarLorentzVector p4(pt, eta, randomPhi(rng), 0) ;
+      all.push_back(pat::PackedCandidate(p4, reco::Particle::Point(0, 0, 0), p4.phi(), pdgId, reco::VertexRefProd(), 0)) ;
+    }
+  }
+
+  // A lepton-like cone centre.  Some are on top of a candidate and have it as a source, so
+  // that the self veto has something to do.
+  reco::CompositePtrCandidate randomCone(std::mt19937& rng, const std::vector<pat::PackedCandidate>& all){
+    std::uniform_real_distribution<double> flat(0, 1) ;
+    double pt = 5 + 300*flat(rng) ;
+    if(flat(rng)<0.3 && !all.empty()){
+      unsigned int k = rng()%all.size() ;
+      reco::CompositePtrCandidate cone(0, reco::Particle::PolarLorentzVector(pt, all[k].eta(), all[k].phi(), 0)) ;
+      cone.addDaughter(reco::CandidatePtr(&all[k], k)) ;
+      if(flat(rng)<0.5) cone.addDaughter(reco::CandidatePtr(&all[(k+1)%all.size()], (k+1)%all.size())) ;
+      return cone ;
+    }
+    return reco::CompositePtrCandidate(0, reco::Particle::PolarLorentzVector(pt, -2.5+5*flat(rng), randomPhi(rng), 0)) ;
+  }
+}
+
+int main(int argc, char** argv){
+  int nEvents = (argc>1) ? atoi(argv[1]) : 200 ;
+  unsigned int seed = (argc>2) ? atoi(argv[2]) : 12345 ;
+  std::mt19937 rng(seed) ;
+  std::uniform_real_distribution<double> flat(0, 1) ;
+  const float innerRs[] = {0, 0.0001, 0.01, 0.015, 0.08} ;
+  const float thresholds[] = {0, 0.5} ;
+  const int pdgIds[] = {-1, 22, 130} ;
+  const SelfVetoPolicy::SelfVetoPolicy selfVetos[] = {SelfVetoPolicy::selfVetoNone, SelfVetoPolicy::selfVetoAll, SelfVetoPolicy::selfVetoFirst} ;
+  int nChecks = 0 ;
+  int nFailures = 0 ;
+
+  IsolationProbe helper ;
+  std::vector<pat::PackedCandidate> all ;
+  for(int event=0 ; event<nEvents ; ++event){
+    fillCandidates(rng, 200+rng()%3000, all) ;
+    helper.SetPackedCandidates(all) ;
+    const std::vector<const pat::PackedCandidate *> & sliced = helper.neutral() ;
+    std::vector<const pat::PackedCandidate *> scanned(sliced) ;
+
+    // Shared vetos, as addVetos does for the selected leptons
+    reco::CompositePtrCandidate vetoed(0, reco::Particle::PolarLorentzVector(1, 0, 0, 0)) ;
+    for(int i=0 ; i<20 ; ++i){
+      unsigned int k = rng()%all.size() ;
+      vetoed.addDaughter(reco::CandidatePtr(&all[k], k)) ;
+    }
+    helper.addVetos(vetoed) ;
+
+    for(int q=0 ; q<200 ; ++q){
+      reco::CompositePtrCandidate cone = randomCone(rng, all) ;
+      // Mini-isolation radii, and some larger cones spanning several slices
+      float dR = (flat(rng)<0.8) ? 10.0/std::min(std::max(cone.pt(), 50.), 200.) : 0.2+0.6*flat(rng) ;
+      float innerR = innerRs[rng()%5] ;
+      float threshold = thresholds[rng()%2] ;
+      int pdgId = pdgIds[rng()%3] ;
+      SelfVetoPolicy::SelfVetoPolicy selfVeto = selfVetos[rng()%3] ;
+
+      nChecks++ ;
+      float expected = helper.isoSumRaw(scanned, cone, dR, innerR, threshold, selfVeto, pdgId) ;
+      float found    = helper.isoSumRaw(sliced , cone, dR, innerR, threshold, selfVeto, pdgId) ;
+      if(found!=expected){
+        if(nFailures<20) printf("event %d cone (%g, %g) dR %g: slices %.9g, eta window %.9g\n", event, cone.eta(), cone.phi(), dR, found, expected) ;
+        nFailures++ ;
+      }
+    }
+  }
+
+  printf("%d cones, %d failures\n", nChecks, nFailures) ;
+  return (nFailures==0) ? 0 : 1 ;
+}
@@ -0,0 +1,163 @@
+// Regression test of the Rochester corrections on the synthetic parameters of
+// test/data/roccor.  reference.txt holds muons with the kScaleDT, kScaleAndSmearMC and
+// kScaleFromGenMC the per-muon calls gave for them when it was written (the same as the
+// original RoccoR code); the per-muon calls have to give them back, up to rounding in
+// the math library.  The calls on whole collections have to give exactly what the
+// per-muon calls give, on the reference muons and on random collections from a fixed
+// seed, with u and w taken from the muons or drawn from a TRandom3, and with the inverse
+// cdfs exact and tabulated.
+//
+//   testRoccoR [directory] [seed]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <TRandom3.h>
+
+#include "UserCode/IIHETree/interface/RoccoR.h"
+
+namespace{
+  struct Reference{
+    int s ;
+    int m ;
+    RocMuon muon ;
+    double kDT ;
+    double kMC ;
+    double kGen ;
+  } ;
+
+  std::vector<Reference> readReference(const std::string& filename){
+    std::vector<Reference> references ;
+    std::ifstream in(filename.c_str()) ;
+    std::string line ;
+    while(std::getline(in, line)){
+      if(line.empty() || line[0]=='#') continue ;
+      std::stringstream ss(line) ;
+      Reference r ;
+      ss >> r.s >> r.m >> r.muon.Q >> r.muon.pt >> r.muon.eta >> r.muon.phi >> r.muon.n >> r.muon.gt >> r.muon.u >> r.muon.w >> r.kDT >> r.kMC >> r.kGen ;
+      if(ss) references.push_back(r) ;
+    }
+    return references ;
+  }
+
+  bool close(double found, double expected){
+    return std::fabs(found-expected)<=1e-10*std::fabs(expected) ;
+  }
+
+  // Random muons over the whole parameter range: the raw mt19937 output is the same
+  // everywhere, unlike the standard distributions
+  std::vector<RocMuon> randomMuons(std::mt19937& rng, unsigned int n){
+    std::vector<RocMuon> muons(n) ;
+    for(unsigned int i=0 ; i<n ; ++i){
+      RocMuon& mu = muons[i] ;
+      mu.Q   = (rng()%2) ? 1 : -1 ;
+      mu.pt  = 5 - 40*std::log((rng()+0.5)/4294967296.0) ;
+      mu.eta = -2.6 + 5.2*(rng()+0.5)/4294967296.0 ;
+      mu.phi = -M_PI + 2*M_PI*(rng()+0.5)/4294967296.0 ;
+      mu.n   = rng()%12 ;
+      mu.gt  = mu.pt*(0.9+0.2*(rng()+0.5)/4294967296.0) ;
+      mu.u   = (rng()+0.5)/4294967296.0 ;
+      mu.w   = (rng()+0.5)/4294967296.0 ;
+    }
+    return muons ;
+  }
+
+  // The collection calls against the per-muon calls, for one set and member
+  void checkCollection(const RoccoR& rc, const std::vector<RocMuon>& muons, int s, int m, unsigned int seed, const char* label, int& nFailures){
+    std::vector<double> kDT, kMC, kGen, kMCRandom, kGenRandom ;
+    rc.kScaleDT(muons, kDT, s, m) ;
+    rc.kScaleAndSmearMC(muons, kMC, s, m) ;
+    rc.kScaleFromGenMC(muons, kGen, s, m) ;
+    TRandom3 rndMC(seed) ;
+    TRandom3 rndGen(seed) ;
+    rc.kScaleAndSmearMC(muons, kMCRandom, s, m, &rndMC) ;
+    rc.kScaleFromGenMC(muons, kGenRandom, s, m, &rndGen) ;
+
+    TRandom3 rndMCLoop(seed) ;
+    TRandom3 rndGenLoop(seed) ;
+    for(unsigned int i=0 ; i<muons.size() ; ++i){
+      const RocMuon& mu = muons[i] ;
+      double u = rndMCLoop.Rndm() ;
+      double w = rndMCLoop.Rndm() ;
+      double expected[5] ;
+      expected[0] = rc.kScaleDT(mu.Q, mu.pt, mu.eta, mu.phi, s, m) ;
+      expected[1] = rc.kScaleAndSmearMC(mu.Q, mu.pt, mu.eta, mu.phi, mu.n, mu.u, mu.w, s, m) ;
+      expected[2] = rc.kScaleFromGenMC(mu.Q, mu.pt, mu.eta, mu.phi, mu.n, mu.gt, mu.w, s, m) ;
+      expected[3] = rc.kScaleAndSmearMC(mu.Q, mu.pt, mu.eta, mu.phi, mu.n, u, w, s, m) ;
+      expected[4] = rc.kScaleFromGenMC(mu.Q, mu.pt, mu.eta, mu.phi, mu.n, mu.gt, rndGenLoop.Rndm(), s, m) ;
+      double found[5] = {kDT[i], kMC[i], kGen[i], kMCRandom[i], kGenRandom[i]} ;
+      const char* names[5] = {"kScaleDT", "kScaleAndSmearMC", "kScaleFromGenMC", "kScaleAndSmearMC(rnd)", "kScaleFromGenMC(rnd)"} ;
+      for(int j=0 ; j<5 ; ++j){
+        if(found[j]==expected[j]) continue ;
+        if(nFailures<20) printf("%s set %d member %d muon %u: %s collection %.17g, per muon %.17g\n", label, s, m, i, names[j], found[j], expected[j]) ;
+        nFailures++ ;
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv){
+  std::string dirname = "test/data/roccor" ;
+  if(argc>1) dirname = argv[1] ;
+  else if(getenv("CMSSW_BASE")) dirname = std::string(getenv("CMSSW_BASE"))+"/src/UserCode/IIHETree/test/data/roccor" ;
+  unsigned int seed = (argc>2) ? atoi(argv[2]) : 12345 ;
+  int nChecks = 0 ;
+  int nFailures = 0 ;
+
+  std::vector<Reference> references = readReference(dirname+"/reference.txt") ;
+  if(references.empty()){
+    printf("no reference muons in %s/reference.txt\n", dirname.c_str()) ;
+    return 1 ;
+  }
+  RoccoR rc(dirname) ;
+
+  // Per-muon calls against the reference
+  for(unsigned int i=0 ; i<references.size() ; ++i){
+    const Reference& r = references[i] ;
+    const RocMuon& mu = r.muon ;
+    if(r.s>=rc.Nset() || r.m>=rc.Nmem(r.s)){
+      printf("reference muon %u: no set %d member %d\n", i, r.s, r.m) ;
+      return 1 ;
+    }
+    nChecks++ ;
+    double kDT  = rc.kScaleDT(mu.Q, mu.pt, mu.eta, mu.phi, r.s, r.m) ;
+    double kMC  = rc.kScaleAndSmearMC(mu.Q, mu.pt, mu.eta, mu.phi, mu.n, mu.u, mu.w, r.s, r.m) ;
+    double kGen = rc.kScaleFromGenMC(mu.Q, mu.pt, mu.eta, mu.phi, mu.n, mu.gt, mu.w, r.s, r.m) ;
+    if(!close(kDT, r.kDT) || !close(kMC, r.kMC) || !close(kGen, r.kGen)){
+      if(nFailures<20) printf("reference muon %u: %.17g %.17g %.17g, expected %.17g %.17g %.17g\n", i, kDT, kMC, kGen, r.kDT, r.kMC, r.kGen) ;
+      nFailures++ ;
+    }
+  }
+
+  // Collection calls, with the inverse cdfs exact and then tabulated
+  std::mt19937 rng(seed) ;
+  const double tolerances[] = {0, 1e-6} ;
+  for(unsigned int t=0 ; t<sizeof(tolerances)/sizeof(tolerances[0]) ; ++t){
+    rc.setInvcdfTolerance(tolerances[t]) ;
+    const char* label = (tolerances[t]>0) ? "tabulated" : "exact" ;
+    for(int s=0 ; s<rc.Nset() ; ++s){
+      for(int m=0 ; m<rc.Nmem(s) ; ++m){
+        std::vector<RocMuon> muons ;
+        for(unsigned int i=0 ; i<references.size() ; ++i){
+          if(references[i].s==s && references[i].m==m) muons.push_back(references[i].muon) ;
+        }
+        checkCollection(rc, muons, s, m, seed, label, nFailures) ;
+        nChecks += muons.size() ;
+        for(int event=0 ; event<200 ; ++event){
+          muons = randomMuons(rng, rng()%8) ;
+          checkCollection(rc, muons, s, m, seed+event, label, nFailures) ;
+          nChecks += muons.size() ;
+        }
+      }
+    }
+  }
+
+  printf("%lu reference muons, %d checks, %d failures\n", references.size(), nChecks, nFailures) ;
+  return (nFailures==0) ? 0 : 1 ;
+}
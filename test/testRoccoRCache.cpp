@@ -0,0 +1,217 @@
+// Round trip of the binary cache of RoccoR on the synthetic parameters of
+// test/data/roccor: a RoccoR read back from the cache has to give exactly the corrections
+// of the one that wrote it, with the inverse cdfs exact, all tabulated, or only partly
+// tabulated when the cache was written.  Damaged caches have to be refused: truncated,
+// with a byte changed, and, with the checksum of the contents made to match again, with
+// impossible numbers of sets or members and with tables whose guide points outside them.
+//
+//   testRoccoRCache [directory] [cache file]
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "UserCode/IIHETree/interface/RoccoR.h"
+
+namespace{
+  // Magic, checksum of the text files, checksum of the payload
+  const size_t headerSize = 24 ;
+
+  std::string readFile(const std::string& filename){
+    std::ifstream in(filename.c_str(), std::ios::binary) ;
+    std::stringstream content ;
+    content << in.rdbuf() ;
+    return content.str() ;
+  }
+
+  void writeFile(const std::string& filename, const std::string& content){
+    std::ofstream out(filename.c_str(), std::ios::binary) ;
+    out.write(content.data(), content.size()) ;
+  }
+
+  // The payload checksum of RoccoR::writeCache (64 bit FNV-1a), put back after an edit
+  void resum(std::string& cache){
+    uint64_t sum = 14695981039346656037ULL ;
+    for(size_t i=headerSize ; i<cache.size() ; ++i){
+      sum ^= (unsigned char) cache[i] ;
+      sum *= 1099511628211ULL ;
+    }
+    memcpy(&cache[16], &sum, sizeof(sum)) ;
+  }
+
+  template<typename T> void put(std::string& cache, size_t offset, T x){
+    memcpy(&cache[offset], &x, sizeof(T)) ;
+  }
+
+  std::vector<RocMuon> testMuons(){
+    std::vector<RocMuon> muons ;
+    for(int i=0 ; i<400 ; ++i){
+      RocMuon mu ;
+      mu.Q   = (i%2) ? 1 : -1 ;
+      mu.pt  = 5+0.7*i ;
+      mu.eta = -2.6+0.013*i ;
+      mu.phi = -M_PI+0.0157*i ;
+      mu.n   = i%12 ;
+      mu.gt  = mu.pt*(0.95+0.0002*i) ;
+      mu.u   = (i*0.618034+0.01)-std::floor(i*0.618034+0.01) ;
+      mu.w   = (i*0.414214+0.02)-std::floor(i*0.414214+0.02) ;
+      muons.push_back(mu) ;
+    }
+    return muons ;
+  }
+
+  // All corrections of all sets and members, bit for bit
+  int compare(const RoccoR& expected, const RoccoR& found, const std::vector<RocMuon>& muons, const char* label){
+    int nFailures = 0 ;
+    if(found.Nset()!=expected.Nset()){
+      printf("%s: %d sets, expected %d\n", label, found.Nset(), expected.Nset()) ;
+      return 1 ;
+    }
+    for(int s=0 ; s<expected.Nset() ; ++s){
+      if(found.Nmem(s)!=expected.Nmem(s)){
+        printf("%s: set %d has %d members, expected %d\n", label, s, found.Nmem(s), expected.Nmem(s)) ;
+        nFailures++ ;
+        continue ;
+      }
+      for(int m=0 ; m<expected.Nmem(s) ; ++m){
+        std::vector<double> kExpected[3], kFound[3] ;
+        expected.kScaleDT(muons, kExpected[0], s, m) ;
+        expected.kScaleAndSmearMC(muons, kExpected[1], s, m) ;
+        expected.kScaleFromGenMC(muons, kExpected[2], s, m) ;
+        found.kScaleDT(muons, kFound[0], s, m) ;
+        found.kScaleAndSmearMC(muons, kFound[1], s, m) ;
+        found.kScaleFromGenMC(muons, kFound[2], s, m) ;
+        for(int j=0 ; j<3 ; ++j){
+          if(kFound[j]==kExpected[j]) continue ;
+          if(nFailures<20) printf("%s: set %d member %d, correction %d differs\n", label, s, m, j) ;
+          nFailures++ ;
+        }
+      }
+    }
+    return nFailures ;
+  }
+}
+
+int main(int argc, char** argv){
+  std::string dirname = "test/data/roccor" ;
+  if(argc>1) dirname = argv[1] ;
+  else if(getenv("CMSSW_BASE")) dirname = std::string(getenv("CMSSW_BASE"))+"/src/UserCode/IIHETree/test/data/roccor" ;
+  std::string cachename = (argc>2) ? argv[2] : "testRoccoRCache.bin" ;
+  std::vector<RocMuon> muons = testMuons() ;
+  std::vector<RocMuon> someMuons(muons.begin(), muons.begin()+3) ;
+  uint64_t checksum = RoccoR::textChecksum(dirname) ;
+  int nCaches = 0 ;
+  int nFailures = 0 ;
+
+  // Round trips: exact inverse cdfs, tables built for a few muons only, all tables built
+  for(int mode=0 ; mode<3 ; ++mode){
+    const char* label = (mode==0) ? "exact" : (mode==1) ? "partly tabulated" : "tabulated" ;
+    RoccoR written(dirname) ;
+    if(mode>0) written.setInvcdfTolerance(1e-6) ;
+    std::vector<double> k ;
+    if(mode==1) written.kScaleAndSmearMC(someMuons, k) ;
+    if(mode==2) written.validateInvcdf(100) ;
+    if(!written.writeCache(cachename, checksum)){
+      printf("%s: could not write %s\n", label, cachename.c_str()) ;
+      return 1 ;
+    }
+    nCaches++ ;
+    RoccoR read ;
+    if(!read.readCache(cachename, checksum)){
+      printf("%s: cache refused\n", label) ;
+      nFailures++ ;
+      continue ;
+    }
+    nFailures += compare(written, read, muons, label) ;
+
+    RoccoR unchecked ;
+    if(!unchecked.readCache(cachename, 0) || unchecked.readCache(cachename, checksum+1)){
+      printf("%s: text checksum not handled\n", label) ;
+      nFailures++ ;
+    }
+  }
+
+  // The last cache, with every table built, damaged in every way that must be refused
+  const std::string good = readFile(cachename) ;
+  std::vector<std::string> bad ;
+  for(size_t n=0 ; n<good.size() ; n+=good.size()/97+1) bad.push_back(good.substr(0, n)) ;
+  bad.push_back(good.substr(0, good.size()-1)) ;
+  bad.push_back(good+'\0') ;
+  for(size_t i=0 ; i<good.size() ; i+=good.size()/97+1){
+    bad.push_back(good) ;
+    bad.back()[i] ^= 0x10 ;
+  }
+
+  // The payload starts with the number of sets, then that of the members of the first set
+  bad.push_back(good) ;
+  put<uint32_t>(bad.back(), headerSize, 0xffffffff) ;
+  resum(bad.back()) ;
+  bad.push_back(good) ;
+  put<uint32_t>(bad.back(), headerSize+4, 0xffffffff) ;
+  resum(bad.back()) ;
+  bad.push_back(good) ;
+  put<uint32_t>(bad.back(), headerSize+4, 1000) ;
+  resum(bad.back()) ;
+
+  // The first table: where the cache without tables and this one first differ is its size,
+  // followed by its tolerance, guide scale, nodes, values, tangents and guide
+  RoccoR noTables(dirname) ;
+  noTables.setInvcdfTolerance(1e-6) ;
+  noTables.writeCache(cachename, checksum) ;
+  const std::string plain = readFile(cachename) ;
+  size_t table = headerSize ;
+  while(table<plain.size() && plain[table]==good[table]) ++table ;
+  uint32_t nNodes = 0 ;
+  memcpy(&nNodes, &good[table], sizeof(nNodes)) ;
+  if(table>=plain.size() || nNodes<2){
+    printf("no table found in the cache\n") ;
+    return 1 ;
+  }
+  size_t tabU = table+4+16 ;
+  size_t tabGuide = tabU+16*nNodes+16*(nNodes-1) ;
+  const int guides[] = {-1, (int)nNodes-1, 1<<30} ;
+  for(unsigned int g=0 ; g<sizeof(guides)/sizeof(guides[0]) ; ++g){
+    bad.push_back(good) ;
+    put<int>(bad.back(), tabGuide, guides[g]) ;
+    resum(bad.back()) ;
+    bad.push_back(good) ;
+    put<int>(bad.back(), tabGuide+4*(nNodes-2), guides[g]) ;
+    resum(bad.back()) ;
+  }
+  bad.push_back(good) ;
+  put<double>(bad.back(), tabU+8, 1.0) ;
+  resum(bad.back()) ;
+  bad.push_back(good) ;
+  put<double>(bad.back(), tabU, NAN) ;
+  resum(bad.back()) ;
+  bad.push_back(good) ;
+  put<uint32_t>(bad.back(), table, 1<<30) ;
+  resum(bad.back()) ;
+
+  for(unsigned int b=0 ; b<bad.size() ; ++b){
+    writeFile(cachename, bad[b]) ;
+    nCaches++ ;
+    RoccoR read ;
+    if(read.readCache(cachename, checksum)){
+      if(nFailures<20) printf("damaged cache %u of %lu accepted\n", b, bad.size()) ;
+      nFailures++ ;
+    }
+  }
+
+  // A good cache again once the damaged ones have been refused
+  writeFile(cachename, good) ;
+  RoccoR read ;
+  if(!read.readCache(cachename, checksum)){
+    printf("cache refused after the damaged ones\n") ;
+    nFailures++ ;
+  }
+  remove(cachename.c_str()) ;
+
+  printf("%d caches read, %d failures\n", nCaches, nFailures) ;
+  return (nFailures==0) ? 0 : 1 ;
+}
@@ -0,0 +1,127 @@
+// TriggerNameMatcher::count must give, for every pattern, what HLTrigger::nSubstringInString
+// gives: occurrences that do not overlap each other, taken from the left.  matchesAny must
+// be true when any of them is found.  The pattern sets are the names the trigger
+// classification looks for, the default saveFiltersTriggers, and a small set of patterns
+// that overlap and repeat each other on a two letter alphabet.  The names are random
+// pieces of the patterns, repeated or cut short, separators, and non-ASCII characters,
+// which reset the matcher.  Patterns with a non-ASCII character never match.
+//
+//   testTriggerNameMatcher [nNames] [seed]
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "UserCode/IIHETree/interface/TriggerNameMatcher.h"
+
+namespace{
+  // As in HLTrigger::nSubstringInString
+  int nSubstringInString(const std::string& str, const std::string& sub){
+    if(sub.length()==0) return 0 ;
+    int count = 0 ;
+    for (size_t offset=str.find(sub) ; offset!=std::string::npos ; offset=str.find(sub, offset + sub.length())){ ++count ; }
+    return count;
+  }
+
+  bool isASCII(const std::string& s){
+    for(unsigned int i=0 ; i<s.size() ; ++i){
+      if((unsigned char) s[i]>=128) return false ;
+    }
+    return true ;
+  }
+
+  // As in the trigger name classification in TriggerObject.cc
+  const std::vector<std::string> classifierPatterns = {
+    "_SC", "Photon", "DoublePhoton", "TriplePhoton", "Ele", "DoubleEle", "DiEle",
+    "TripleEle", "Mu", "muon", "Multi", "DoubleMu", "DiMu", "Dimuon", "DoubleIsoMu",
+    "TripleMu", "Tau", "NoJetId", "Jet", "DiJet", "DiPFJet", "DoubleJet", "DiCentralJet",
+    "DiCentralPFJet", "TriCentralPFJet", "QuadJet", "QuadPFJet", "SixJet", "SixPFJet",
+    "EightJet", "EightPFJet", "BJet", "DiBJet", "DiCentral", "TriiBJet", "TriCentral",
+    "MET", "HT", "ALCa"
+  } ;
+
+  // As in IIHEModuleTrigger::defaultSaveFiltersTriggers
+  const std::vector<std::string> saveFiltersPatterns = {
+    "Ele27_eta2p1_WPTight_Gsf_v", "DoubleEle33_CaloIdL_MW_v", "DoubleEle33_CaloIdL_GsfTrkIdVL_v",
+    "Ele23_Ele12_CaloIdL_TrackIdL_IsoVL_DZ_v", "Mu17_TrkIsoVVL_TkMu8_TrkIsoVVL_v",
+    "Mu17_TrkIsoVVL_Mu8_TrkIsoVVL_v", "Mu17_TrkIsoVVL_Mu8_TrkIsoVVL_DZ_v",
+    "Mu17_TrkIsoVVL_TkMu8_TrkIsoVVL_DZ_v", "Iso_TkMu24_v", "Iso_Mu24_v",
+    "Mu23_TrkIsoVVL_Ele8_CaloIdL_TrackIdL_IsoVL_v", "Mu8_TrkIsoVVL_Ele23_CaloIdL_TrackIdL_IsoVL_v",
+    "Mu23_TrkIsoVVL_Ele8_CaloIdL_TrackIdL_IsoVL_DZ_v", "Mu8_TrkIsoVVL_Ele23_CaloIdL_TrackIdL_IsoVL_DZ_v"
+  } ;
+
+  // Overlapping, nested and repeated patterns, an empty one and non-ASCII ones
+  const std::vector<std::string> overlappingPatterns = {
+    "a", "aa", "aaa", "ab", "ba", "aba", "abab", "baab", "aa", "b", "bbb", "", "a\xc3\xa9", "\xc3\xa9"
+  } ;
+
+  // A trigger-like name: pieces of the patterns, whole, cut short or repeated, between
+  // separators, with a non-ASCII character now and then
+  std::string randomName(std::mt19937& rng, const std::vector<std::string>& patterns){
+    const std::vector<std::string> separators = {"HLT_", "_", "_v", "2p1", "17", "a", "b", "", "\xc3\xa9"} ;
+    std::string name ;
+    for(int n=1+rng()%8 ; n>0 ; --n){
+      const std::string& pattern = patterns[rng()%patterns.size()] ;
+      switch(rng()%6){
+        case 0: name += pattern.substr(0, rng()%(pattern.size()+1)) ; break ;
+        case 1: name += pattern.substr(rng()%(pattern.size()+1)) ; break ;
+        case 2: for(int r=2+rng()%3 ; r>0 ; --r) name += pattern ; break ;
+        default: name += pattern ; break ;
+      }
+      name += separators[rng()%separators.size()] ;
+    }
+    // A non-ASCII byte in the middle of whatever is there
+    if(rng()%8==0 && !name.empty()) name.insert(rng()%name.size(), 1, (char) (128+rng()%128)) ;
+    return name ;
+  }
+
+  int check(const TriggerNameMatcher& matcher, const std::vector<std::string>& patterns, const std::string& name, const char* label, int nFailures){
+    std::vector<int> counts ;
+    matcher.count(name, counts) ;
+    int n = 0 ;
+    bool anyExpected = false ;
+    for(unsigned int p=0 ; p<patterns.size() ; ++p){
+      int expected = isASCII(patterns[p]) ? nSubstringInString(name, patterns[p]) : 0 ;
+      if(expected>0) anyExpected = true ;
+      if(counts.size()!=patterns.size() || counts[p]!=expected){
+        if(nFailures+n<20) printf("%s, \"%s\" in \"%s\": %d, nSubstringInString %d\n", label, patterns[p].c_str(), name.c_str(),
+                                  (p<counts.size()) ? counts[p] : -1, expected) ;
+        n++ ;
+      }
+    }
+    if(matcher.matchesAny(name)!=anyExpected){
+      if(nFailures+n<20) printf("%s, \"%s\": matchesAny %d, expected %d\n", label, name.c_str(), !anyExpected, anyExpected) ;
+      n++ ;
+    }
+    return n ;
+  }
+}
+
+int main(int argc, char** argv){
+  int nNames = (argc>1) ? atoi(argv[1]) : 100000 ;
+  unsigned int seed = (argc>2) ? atoi(argv[2]) : 12345 ;
+  std::mt19937 rng(seed) ;
+  int nFailures = 0 ;
+
+  const std::vector<std::string>* patternSets[] = {&classifierPatterns, &saveFiltersPatterns, &overlappingPatterns} ;
+  const char* labels[] = {"classifier", "saveFiltersTriggers", "overlapping"} ;
+  for(int s=0 ; s<3 ; ++s){
+    const std::vector<std::string>& patterns = *patternSets[s] ;
+    TriggerNameMatcher matcher(patterns) ;
+    nFailures += check(matcher, patterns, "", labels[s], nFailures) ;
+    for(int i=0 ; i<nNames ; ++i){
+      nFailures += check(matcher, patterns, randomName(rng, patterns), labels[s], nFailures) ;
+    }
+  }
+
+  // Without patterns nothing matches
+  TriggerNameMatcher empty ;
+  std::vector<int> counts(1, 1) ;
+  empty.count("HLT_Ele27_v1", counts) ;
+  if(!counts.empty() || empty.matchesAny("HLT_Ele27_v1")) nFailures++ ;
+
+  printf("%d names, %d failures\n", 3*(nNames+1), nFailures) ;
+  return (nFailures==0) ? 0 : 1 ;
+}